@@ -121,6 +121,7 @@ struct ConsensusType
     float ElapsedMilliseconds;
     boost::optional<SNR> SignalToNoise;
     boost::optional<std::tuple<int16_t, int16_t, uint8_t>> Barcodes;
+    size_t PoaCoverage;  // subreads in the draft POA
 };
 
 template <typename TConsensus>
@@ -135,6 +136,7 @@ public:
     size_t TooFewPasses;
     size_t TooManyUnusable;
     size_t NonConvergent;
+    size_t ExceededBudget;
     size_t PoorQuality;
     size_t ExceptionThrown;
     SubreadResultCounter SubreadCounter;
@@ -148,6 +150,7 @@ public:
         , TooFewPasses{0}
         , TooManyUnusable{0}
         , NonConvergent{0}
+        , ExceededBudget{0}
         , PoorQuality{0}
         , ExceptionThrown{0}
         , SubreadCounter{}
@@ -164,6 +167,7 @@ public:
         TooManyUnusable += other.TooManyUnusable;
         TooFewPasses += other.TooFewPasses;
         NonConvergent += other.NonConvergent;
+        ExceededBudget += other.ExceededBudget;
         PoorQuality += other.PoorQuality;
         ExceptionThrown += other.ExceptionThrown;
         SubreadCounter += other.SubreadCounter;
@@ -173,7 +177,7 @@ public:
     size_t Total() const
     {
         return (Success + PoorSNR + NoSubreads + TooShort + TooManyUnusable + TooFewPasses +
-                NonConvergent + PoorQuality + ExceptionThrown);
+                NonConvergent + ExceededBudget + PoorQuality + ExceptionThrown);
     }
 };
 
@@ -328,11 +332,22 @@ bool ReadAccuracyDescending(const std::pair<size_t, const TRead*>& a,
 
 /// \returns a std::pair containing a std::string for the consensus, and a size_t
 //           describing the number of adapter-to-adapter reads successfully added
+//           (or, past convergence, mapped); the number of reads in the POA goes
+//           to poaCoverage; with poaThreads > 1 (and no convergence check) the
+//           draft is built from partitions of the first maxPoaCov reads in
+//           parallel, and topped up with the reads after them until maxPoaCov
+//           reads are in; the graph, or each partition of it, is pruned as
+//           reads are added, per pruning; the size of its graph goes to
+//           graphStats
 template <typename TRead>
 std::pair<std::string, size_t> PoaConsensus(const std::vector<const TRead*>& reads,
                                             std::vector<SparsePoa::ReadKey>* readKeys,
                                             std::vector<PoaAlignmentSummary>* summaries,
-                                            const size_t maxPoaCov)
+                                            const size_t maxPoaCov,
+                                            const PacBio::Poa::PoaConvergence& convergence,
+                                            size_t* poaCoverage, const size_t poaThreads = 1,
+                                            const PacBio::Poa::PoaPruning& pruning = {},
+                                            PacBio::Poa::PoaGraphStats* graphStats = nullptr)
 {
     SparsePoa poa;
     size_t cov = 0;
@@ -353,7 +368,38 @@ std::pair<std::string, size_t> PoaConsensus(const std::vector<const TRead*>& rea
     readKeys->clear();
     // readKeys->resize(sorted.size());
 
-    for (const auto read : reads) {
+    // once the draft has converged, the remaining reads are only mapped to it
+    bool converged = false;
+    std::vector<size_t> unadded;
+
+    if (poaThreads > 1 && !convergence.Enabled()) {
+        // build the draft from partitions of the first maxPoaCov reads in parallel
+        std::vector<size_t> indices;
+        std::vector<std::string> seqs;
+        for (size_t i = 0; i < reads.size() && indices.size() < maxPoaCov; ++i) {
+            if (reads[i] == nullptr) continue;
+            indices.emplace_back(i);
+            seqs.emplace_back(reads[i]->Seq);
+        }
+        const auto keys = poa.OrientAndAddReads(seqs, poaThreads, pruning);
+        readKeys->assign(indices.empty() ? 0 : indices.back() + 1, -1);
+        for (size_t j = 0; j < indices.size(); ++j) {
+            const auto read = reads[indices[j]];
+            readKeys->at(indices[j]) = keys[j];
+            if (keys[j] < 0) continue;
+            if (read->Flags & BAM::ADAPTER_BEFORE && read->Flags & BAM::ADAPTER_AFTER) ++nPasses;
+            ++cov;
+        }
+    }
+
+    // reads that did not make it in are made up for by the ones after them
+    for (size_t i = readKeys->size(); i < reads.size() && cov < maxPoaCov; ++i) {
+        const auto read = reads[i];
+        if (converged && read != nullptr) {
+            readKeys->emplace_back(-1);
+            unadded.emplace_back(i);
+            continue;
+        }
         SparsePoa::ReadKey key = (read == nullptr) ? -1 : poa.OrientAndAddRead(read->Seq);
         // SparsePoa::ReadKey key = poa.OrientAndAddRead(read.second->Seq);
         // readKeys->at(read.first) = key;
@@ -361,13 +407,27 @@ std::pair<std::string, size_t> PoaConsensus(const std::vector<const TRead*>& rea
         if (key >= 0) {
             if (read->Flags & BAM::ADAPTER_BEFORE && read->Flags & BAM::ADAPTER_AFTER) ++nPasses;
             if ((++cov) >= maxPoaCov) break;
+            poa.PruneIfDue(pruning);
+            converged = poa.HasConverged(convergence);
         }
     }
+    *poaCoverage = cov;
+    if (graphStats != nullptr) *graphStats = poa.GraphStats();
 
     // at least 50% of the reads should cover
     // TODO(lhepler) revisit this minimum coverage equation
     const size_t minCov = (cov < 5) ? 1 : (cov + 1) / 2 - 1;
-    return std::make_pair(poa.FindConsensus(minCov, &(*summaries))->Sequence, nPasses);
+    const auto pc = poa.FindConsensus(minCov, &(*summaries));
+
+    for (const size_t i : unadded) {
+        const SparsePoa::ReadKey key = poa.MapRead(*pc, reads[i]->Seq, summaries);
+        readKeys->at(i) = key;
+        if (key >= 0 && reads[i]->Flags & BAM::ADAPTER_BEFORE &&
+            reads[i]->Flags & BAM::ADAPTER_AFTER)
+            ++nPasses;
+    }
+
+    return std::make_pair(pc->Sequence, nPasses);
 }
 
 // pass unique_ptr by reference to satisfy finickyness wrt move semantics in <future>
@@ -437,8 +497,21 @@ ResultType<ConsensusType> Consensus(std::unique_ptr<std::vector<TChunk>>& chunks
         std::vector<PoaAlignmentSummary> summaries;
         std::string poaConsensus;
         size_t nPasses = 0;
-        std::tie(poaConsensus, nPasses) =
-            PoaConsensus(reads, &readKeys, &summaries, settings.MaxPoaCoverage);
+        size_t poaCoverage = 0;
+        PacBio::Poa::PoaGraphStats graphStats;
+        std::tie(poaConsensus, nPasses) = PoaConsensus(
+            reads, &readKeys, &summaries, settings.MaxPoaCoverage, settings.PoaConvergence,
+            &poaCoverage, settings.PoaThreads, settings.PoaPruning, &graphStats);
+        if (settings.PoaConvergence.Enabled()) {
+            PBLOG_DEBUG << chunk.Id << ": draft POA of " << poaCoverage << " of " << activeReads
+                        << " subreads";
+        }
+        if (settings.PoaPruning.Enabled()) {
+            PBLOG_DEBUG << chunk.Id << ": draft POA graph of " << graphStats.NumVertices
+                        << " vertices, " << graphStats.NumEdges << " edges (peak "
+                        << graphStats.PeakVertices << " vertices, " << graphStats.PrunedVertices
+                        << " pruned over " << graphStats.Prunings << " prunings)";
+        }
 
         if (poaConsensus.length() < settings.MinLength) {
             result.TooShort += 1;
@@ -463,8 +536,11 @@ ResultType<ConsensusType> Consensus(std::unique_ptr<std::vector<TChunk>>& chunks
                     PolishResult(), chunk.Id, boost::none, poaConsensus, qvs, nPasses, 0, 0,
                     std::vector<double>(1), result.SubreadCounter.ReturnCountsAsArray(),
                     timer.ElapsedMilliseconds(), boost::make_optional(chunk.Reads[0].SignalToNoise),
-                    chunk.Barcodes});
+                    chunk.Barcodes, poaCoverage});
             } else {
+                // one budget for the whole ZMW, shared by both strands if --byStrand
+                PolishBudget budget(settings.MaxMutationsTested, settings.MaxZmwTime);
+
                 const auto mkConsensus = [&](const boost::optional<StrandType> strand) {
                     // give this consensus attempt a name we can refer to
                     std::string chunkName(chunk.Id);
@@ -552,7 +628,23 @@ ResultType<ConsensusType> Consensus(std::unique_ptr<std::vector<TChunk>>& chunks
                         const auto zScores = ai.ZScores();
 
                         // find consensus!!
-                        const PolishResult polishResult = Polish(&ai, PolishConfig());
+                        PolishResult polishResult = Polish(&ai, PolishConfig(), &budget);
+
+                        // then fix up the repeats, if requested
+                        if (settings.PolishRepeats > 0 && polishResult.hasConverged) {
+                            // batch repeat mutations at the same separation as Polish()
+                            RepeatConfig repeatCfg(settings.PolishRepeats);
+                            repeatCfg.MutationSeparation = PolishConfig().MutationSeparation;
+                            polishResult = polishResult + PolishRepeats(&ai, repeatCfg, &budget);
+                        }
+
+                        if (polishResult.budgetExhausted) {
+                            result.ExceededBudget += 1;
+                            result.SubreadCounter.AssignSuccessToOther();
+                            PBLOG_DEBUG << "Skipping " << chunkName
+                                        << ", exceeded polishing budget";
+                            return;
+                        }
 
                         if (!polishResult.hasConverged) {
                             result.NonConvergent += 1;
@@ -563,7 +655,18 @@ ResultType<ConsensusType> Consensus(std::unique_ptr<std::vector<TChunk>>& chunks
 
                         // compute predicted accuracy
                         double predAcc = 0.0;
-                        QualityValues qvs = ConsensusQVs(ai);
+                        const QvConfig qvCfg(settings.SparseQvDisagreement, 3,
+                                             settings.SparseQvCap);
+                        QualityValues qvs = ConsensusQVs(ai, &budget, qvCfg);
+
+                        if (budget.IsExhausted()) {
+                            result.ExceededBudget += 1;
+                            result.SubreadCounter.AssignSuccessToOther();
+                            PBLOG_DEBUG << "Skipping " << chunkName
+                                        << ", exceeded polishing budget computing QVs";
+                            return;
+                        }
+
                         for (const int qv : qvs.Qualities) {
                             predAcc += pow(10.0, static_cast<double>(qv) / -10.0);
                         }
@@ -580,12 +683,13 @@ ResultType<ConsensusType> Consensus(std::unique_ptr<std::vector<TChunk>>& chunks
 
                         // return resulting sequence!!
                         result.Success += 1;
-                        result.emplace_back(ConsensusType{
-                            polishResult, chunk.Id, strand, std::string(ai), std::move(qvs),
-                            nPasses, predAcc, zAvg, zScores,
-                            result.SubreadCounter.ReturnCountsAsArray(),
-                            timer.ElapsedMilliseconds(),
-                            boost::make_optional(chunk.Reads[0].SignalToNoise), chunk.Barcodes});
+                        result.emplace_back(
+                            ConsensusType{polishResult, chunk.Id, strand, std::string(ai),
+                                          std::move(qvs), nPasses, predAcc, zAvg, zScores,
+                                          result.SubreadCounter.ReturnCountsAsArray(),
+                                          timer.ElapsedMilliseconds(),
+                                          boost::make_optional(chunk.Reads[0].SignalToNoise),
+                                          chunk.Barcodes, poaCoverage});
                     } catch (const std::exception& e) {
                         result.ExceptionThrown += 1;
                         PBLOG_ERROR << "Skipping " << chunkName << ", caught exception: '"
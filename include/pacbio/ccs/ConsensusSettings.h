@@ -44,6 +44,7 @@
 #include <pbcopper/logging/Logging.h>
 
 #include <pacbio/data/PlainOption.h>
+#include <pacbio/denovo/SparsePoa.h>
 
 namespace PacBio {
 namespace CCS {
@@ -60,7 +61,9 @@ struct ConsensusSettings
     Logging::LogLevel LogLevel;
     double MaxDropFraction;
     size_t MaxLength;
+    size_t MaxMutationsTested;
     const size_t MaxPoaCoverage = std::numeric_limits<size_t>::max();
+    size_t MaxZmwTime;
     size_t MinLength;
     size_t MinPasses;
     double MinPredictedAccuracy;
@@ -69,13 +72,19 @@ struct ConsensusSettings
     double MinIdentity;
     double MinZScore;
     std::string ModelPath;
+    double ModelSnrResolution;
     std::string ModelSpec;
     bool NoPolish;
+    PacBio::Poa::PoaConvergence PoaConvergence;
+    PacBio::Poa::PoaPruning PoaPruning;
+    size_t PoaThreads;
     size_t PolishRepeats;
     size_t NThreads;
     bool PbIndex;
     std::string ReportFile;
     bool RichQVs;
+    int SparseQvCap;
+    double SparseQvDisagreement;
     std::string WlSpec;
     bool ZmwTimings;
 
@@ -258,5 +258,39 @@ inline std::vector<std::pair<size_t, size_t>> SparseAlign(const size_t qGramSize
     return result;
 }
 
+///
+/// Generate an SDP alignment from a prebuilt index of one sequence and
+/// another sequence, so that the index can be reused across sequences.
+/// The result is the same as SparseAlign(index.Size(), seq1, seq2), with
+/// index built on seq1.
+///
+/// \param[in]  index   The hashed index on the first, or query, sequence
+/// \param[in]  seq2    The second, or reference, sequence
+///
+/// \return A vector of pairs, representing Kmer start positions
+///             that match in the query and reference sequences
+///
+inline std::vector<std::pair<size_t, size_t>> SparseAlign(const PacBio::QGram::Index& index,
+                                                          const std::string& seq2)
+{
+    std::vector<std::pair<size_t, size_t>> result;
+    const auto hits = PacBio::Align::FindSeeds(index, seq2, true);
+    if (hits.empty()) return result;
+
+    // The hits are positioned horizontally on seq2, which was searched for
+    // in the index; transpose them so that they are chained exactly as the
+    // seeds of an index on seq2 searched for seq1 would be.
+    PacBio::Align::Seeds seeds;
+    for (const auto& s : hits.cbegin()->second)
+        seeds.AddSeed(PacBio::Align::Seed(s.BeginPositionV(), s.BeginPositionH(), s.Size()));
+
+    const auto config = PacBio::Align::ChainSeedsConfig{1, 1, 3, -1, -1, -1, INT_MAX};
+    const auto chains = PacBio::Align::ChainSeeds(seeds, config);
+    if (chains.empty()) return result;
+    for (const auto& s : chains[0])
+        result.emplace_back(s.BeginPositionH(), s.BeginPositionV());
+    return result;
+}
+
 }  // namespace CCS
 }  // namespace PacBio
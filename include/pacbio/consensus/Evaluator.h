@@ -127,6 +127,17 @@ public:
 
     void MaskIntervals(size_t radius, double maxErrRate);
 
+    /// Returns the posterior agreement of the read with each site of its
+    /// template, from the alpha and beta matrices (see SiteAgreement).
+    /// The first site is not scored.
+    /// Returns an empty vector if deactivated.
+    std::vector<SiteAgreement> Agreement() const;
+
+    /// Returns the position of the first site of this Evaluator's template
+    /// within the template of its strand.
+    /// Returns 0 if deactivated.
+    size_t TemplateStart() const;
+
     /// Returns the ZScore of this Evaluator's LL, given all Evaluators of
     /// the template.
     /// Returns -INF if deactivated.
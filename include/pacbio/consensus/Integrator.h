@@ -39,8 +39,11 @@
 #include <cstdint>
 #include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <numeric>
+#include <string>
+#include <tuple>
 
 #include <pacbio/consensus/Evaluator.h>
 #include <pacbio/consensus/Mutation.h>
@@ -109,6 +112,12 @@ public:
     std::vector<double> ZScores() const;
     std::vector<std::pair<double, double>> NormalParameters() const;
 
+    /// For each template site, returns the number of active Evaluators
+    /// covering it and the expected number of them disagreeing with it,
+    /// by a mismatch or deletion of the site or by insertions before it,
+    /// as given by their alpha/beta posteriors (see Evaluator::Agreement()).
+    std::vector<std::pair<size_t, double>> SiteDisagreement() const;
+
     /// Given a Mutation of interest, returns a vector of LLs,
     /// one LL per active Evaluator; invalid Evaluators are omitted.
     ///
@@ -168,13 +177,25 @@ protected:
     PacBio::Data::State AddRead(std::unique_ptr<AbstractTemplate>&& tpl,
                                 const PacBio::Data::MappedRead& read);
 
+    void ApplyToSharedTemplates(const std::vector<Mutation>& fwdMuts,
+                                const std::vector<Mutation>& revMuts);
+
+    /// Returns a window onto the template shared by all reads of the same
+    /// strand and model (with SNR), creating it if need be.
     std::unique_ptr<AbstractTemplate> GetTemplate(const PacBio::Data::MappedRead& read);
 
 protected:
+    // strand, model, and SNR (A, C, G, T)
+    using TemplateKey =
+        std::tuple<PacBio::Data::StrandType, std::string, double, double, double, double>;
+
     IntegratorConfig cfg_;
     std::vector<Evaluator> evals_;
     std::string fwdTpl_;
     std::string revTpl_;
+    // each mutation is applied once per shared template, the Evaluators
+    //   only update their windows onto it
+    std::map<TemplateKey, std::shared_ptr<Template>> tpls_;
 
 private:
     /// Return LL for a single Evaluator
@@ -37,18 +37,56 @@
 
 #pragma once
 
+#include <cstddef>
 #include <set>
 #include <string>
 
 namespace PacBio {
 namespace Consensus {
 
+/// Statistics of the process-wide model cache, see ConfigureModelCache.
+struct ModelCacheStats
+{
+    size_t Hits;
+    size_t Misses;
+    size_t Size;
+
+    double HitRate() const
+    {
+        return (Hits + Misses) > 0 ? static_cast<double>(Hits) / (Hits + Misses) : 0.0;
+    }
+};
+
 std::set<std::string> SupportedModels();
 std::set<std::string> SupportedChemistries();
 
 bool OverrideModel(const std::string& model);
 bool UnOverrideModel();
 
+/// Loads the models at path, which is either a JSON model file, a directory
+/// of them, or a model bundle written by CompileModelBundle. Returns the number
+/// of models loaded. Only the header of a JSON model file is read here; the
+/// model is parsed when it is first used, which throws MalformedModelFile if
+/// the rest of the file turns out to be malformed.
 size_t LoadModels(const std::string& path);
+
+/// Parses every model loaded from a JSON model file that has not been used yet,
+/// on up to nThreads threads, for tools that use all of them anyway. Returns
+/// the number of such models, and rethrows the first error parsing any of them.
+size_t MaterializeModels(size_t nThreads = 1);
+
+/// Compiles the JSON model files in modelDir into a single versioned and
+/// checksummed bundle at bundlePath, which LoadModels maps without parsing.
+/// Returns the number of models compiled, and throws ModelError if any model
+/// file is malformed or the bundle cannot be written.
+size_t CompileModelBundle(const std::string& modelDir, const std::string& bundlePath);
+
+/// Configures the process-wide LRU cache of concrete models, keyed by model and SNR,
+/// which also clears it and resets its statistics. With an snrResolution of 0 only
+/// reads of identical SNR share a model; otherwise SNRs are rounded to the nearest
+/// multiple of snrResolution first. A capacity of 0 disables the cache.
+void ConfigureModelCache(double snrResolution, size_t capacity = 1024);
+
+ModelCacheStats ModelCacheStatistics();
 }
 }
@@ -35,18 +35,31 @@
 
 #pragma once
 
+#include <chrono>
+#include <string>
 #include <tuple>
 #include <vector>
 
 #include <pacbio/consensus/Mutation.h>
 #include <pacbio/consensus/PolishResult.h>
+#include <pacbio/data/Read.h>
 
 namespace PacBio {
 namespace Consensus {
 
 // forward declaration
 class Integrator;
-
+struct IntegratorConfig;
+
+/// Besides all single base mutations, Polish() tests expanding and
+/// contracting each homopolymer run by 2 up to MaximumHomopolymerShift bases,
+/// so that runs off by more than one base are corrected in a single iteration;
+/// a MaximumHomopolymerShift of 0 (the default) skips these.
+/// In Diploid mode, ambiguity codes are tested everywhere, or, given a
+/// MinimumDiploidSupport, only at sites where at least that many reads prefer
+/// the same alternative base, see DiploidMutations(). The histograms this
+/// takes count as four tested mutations per site, and are only recomputed
+/// near the mutations applied.
 struct PolishConfig
 {
     size_t MaximumIterations;
@@ -55,17 +68,64 @@ struct PolishConfig
 
     bool Diploid;
 
+    size_t MaximumHomopolymerShift;
+    size_t MinimumDiploidSupport;
+
     PolishConfig(size_t iterations = 40, size_t separation = 10, size_t neighborhood = 20,
-                 bool diploid = false);
+                 bool diploid = false, size_t homopolymerShift = 0, size_t diploidSupport = 0);
 };
 
+/// A MutationSeparation of 0 applies only the single best repeat mutation
+/// per iteration; otherwise, all improving repeat mutations at least
+/// MutationSeparation bases apart are applied at once, as in Polish().
+/// Homopolymer runs of at least MinimumElementCount bases are treated as
+/// repeats of size 1, expanded and contracted by 1 up to
+/// MaximumHomopolymerShift bases; a MaximumHomopolymerShift of 0 skips them.
 struct RepeatConfig
 {
     size_t MaximumRepeatSize;
     size_t MinimumElementCount;
     size_t MaximumIterations;
+    size_t MutationSeparation;
+    size_t MaximumHomopolymerShift;
 
-    RepeatConfig(size_t repeatSize = 3, size_t elementCount = 3, size_t iterations = 40);
+    RepeatConfig(size_t repeatSize = 3, size_t elementCount = 3, size_t iterations = 40,
+                 size_t separation = 0, size_t homopolymerShift = 0);
+};
+
+/// Describes how PolishWindows() splits a template into overlapping windows.
+/// A NThreads of 0 uses all available hardware threads.
+struct WindowConfig
+{
+    size_t WindowSize;
+    size_t WindowOverlap;
+    size_t NThreads;
+
+    WindowConfig(size_t windowSize = 2000, size_t overlap = 200, size_t nThreads = 0);
+};
+
+/// A per-ZMW work budget, shared by Polish(), PolishRepeats() and
+/// ConsensusQVs(). Work is counted in tested mutations, each costing
+/// an alpha/beta extension or fill per Evaluator, and in wall-clock
+/// milliseconds since construction. A limit of 0 is unbounded.
+class PolishBudget
+{
+public:
+    PolishBudget(size_t maxMutationsTested = 0, size_t maxMilliseconds = 0);
+
+    /// Accounts for the given number of tested mutations.
+    /// Returns false once the budget is exhausted.
+    bool Consume(size_t mutationsTested = 1);
+
+    bool IsExhausted() const { return exhausted_; }
+    size_t MutationsTested() const { return mutationsTested_; }
+
+private:
+    size_t maxMutationsTested_;
+    std::chrono::milliseconds maxTime_;
+    std::chrono::steady_clock::time_point start_;
+    size_t mutationsTested_;
+    bool exhausted_;
 };
 
 /// Given an Integrator and a PolishConfig,
@@ -73,9 +133,36 @@ struct RepeatConfig
 /// and return meta information about the procedure.
 ///
 /// The template will be polished within the Integrator.
-PolishResult Polish(Integrator* ai, const PolishConfig& cfg);
+/// If a budget is provided and runs out, polishing stops early,
+/// keeping the template of the last completed round.
+PolishResult Polish(Integrator* ai, const PolishConfig& cfg, PolishBudget* budget = nullptr);
+
+PolishResult PolishRepeats(Integrator* ai, const RepeatConfig& cfg, PolishBudget* budget = nullptr);
+
+/// Given a draft template and the reads mapped onto it,
+/// split the template into overlapping windows and polish each window
+/// in parallel with its own Integrator, holding the reads clipped to
+/// the window. The polished windows are stitched back together at
+/// positions within the overlaps where both neighbours agree.
+///
+/// The template will be replaced by its polished version.
+PolishResult PolishWindows(std::string* tpl, const std::vector<PacBio::Data::MappedRead>& reads,
+                           const IntegratorConfig& integratorCfg, const PolishConfig& polishCfg,
+                           const WindowConfig& windowCfg);
+
+/// Configures the sparse fast path of ConsensusQVs(). Sites covered by at
+/// least MinCoverage active reads, of which at most MaxDisagreement are
+/// expected to disagree with the template (see Integrator::SiteDisagreement()),
+/// skip scoring their alternatives and get a QV of Cap instead.
+/// A MaxDisagreement of 0 disables the fast path.
+struct QvConfig
+{
+    double MaxDisagreement;
+    size_t MinCoverage;
+    int Cap;
 
-PolishResult PolishRepeats(Integrator* ai, const RepeatConfig& cfg);
+    QvConfig(double maxDisagreement = 0.0, size_t minCoverage = 3, int cap = 40);
+};
 
 /// Struct that contains vectors for the base-wise individual and compound QVs.
 struct QualityValues
@@ -90,15 +177,33 @@ struct QualityValues
 std::vector<int> ConsensusQualities(Integrator& ai);
 
 /// Generates individual and compound phred qualities of the current template.
-QualityValues ConsensusQVs(Integrator& ai);
+/// If a budget is provided and runs out, the remaining sites get a QV of 0.
+/// Sites passing the fast path of cfg get its capped QV for all four QVs.
+QualityValues ConsensusQVs(Integrator& ai, PolishBudget* budget = nullptr,
+                           const QvConfig& cfg = QvConfig());
 
 /// Returns a list of all possible mutations that can be applied to the template
 /// of the provided integrator.
 std::vector<Mutation> Mutations(const Integrator& ai, bool diploid = false);
 
+/// Returns the candidate mutations for diploid polishing of the template of
+/// the provided integrator: all haploid mutations, plus the substitutions by
+/// the ambiguity codes pairing the template base with each base that at least
+/// minSupport reads prefer over it (see Integrator::BestMutationHistogram),
+/// and pairing two such bases. Sites already holding an ambiguity code get all
+/// diploid substitutions.
+std::vector<Mutation> DiploidMutations(Integrator& ai, size_t minSupport = 2,
+                                       size_t maxHomopolymerShift = 1);
+
 /// Returns a list of all possible repeat mutations of the template
 /// of the provided integrator
 std::vector<Mutation> RepeatMutations(const Integrator& ai, const RepeatConfig& cfg);
 
+/// Returns the expansions and contractions by 1 up to maxShift bases of all
+/// homopolymer runs of at least minLength bases of the template of the
+/// provided integrator, inserting or deleting at the start of each run.
+std::vector<Mutation> HomopolymerMutations(const Integrator& ai, size_t maxShift,
+                                           size_t minLength = 1);
+
 }  // namespace Consensus
 }  // namespace PacBio
@@ -75,6 +75,8 @@ struct PolishResult
     size_t mutationsTested = 0;
     // How many mutations have been actually applied?
     size_t mutationsApplied = 0;
+    // Did Polish() stop early, because its PolishBudget ran out?
+    bool budgetExhausted = false;
 
     // For each iteration in Polish(), get the max of all Evaluators to
     // diagnose the worst performing one.
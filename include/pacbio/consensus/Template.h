@@ -35,10 +35,12 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -54,6 +56,7 @@ namespace Consensus {
 
 // fwd decl
 class MutatedTemplate;
+class WindowedTemplate;
 class AbstractRecursor;
 class ScaledMatrix;
 
@@ -85,7 +88,8 @@ public:
     virtual double ExpectedLLForEmission(MoveType move, const AlleleRep& prev,
                                          const AlleleRep& curr, MomentType moment) const = 0;
 
-    std::pair<double, double> NormalParameters() const;
+    // the mean and variance of the expected LL
+    virtual std::pair<double, double> NormalParameters() const;
 
 protected:
     AbstractTemplate(size_t start, size_t end, bool pinStart, bool pinEnd);
@@ -94,15 +98,23 @@ protected:
 
     virtual const ModelConfig& Config() const = 0;
 
+    // the parameters of base given its successor next, equivalent to
+    //   Config().Populate({base, next})[0]
+    virtual TemplatePosition ContextParameters(char base, char next) const;
+
+    // the contribution of site i to the expected LL mean and variance
+    std::pair<double, double> SiteNormalParameters(size_t i) const;
+    std::pair<double, double> SiteNormalParameters(const TemplatePosition& params,
+                                                   const AlleleRep& prev) const;
+
     size_t start_;
     size_t end_;
     bool pinStart_;
     bool pinEnd_;
 
 private:
-    std::pair<double, double> SiteNormalParameters(size_t i) const;
-
     friend class MutatedTemplate;
+    friend class WindowedTemplate;
 };
 
 std::ostream& operator<<(std::ostream&, const AbstractTemplate&);
@@ -121,18 +133,83 @@ public:
 
     bool ApplyMutation(const Mutation& mut) override;
 
+    // apply a batch of non-overlapping mutations in a single pass over the
+    // template, repopulating transition parameters only around the edited sites
+    bool ApplyMutations(std::vector<Mutation>* muts) override;
+
     std::unique_ptr<AbstractRecursor> CreateRecursor(const PacBio::Data::MappedRead& mr,
                                                      double scoreDiff) const override;
 
     double ExpectedLLForEmission(MoveType move, const AlleleRep& prev, const AlleleRep& curr,
                                  MomentType moment) const override;
 
+    // O(1), from the cached prefix sums of the per-site contributions
+    std::pair<double, double> NormalParameters() const override;
+
+    // the normal parameters of the window [begin, end) of this template, as
+    // if it were a template on its own, also in O(1)
+    std::pair<double, double> NormalParameters(size_t begin, size_t end) const;
+
 protected:
     const ModelConfig& Config() const override { return *cfg_; }
 
+    TemplatePosition ContextParameters(char base, char next) const override;
+
 private:
+    // splice the per-site contributions in step with an edit replacing
+    //   [b, b + removed) with inserted positions, refreshing the affected sites
+    void UpdateNormalParameters(size_t b, size_t removed, size_t inserted);
+    void UpdatePrefixSums(size_t first);
+
     std::unique_ptr<ModelConfig> cfg_;
+    std::vector<TemplatePosition> ctx_;  // precomputed ACGT dinucleotide contexts
     std::vector<TemplatePosition> tpl_;
+    std::vector<std::pair<double, double>> sites_;   // per-site mean and variance
+    std::vector<std::pair<double, double>> prefix_;  // prefix_[i]: sum of sites_[0, i)
+};
+
+// A window onto a Template shared by several owners, such as all the
+// Evaluators of one strand and model in an Integrator. The window only
+// tracks its [start, end) within the shared template: mutations must be
+// applied to the shared template first, after which ApplyMutation(s) on
+// the window merely updates its mapping, like an unmutated Template would
+class WindowedTemplate : public AbstractTemplate
+{
+public:
+    WindowedTemplate(std::shared_ptr<const Template> master, size_t start, size_t end,
+                     bool pinStart, bool pinEnd);
+
+    WindowedTemplate(WindowedTemplate&&) = default;
+
+    size_t Length() const override;
+    const TemplatePosition& operator[](size_t i) const override
+    {
+        // the last base of the window has no successor, whatever follows in the master
+        if (i + 1 == Length()) return last_;
+        return (*master_)[start_ + i];
+    }
+
+    bool ApplyMutation(const Mutation& mut) override;
+    bool ApplyMutations(std::vector<Mutation>* muts) override;
+
+    std::unique_ptr<AbstractRecursor> CreateRecursor(const PacBio::Data::MappedRead& mr,
+                                                     double scoreDiff) const override;
+
+    double ExpectedLLForEmission(MoveType move, const AlleleRep& prev, const AlleleRep& curr,
+                                 MomentType moment) const override;
+
+    std::pair<double, double> NormalParameters() const override;
+
+protected:
+    const ModelConfig& Config() const override;
+
+    TemplatePosition ContextParameters(char base, char next) const override;
+
+private:
+    bool UpdateWindow(const Mutation& mut);
+
+    std::shared_ptr<const Template> master_;
+    TemplatePosition last_;
 };
 
 // A View projected from some template, allowing for the analysis of a
@@ -164,12 +241,41 @@ public:
 protected:
     const ModelConfig& Config() const override { return master_.Config(); }
 
+    TemplatePosition ContextParameters(char base, char next) const override;
+
 private:
+    // mutations up to this size (plus the base before) do not touch the heap
+    static constexpr size_t InlineCapacity = 8;
+
+    const TemplatePosition& MutatedPosition(size_t i) const
+    {
+        if (mutSize_ <= InlineCapacity)
+            return *reinterpret_cast<const TemplatePosition*>(&mutBuf_[i]);
+        return mutHeap_[i];
+    }
+
+    void SetMutatedPosition(size_t i, const TemplatePosition& pos);
+
     const AbstractTemplate& master_;
     const Mutation mut_;
     const size_t mutStart_;
     const int mutOff_;
-    std::vector<TemplatePosition> mutTpl_;  // params for the context start at the mutation
+    // params for the context starting at the mutation, stored inline when
+    //   they fit and in mutHeap_ otherwise (long insertions, repeats)
+    const size_t mutSize_;
+    std::array<std::aligned_storage<sizeof(TemplatePosition), alignof(TemplatePosition)>::type,
+               InlineCapacity>
+        mutBuf_;
+    std::vector<TemplatePosition> mutHeap_;
+};
+
+// The posterior agreement of a read with a site of its template: the
+//   probability that the site is matched by an identical read base, and
+//   the expected number of read bases inserted before it
+struct SiteAgreement
+{
+    double Match;
+    double Insertion;
 };
 
 // this needs to be here because the unique_ptr deleter for AbstractRecursor must know its size
@@ -192,6 +298,8 @@ public:
     virtual void ExtendBeta(const AbstractTemplate& tpl, const M& beta, size_t endColumn, M& ext,
                             int lengthDiff = 0) const = 0;
     virtual double UndoCounterWeights(size_t nEmissions) const = 0;
+    virtual std::vector<SiteAgreement> Agreement(const AbstractTemplate& tpl, const M& alpha,
+                                                 const M& beta) const = 0;
 
 public:
     PacBio::Data::MappedRead read_;
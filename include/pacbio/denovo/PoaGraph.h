@@ -109,10 +109,31 @@ public:
 
     void PruneGraph(const int minCoverage);
 
+    // Remove the vertices, other than the enter and exit ones, contained
+    // in fewer than minSupport of the reads spanning them, with edges
+    // bridging the paths through them; the coverage of the vertices that
+    // remain is unchanged.  For use while reads are still being added, as
+    // every sequencing error leaves such a vertex.  Returns the number of
+    // vertices removed.
+    size_t PruneUnsupportedVertices(float minSupport);
+
+    // Merge the reads of another graph into this one: the consensus of
+    // other (reverse complemented, if reverse) is aligned to this graph
+    // and threaded into it, and the rest of other's vertices and edges are
+    // carried over as they are, hanging off that thread.  vertexMap
+    // receives, for each vertex of other, the vertex it became here.
+    void MergeGraph(const PoaGraph& other, const PacBio::Align::AlignConfig& config,
+                    bool reverse = false, detail::SdpRangeFinder* rangeFinder = NULL,
+                    std::vector<Vertex>* vertexMap = NULL);
+
     // ----------
 
     size_t NumReads() const;
 
+    // The size of the graph, enter and exit vertices included
+    size_t NumVertices() const;
+    size_t NumEdges() const;
+
     std::string ToGraphViz(int flags = 0, const PoaConsensus* pc = NULL) const;
 
     void WriteGraphVizFile(const std::string& filename, int flags = 0,
@@ -123,6 +144,17 @@ public:
     const PoaConsensus* FindConsensus(const PacBio::Align::AlignConfig& config,
                                       int minCoverage = -INT_MAX) const;
 
+    // The sequence of the consensus, without the copy of the graph that
+    // FindConsensus() makes
+    std::string FindConsensusSequence(const PacBio::Align::AlignConfig& config,
+                                      int minCoverage = -INT_MAX) const;
+
+    // The number of vertices spanned by at least half of the reads that
+    // are contained in, or skipped by, a majority of fewer than minMargin
+    // of the reads spanning them.  Adding reads can only flip whether
+    // the consensus takes such undecided vertices.
+    size_t NumUndecidedVertices(int minMargin) const;
+
 private:
     detail::PoaGraphImpl* impl;
 };
@@ -36,7 +36,6 @@
 #pragma once
 
 #include <cstddef>
-#include <map>
 #include <string>
 #include <utility>
 #include <vector>
@@ -70,7 +69,9 @@ class PoaGraphImpl;
 class SdpRangeFinder
 {
 private:
-    std::map<PoaGraph::Vertex, std::pair<int, int>> alignableReadIntervalByVertex_;
+    // alignable read interval of each vertex, by its position in the
+    // topological order of the graph
+    std::vector<std::pair<int, int>> alignableReadIntervals_;
 
 public:
     virtual ~SdpRangeFinder();
@@ -79,13 +80,14 @@ public:
                          const std::vector<PoaGraph::Vertex>& consensusPath,
                          const std::string& consensusSequence, const std::string& readSequence);
 
-    // TODO: write contract
-    std::pair<int, int> FindAlignableRange(PoaGraph::Vertex v);
+    // The range of read positions to align to the vertex at sortedIndex in
+    // the topological order of the graph given to InitRangeFinder
+    std::pair<int, int> FindAlignableRangeAt(size_t sortedIndex) const;
 
 protected:
     // TODO: write contract
     virtual SdpAnchorVector FindAnchors(const std::string& consensusSequence,
-                                        const std::string& readSequence) const = 0;
+                                        const std::string& readSequence) = 0;
 };
 
 }  // namespace detail
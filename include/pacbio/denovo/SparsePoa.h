@@ -52,6 +52,10 @@ namespace Consensus {
 class ScoredMutation;
 }  // namespace Consensus
 
+namespace QGram {
+class Index;
+}  // namespace QGram
+
 namespace Poa {
 // fwd decls
 class PoaGraph;
@@ -61,9 +65,23 @@ using PoaGraph = PacBio::Poa::PoaGraph;
 
 class SdpRangeFinder : public PacBio::Poa::detail::SdpRangeFinder
 {
+public:
+    SdpRangeFinder();
+    ~SdpRangeFinder();
+
+    // How many times a consensus has been indexed
+    size_t NumIndexBuilds() const { return numIndexBuilds_; }
+
 protected:
-    virtual PacBio::Poa::detail::SdpAnchorVector FindAnchors(
-        const std::string& consensusSequence, const std::string& readSequence) const final;
+    virtual PacBio::Poa::detail::SdpAnchorVector FindAnchors(const std::string& consensusSequence,
+                                                             const std::string& readSequence) final;
+
+private:
+    // k-mer index of the last consensus anchored against, kept until the
+    // consensus changes
+    std::string indexedConsensus_;
+    std::unique_ptr<PacBio::QGram::Index> consensusIndex_;
+    size_t numIndexBuilds_ = 0;
 };
 
 //
@@ -93,6 +111,62 @@ struct PoaAlignmentOptions
     bool ClipEnd;
 };
 
+//
+// When the consensus of a SparsePoa counts as converged: for each of the
+// last StableReads reads added, at most MaxUndecided per consensus base
+// of the vertices spanned by half of the reads were decided by a majority
+// of fewer than MinMargin reads (PoaGraph::NumUndecidedVertices()), and
+// the consensus moved by at most as many edits as there are of those.
+// Sites left undecided are the ones polishing settles anyway.  StableReads
+// 0 disables this.
+//
+struct PoaConvergence
+{
+    size_t StableReads;
+    int MinMargin;
+    float MaxUndecided;
+
+    PoaConvergence(size_t stableReads = 0, int minMargin = 4, float maxUndecided = 0.01f)
+        : StableReads{stableReads}, MinMargin{minMargin}, MaxUndecided{maxUndecided}
+    {
+    }
+
+    bool Enabled() const { return StableReads > 0; }
+};
+
+//
+// When a SparsePoa prunes its graph as reads are added (PruneIfDue()):
+// once MinReads reads are in, and then every ReadInterval reads, the
+// vertices contained in fewer than MinSupport of the reads spanning them
+// are removed (PoaGraph::PruneUnsupportedVertices()).  MinReads 0
+// disables this.
+//
+struct PoaPruning
+{
+    size_t MinReads;
+    size_t ReadInterval;
+    float MinSupport;
+
+    PoaPruning(size_t minReads = 0, float minSupport = 0.2f, size_t readInterval = 4)
+        : MinReads{minReads}, ReadInterval{readInterval}, MinSupport{minSupport}
+    {
+    }
+
+    bool Enabled() const { return MinReads > 0; }
+};
+
+//
+// The size of the graph of a SparsePoa, and what pruning took off it
+//
+struct PoaGraphStats
+{
+    size_t NumVertices;
+    size_t NumEdges;
+    size_t PeakVertices;  // the most vertices the graph has had
+    size_t PrunedVertices;
+    size_t Prunings;
+};
+
 //
 // Partial order aligner with parsimonious memory usage
 //
@@ -117,12 +191,66 @@ public:
                     float minScoreToAdd = 0);
 
     //
-    // Find better orientation, (fwd or RC) and add as such
+    // Find better orientation, (fwd or RC) and add as such.  The
+    // orientation is taken from the k-mers the read shares with the
+    // current consensus; only if those are inconclusive is the read
+    // aligned both ways, keeping the better scoring one.
     //
     ReadKey OrientAndAddRead(const std::string& readSequence,
                              const PoaAlignmentOptions& alnOptions = PoaAlignmentOptions(),
                              float minScoreToAdd = 0);
 
+    //
+    // Orient and add reads as OrientAndAddRead() does, but progressively:
+    // the reads are split into up to nThreads runs of at least
+    // MinPartitionReads consecutive reads, a POA of each run is built in
+    // parallel, each pruned on its own per pruning as reads are added, and
+    // these are merged pairwise, in parallel rounds, into this one.  Up to
+    // nThreads threads are started for this.  Returns the key of each read.
+    //
+    std::vector<ReadKey> OrientAndAddReads(
+        const std::vector<std::string>& readSequences, size_t nThreads,
+        const PoaPruning& pruning = PoaPruning(),
+        const PoaAlignmentOptions& alnOptions = PoaAlignmentOptions(), float minScoreToAdd = 0);
+
+    static constexpr size_t MinPartitionReads = 4;
+
+    //
+    // Merge the reads of another POA into this one (PoaGraph::MergeGraph()),
+    // its consensus oriented as OrientAndAddRead() orients a read.  The
+    // reads of other follow the ones here, in order: the key of read k of
+    // other becomes k plus the key returned.  GraphStats() takes in the
+    // prunings of other.
+    //
+    ReadKey Merge(const SparsePoa& other);
+
+    //
+    // Align a read that is not in the graph against a consensus returned
+    // by FindConsensus() alone, a single path much cheaper to align to
+    // than the graph, orienting it as OrientAndAddRead() does.  Its
+    // summary relative to that consensus is appended to summaries; the
+    // key returned is its index there, or -1 if it did not align.  The
+    // graph is left as is.
+    //
+    ReadKey MapRead(const PacBio::Poa::PoaConsensus& consensus, const std::string& readSequence,
+                    std::vector<PoaAlignmentSummary>* summaries, float minScoreToAdd = 0);
+
+    //
+    // Whether the consensus has converged; to be called after each read
+    // added, as the reads it was stable over are counted here
+    //
+    bool HasConverged(const PoaConvergence& convergence) const;
+
+    //
+    // Prune the graph if the policy has it due; to be called after each
+    // read added.  Returns the number of vertices removed.  The paths of
+    // the reads keep the ids of the vertices removed, which are never
+    // reused, so they just no longer follow the consensus there.
+    //
+    size_t PruneIfDue(const PoaPruning& pruning);
+
+    PoaGraphStats GraphStats() const;
+
     //
     // Walk the POA and get the optimal consensus path
     //
@@ -151,6 +279,9 @@ public:
 private:
     void repCheck();
 
+    // The LOCAL consensus of the graph as it stands
+    const std::string& currentConsensus() const;
+
 private:
     using Path = std::vector<PoaGraph::Vertex>;
 
@@ -158,6 +289,16 @@ private:
     std::vector<Path> readPaths_;
     std::vector<bool> reverseComplemented_;
     SdpRangeFinder* rangeFinder_;
+
+    mutable std::string consensus_;
+    mutable size_t consensusReads_;  // NumReads() consensus_ is for, or -1 if stale
+    mutable std::string checkedConsensus_;
+    mutable size_t checkedReads_;  // NumReads() at the last HasConverged()
+    mutable size_t stableReads_;
+    size_t prunedReads_;  // NumReads() at the last PruneIfDue() pruning
+    size_t peakVertices_;
+    size_t prunedVertices_;
+    size_t prunings_;
 };
 
 }  // namespace Poa
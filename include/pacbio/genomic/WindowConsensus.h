@@ -0,0 +1,100 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <pacbio/consensus/Integrator.h>
+#include <pacbio/consensus/Polish.h>
+#include <pacbio/consensus/PolishResult.h>
+#include <pacbio/data/Read.h>
+
+namespace PacBio {
+namespace Genomic {
+
+/// A difference between a reference window and its consensus.
+/// Positions are relative to the template the window was polished on;
+/// an insertion has RefStart == RefEnd and is placed before RefStart.
+struct Variant
+{
+    size_t RefStart;
+    size_t RefEnd;
+    std::string RefBases;
+    std::string AltBases;
+    // phred-scaled confidence, from the consensus QVs around the variant
+    int Confidence;
+    // number of reads spanning the variant
+    size_t Coverage;
+};
+
+/// Windows covered by fewer than MinCoverage reads, or whose template holds
+/// bases other than ACGT, are not polished, but emitted as lowercase reference
+/// with a QV of 0.
+/// Variants need at least MinCoverage reads and MinConfidence to be reported,
+/// the consensus sequence is unaffected by this.
+struct WindowConsensusConfig
+{
+    size_t MinCoverage;
+    int MinConfidence;
+    Consensus::IntegratorConfig Integrator;
+    Consensus::PolishConfig Polish;
+
+    WindowConsensusConfig(size_t minCoverage = 5, int minConfidence = 40);
+};
+
+/// The consensus of a reference window, trimmed to the window proper.
+struct WindowConsensus
+{
+    std::string Sequence;
+    std::vector<int> Qualities;
+    std::vector<Variant> Variants;
+    // number of reads the window was polished with
+    size_t Coverage = 0;
+    Consensus::PolishResult Result;
+};
+
+/// Polishes the template, a reference window [start, end) with flanks on either
+/// side, using the reads mapped onto it. The consensus is aligned back to the
+/// template; consensus bases and variants anchored within [start, end) are
+/// returned, so that windows polished with overlapping flanks can be
+/// concatenated.
+WindowConsensus ConsensusForWindow(const std::string& tpl, size_t start, size_t end,
+                                   const std::vector<Data::MappedRead>& reads,
+                                   const WindowConsensusConfig& cfg = WindowConsensusConfig());
+
+}  // namespace Genomic
+}  // namespace PacBio
@@ -91,6 +91,20 @@ const PlainOption MaxDropFraction{
     "Maximum fraction of subreads that can be dropped before giving up.",
     CLI::Option::FloatType(0.34)
 };
+const PlainOption MaxMutationsTested{
+    "max_mutations_tested",
+    { "maxMutationsTested" },
+    "Maximum Mutations Tested",
+    "Maximum number of mutations to test while polishing a ZMW. 0 disables this limit.",
+    CLI::Option::IntType(0)
+};
+const PlainOption MaxZmwTime{
+    "max_zmw_time",
+    { "maxZmwTime" },
+    "Maximum ZMW Time",
+    "Maximum wall clock time in milliseconds to spend polishing a ZMW. 0 disables this limit.",
+    CLI::Option::IntType(0)
+};
 const PlainOption NoPolish{
     "no_polish",
     { "noPolish" },
@@ -112,6 +126,50 @@ const PlainOption PolishRepeats{
     "Polish repeats of 2 to N bases of 3 or more elements.",
     CLI::Option::IntType(0)
 };
+const PlainOption PoaStableReads{
+    "poa_stable_reads",
+    { "poaStableReads" },
+    "POA Stable Reads",
+    "Stop adding subreads to the draft POA once its consensus has been settled, but for sites "
+    "short of --poaMinMargin, over this many subreads; the rest are only mapped to the draft. 0 "
+    "adds them all.",
+    CLI::Option::IntType(0)
+};
+const PlainOption PoaMinMargin{
+    "poa_min_margin",
+    { "poaMinMargin" },
+    "POA Minimum Margin",
+    "Majority, in subreads, by which a draft POA vertex must be decided to count as settled under "
+    "--poaStableReads.",
+    CLI::Option::IntType(4)
+};
+const PlainOption PoaPruneReads{
+    "poa_prune_reads",
+    { "poaPruneReads" },
+    "POA Prune Reads",
+    "Once this many subreads are in the draft POA, prune the vertices contained in fewer than "
+    "--poaMinSupport of the subreads spanning them, and again every 4 subreads. With "
+    "--poaThreads > 1, each partition of the subreads is pruned so on its own. 0 disables "
+    "pruning.",
+    CLI::Option::IntType(0)
+};
+const PlainOption PoaMinSupport{
+    "poa_min_support",
+    { "poaMinSupport" },
+    "POA Minimum Support",
+    "Fraction of the subreads spanning a draft POA vertex that must contain it for it to survive "
+    "--poaPruneReads.",
+    CLI::Option::FloatType(0.2)
+};
+const PlainOption PoaThreads{
+    "poa_threads",
+    { "poaThreads" },
+    "POA Threads",
+    "Build the draft POA of a ZMW from up to this many partitions of its subreads in parallel, "
+    "merged progressively. Each ZMW starts up to this many threads of its own, on top of "
+    "--numThreads. Ignored with --poaStableReads.",
+    CLI::Option::IntType(1)
+};
 const PlainOption MinReadScore{
     "min_read_score",
     { "minReadScore" },
@@ -170,6 +228,21 @@ const PlainOption LogFile{
     "Log to a file, instead of STDERR.",
     CLI::Option::StringType("")
 };
+const PlainOption SparseQvDisagreement{
+    "sparse_qv_disagreement",
+    { "sparseQvDisagreement" },
+    "Sparse QV Disagreement",
+    "Assign --sparseQvCap to sites whose reads disagree less than this instead of scoring them. "
+    "0 disables this.",
+    CLI::Option::FloatType(0.0)
+};
+const PlainOption SparseQvCap{
+    "sparse_qv_cap",
+    { "sparseQvCap" },
+    "Sparse QV Cap",
+    "QV assigned to sites skipped by --sparseQvDisagreement.",
+    CLI::Option::IntType(40)
+};
 const PlainOption RichQVs{
     "rich_qvs",
     { "richQVs" },
@@ -191,6 +264,13 @@ const PlainOption ModelSpec{
     "Name of chemistry or model to use, overriding default selection.",
     CLI::Option::StringType("")
 };
+const PlainOption ModelSnrResolution{
+    "model_snr_resolution",
+    { "modelSnrResolution" },
+    "Model SNR Resolution",
+    "Round SNRs to multiples of this to share models across ZMWs. 0 shares only identical SNRs.",
+    CLI::Option::FloatType(0.0)
+};
 const PlainOption ZmwTimings{
     "zmw_timings",
     { "zmwTimings" },
@@ -210,6 +290,8 @@ ConsensusSettings::ConsensusSettings(const PacBio::CLI::Results& options)
     , LogLevel(options.LogLevel())
     , MaxDropFraction(options[OptionNames::MaxDropFraction])
     , MaxLength(options[OptionNames::MaxLength])
+    , MaxMutationsTested(options[OptionNames::MaxMutationsTested])
+    , MaxZmwTime(options[OptionNames::MaxZmwTime])
     , MinLength(options[OptionNames::MinLength])
     , MinPasses(options[OptionNames::MinPasses])
     , MinPredictedAccuracy(options[OptionNames::MinPredictedAccuracy])
@@ -220,10 +302,18 @@ ConsensusSettings::ConsensusSettings(const PacBio::CLI::Results& options)
                     ? NAN
                     : static_cast<float>(options[OptionNames::MinZScore]))
     , ModelPath(std::forward<std::string>(options[OptionNames::ModelPath]))
+    , ModelSnrResolution(options[OptionNames::ModelSnrResolution])
     , ModelSpec(std::forward<std::string>(options[OptionNames::ModelSpec]))
+    , PoaConvergence(static_cast<size_t>(options[OptionNames::PoaStableReads]),
+                     static_cast<int>(options[OptionNames::PoaMinMargin]))
+    , PoaPruning(static_cast<size_t>(options[OptionNames::PoaPruneReads]),
+                 static_cast<float>(options[OptionNames::PoaMinSupport]))
+    , PoaThreads(std::max(1, static_cast<int>(options[OptionNames::PoaThreads])))
     , PolishRepeats(options[OptionNames::PolishRepeats])
     , ReportFile(std::forward<std::string>(options[OptionNames::ReportFile]))
     , RichQVs(options[OptionNames::RichQVs])
+    , SparseQvCap(options[OptionNames::SparseQvCap])
+    , SparseQvDisagreement(options[OptionNames::SparseQvDisagreement])
     , WlSpec(std::forward<std::string>(options[OptionNames::Zmws]))
     , ZmwTimings(options[OptionNames::ZmwTimings])
 {
@@ -283,16 +373,26 @@ PacBio::CLI::Interface ConsensusSettings::CreateCLI(const std::string& descripti
         OptionNames::MinIdentity,
         OptionNames::MinZScore,
         OptionNames::MaxDropFraction,
+        OptionNames::MaxMutationsTested,
+        OptionNames::MaxZmwTime,
         OptionNames::MinSnr,
         OptionNames::MinReadScore,
         OptionNames::ByStrand,
         OptionNames::NoPolish,
         OptionNames::Polish,
         OptionNames::PolishRepeats,
+        OptionNames::PoaStableReads,
+        OptionNames::PoaMinMargin,
+        OptionNames::PoaPruneReads,
+        OptionNames::PoaMinSupport,
+        OptionNames::PoaThreads,
         OptionNames::RichQVs,
+        OptionNames::SparseQvDisagreement,
+        OptionNames::SparseQvCap,
         OptionNames::ReportFile,
         OptionNames::ModelPath,
         OptionNames::ModelSpec,
+        OptionNames::ModelSnrResolution,
         OptionNames::NumThreads,
         OptionNames::LogFile,
         OptionNames::ZmwTimings
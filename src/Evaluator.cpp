@@ -36,6 +36,7 @@
 #include <cmath>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <pacbio/consensus/Evaluator.h>
 #include <pacbio/exception/InvalidEvaluatorException.h>
@@ -107,16 +108,7 @@ double Evaluator::LL(const Mutation& mut)
         return NEG_DBL_INF;
     }
 
-    // for multi-base mutations, invoke the entire machinery
-    else if (mut.EditDistance() > 1) {
-        boost::optional<MutatedTemplate> mutTpl = impl_->tpl_->Mutate(mut);
-        if (!mutTpl) return NEG_DBL_INF;
-        std::unique_ptr<AbstractTemplate> newTpl(new MutatedTemplate(std::move(*mutTpl)));
-        EvaluatorImpl tmp(std::move(newTpl), impl_->recursor_->read_, impl_->recursor_->scoreDiff_);
-        ll = tmp.LL();
-    }
-
-    // single-base mutations employ the alpha-beta stitching
+    // mutations employ the alpha-beta stitching
     else {
         ll = impl_->LL(mut);
     }
@@ -144,6 +136,18 @@ std::pair<double, double> Evaluator::NormalParameters() const
     return std::make_pair(NEG_DBL_INF, NEG_DBL_INF);
 }
 
+std::vector<SiteAgreement> Evaluator::Agreement() const
+{
+    if (IsValid()) return impl_->Agreement();
+    return {};
+}
+
+size_t Evaluator::TemplateStart() const
+{
+    if (IsValid()) return impl_->tpl_->Start();
+    return 0;
+}
+
 double Evaluator::ZScore() const
 {
     if (IsValid()) return impl_->ZScore();
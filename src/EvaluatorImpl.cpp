@@ -35,6 +35,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -129,9 +130,27 @@ double EvaluatorImpl::LL(const Mutation& mut)
     bool atBegin = mutTpl->MutationStart() < 3;
     bool atEnd = (mutTpl->MutationEnd() + 3) > beta_.Columns();
 
+    // Multi-base mutations are stitched as long as the extension fits the buffer,
+    // else invoke the entire machinery
+    if (mut.EditDistance() > 1) {
+        size_t extendLength;
+        if (atBegin)
+            extendLength = absoluteLinkColumn;
+        else if (atEnd)
+            extendLength = mutTpl->Length() - mutTpl->MutationStart() + 2;
+        else
+            extendLength = absoluteLinkColumn - mutTpl->MutationStart() + mut.IsDeletion();
+
+        if ((atBegin && atEnd) || extendLength > EXTEND_BUFFER_COLUMNS) {
+            std::unique_ptr<AbstractTemplate> newTpl(new MutatedTemplate(std::move(*mutTpl)));
+            EvaluatorImpl tmp(std::move(newTpl), recursor_->read_, recursor_->scoreDiff_);
+            return tmp.LL();
+        }
+    }
+
     if (!atBegin && !atEnd) {
-        const size_t extendLength = 2;
         const size_t extendStartCol = mutTpl->MutationStart() - mut.IsDeletion();
+        const size_t extendLength = absoluteLinkColumn - extendStartCol;
 
         extendBuffer_.SetDirection(ScaledMatrix::FORWARD);
         recursor_->ExtendAlpha(*mutTpl, alpha_, extendStartCol, extendBuffer_, extendLength);
@@ -194,6 +213,11 @@ double EvaluatorImpl::LL() const
            recursor_->UndoCounterWeights(recursor_->read_.Length());
 }
 
+std::vector<SiteAgreement> EvaluatorImpl::Agreement() const
+{
+    return recursor_->Agreement(*tpl_, alpha_, beta_);
+}
+
 std::pair<double, double> EvaluatorImpl::NormalParameters() const
 {
     return tpl_->NormalParameters();
@@ -70,6 +70,8 @@ public:
 
     double ZScore() const;
 
+    std::vector<SiteAgreement> Agreement() const;
+
     bool ApplyMutation(const Mutation& mut);
     bool ApplyMutations(std::vector<Mutation>* muts);
 
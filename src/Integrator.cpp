@@ -240,6 +240,31 @@ std::vector<std::pair<double, double>> Integrator::NormalParameters() const
         [](const Evaluator& eval) { return eval.NormalParameters(); });
 }
 
+std::vector<std::pair<size_t, double>> Integrator::SiteDisagreement() const
+{
+    const size_t len = TemplateLength();
+    std::vector<std::pair<size_t, double>> result(len, std::make_pair(0, 0.0));
+
+    for (const auto& eval : evals_) {
+        if (!eval) continue;
+        const auto agreement = eval.Agreement();
+        const bool forward = eval.Strand() == StrandType::FORWARD;
+        const size_t start = eval.TemplateStart();
+
+        // the first site is not scored; insertions before site i of the
+        //   reverse strand are insertions before site (len - i) forward
+        for (size_t i = 1; i < agreement.size(); ++i) {
+            const size_t pos = start + i;
+            auto& site = result[forward ? pos : len - 1 - pos];
+            ++site.first;
+            site.second += 1.0 - agreement[i].Match;
+            result[forward ? pos : len - pos].second += agreement[i].Insertion;
+        }
+    }
+
+    return result;
+}
+
 void Integrator::MaskIntervals(const size_t radius, const double maxErrRate)
 {
     for (auto& eval : evals_)
@@ -298,6 +323,8 @@ void Integrator::ApplyMutation(const Mutation& fwdMut)
     fwdTpl_ = ::PacBio::Consensus::ApplyMutations(fwdTpl_, &fwdMuts);
     revTpl_ = ::PacBio::Consensus::ApplyMutations(revTpl_, &revMuts);
 
+    ApplyToSharedTemplates(fwdMuts, revMuts);
+
     for (auto& eval : evals_) {
         if (eval.Strand() == StrandType::FORWARD)
             eval.ApplyMutation(fwdMut);
@@ -316,8 +343,12 @@ void Integrator::ApplyMutations(std::vector<Mutation>* fwdMuts)
     for (auto it = fwdMuts->crbegin(); it != fwdMuts->crend(); ++it)
         revMuts.emplace_back(ReverseComplement(*it));
 
+    // the reverse strand is always the reverse complement of the forward one,
+    //   so derive it in a single pass rather than re-applying the batch
     fwdTpl_ = ::PacBio::Consensus::ApplyMutations(fwdTpl_, fwdMuts);
-    revTpl_ = ::PacBio::Consensus::ApplyMutations(revTpl_, &revMuts);
+    revTpl_ = ::PacBio::Data::ReverseComplement(fwdTpl_);
+
+    ApplyToSharedTemplates(*fwdMuts, revMuts);
 
     for (auto& eval : evals_) {
         if (eval.Strand() == StrandType::FORWARD)
@@ -330,27 +361,49 @@ void Integrator::ApplyMutations(std::vector<Mutation>* fwdMuts)
     assert(fwdTpl_ == ::PacBio::Data::ReverseComplement(revTpl_));
 }
 
+void Integrator::ApplyToSharedTemplates(const std::vector<Mutation>& fwdMuts,
+                                        const std::vector<Mutation>& revMuts)
+{
+    for (auto it = tpls_.begin(); it != tpls_.end();) {
+        std::vector<Mutation> muts =
+            (std::get<0>(it->first) == StrandType::FORWARD) ? fwdMuts : revMuts;
+        try {
+            it->second->ApplyMutations(&muts);
+            ++it;
+        } catch (const TemplateTooSmall&) {
+            // the windows onto it will find themselves too small as well,
+            //   invalidating their Evaluators
+            it = tpls_.erase(it);
+        }
+    }
+}
+
 std::unique_ptr<AbstractTemplate> Integrator::GetTemplate(const PacBio::Data::MappedRead& read)
 {
-    const size_t len = read.TemplateEnd - read.TemplateStart;
+    if (read.Strand != StrandType::FORWARD && read.Strand != StrandType::REVERSE)
+        throw std::invalid_argument("read is unmapped!");
+
+    const TemplateKey key{read.Strand,          read.Model,           read.SignalToNoise.A,
+                          read.SignalToNoise.C, read.SignalToNoise.G, read.SignalToNoise.T};
+    auto it = tpls_.find(key);
+    if (it == tpls_.end()) {
+        const std::string& tpl = (read.Strand == StrandType::FORWARD) ? fwdTpl_ : revTpl_;
+        it = tpls_.emplace(key, std::make_shared<Template>(tpl, ModelFactory::Create(read))).first;
+    }
 
     if (read.Strand == StrandType::FORWARD) {
         const size_t start = read.TemplateStart;
         const size_t end = read.TemplateEnd;
 
-        return std::unique_ptr<AbstractTemplate>(new Template(fwdTpl_.substr(start, len),
-                                                              ModelFactory::Create(read), start,
-                                                              end, read.PinStart, read.PinEnd));
-    } else if (read.Strand == StrandType::REVERSE) {
-        const size_t start = revTpl_.size() - read.TemplateEnd;
-        const size_t end = revTpl_.size() - read.TemplateStart;
-
-        return std::unique_ptr<AbstractTemplate>(new Template(revTpl_.substr(start, len),
-                                                              ModelFactory::Create(read), start,
-                                                              end, read.PinEnd, read.PinStart));
+        return std::unique_ptr<AbstractTemplate>(
+            new WindowedTemplate(it->second, start, end, read.PinStart, read.PinEnd));
     }
 
-    throw std::invalid_argument("read is unmapped!");
+    const size_t start = revTpl_.size() - read.TemplateEnd;
+    const size_t end = revTpl_.size() - read.TemplateStart;
+
+    return std::unique_ptr<AbstractTemplate>(
+        new WindowedTemplate(it->second, start, end, read.PinEnd, read.PinStart));
 }
 
 }  // namespace Consensus
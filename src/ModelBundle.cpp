@@ -0,0 +1,294 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "ModelBundle.h"
+
+namespace PacBio {
+namespace Consensus {
+namespace {
+
+using MalformedModelFile = Exception::MalformedModelFile;
+
+constexpr char kMagic[8] = {'P', 'B', 'M', 'O', 'D', 'E', 'L', 'S'};
+constexpr size_t kHeaderSize = 32;
+
+uint64_t Checksum(const char* data, const size_t size)
+{
+    // 64-bit FNV-1a
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+class Reader
+{
+public:
+    Reader(const char* data, const size_t size) : data_{data}, size_{size}, pos_{0} {}
+
+    const char* Take(const size_t n)
+    {
+        if (n > size_ - pos_) throw MalformedModelFile();
+        const char* p = data_ + pos_;
+        pos_ += n;
+        return p;
+    }
+
+    template <typename T>
+    T Read()
+    {
+        T t;
+        std::memcpy(&t, Take(sizeof(T)), sizeof(T));
+        return t;
+    }
+
+    std::string ReadString()
+    {
+        const uint32_t n = Read<uint32_t>();
+        return std::string(Take(n), n);
+    }
+
+    bool Done() const { return pos_ == size_; }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t pos_;
+};
+
+class Writer
+{
+public:
+    template <typename T>
+    void Write(const T& t)
+    {
+        const char* p = reinterpret_cast<const char*>(&t);
+        buf_.insert(buf_.end(), p, p + sizeof(T));
+    }
+
+    void WriteString(const std::string& s)
+    {
+        Write(static_cast<uint32_t>(s.size()));
+        buf_.insert(buf_.end(), s.begin(), s.end());
+    }
+
+    const std::vector<char>& Buffer() const { return buf_; }
+
+private:
+    std::vector<char> buf_;
+};
+
+// collect the leaves of a (nested) JSON array in row-major order
+void Flatten(const boost::property_tree::ptree& pt, std::vector<double>* values)
+{
+    if (pt.empty()) {
+        values->emplace_back(pt.get_value<double>());
+        return;
+    }
+    for (const auto& item : pt)
+        Flatten(item.second, values);
+}
+
+std::vector<std::string> ModelFiles(const std::string& modelDir)
+{
+    std::vector<std::string> paths;
+    DIR* dp = opendir(modelDir.c_str());
+    if (dp == nullptr) throw Exception::ModelError("unable to open model directory: " + modelDir);
+
+    struct dirent* ep;
+    struct stat st;
+    while ((ep = readdir(dp)) != nullptr) {
+        const std::string path = modelDir + '/' + ep->d_name;
+        const size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos || path.substr(dot) != ".json") continue;
+        if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) paths.emplace_back(path);
+    }
+    closedir(dp);
+
+    // keep bundles reproducible regardless of directory order
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+}  // namespace anonymous
+
+constexpr uint32_t ModelBundle::Version;
+
+void ModelParams::Add(const std::string& key, const char* data, const size_t size)
+{
+    if (!params_.emplace(key, std::make_pair(data, size)).second) throw MalformedModelFile();
+}
+
+ModelBundle::ModelBundle(const std::string& path) : data_{nullptr}, size_{0}
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw Exception::ModelError("unable to open model bundle: " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kHeaderSize) {
+        close(fd);
+        throw MalformedModelFile();
+    }
+
+    size_ = st.st_size;
+    void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) throw Exception::ModelError("unable to map model bundle: " + path);
+    data_ = static_cast<const char*>(addr);
+
+    try {
+        Reader header(data_, kHeaderSize);
+        if (std::memcmp(header.Take(sizeof(kMagic)), kMagic, sizeof(kMagic)) != 0 ||
+            header.Read<uint32_t>() != Version)
+            throw MalformedModelFile();
+        const uint32_t nModels = header.Read<uint32_t>();
+        const uint64_t payloadSize = header.Read<uint64_t>();
+        const uint64_t checksum = header.Read<uint64_t>();
+        if (payloadSize != size_ - kHeaderSize ||
+            checksum != Checksum(data_ + kHeaderSize, payloadSize))
+            throw MalformedModelFile();
+
+        Reader payload(data_ + kHeaderSize, payloadSize);
+        models_.reserve(nModels);
+        for (uint32_t i = 0; i < nModels; ++i) {
+            std::string chemistry = payload.ReadString();
+            const ModelForm form(payload.ReadString());
+            models_.emplace_back(Entry{std::move(chemistry), form, ModelParams()});
+            const uint32_t nParams = payload.Read<uint32_t>();
+            for (uint32_t j = 0; j < nParams; ++j) {
+                const std::string key = payload.ReadString();
+                const uint32_t n = payload.Read<uint32_t>();
+                models_.back().Params.Add(key, payload.Take(n * sizeof(double)), n);
+            }
+        }
+        if (!payload.Done()) throw MalformedModelFile();
+    } catch (Exception::ModelNamingError&) {
+        munmap(const_cast<char*>(data_), size_);
+        throw MalformedModelFile();
+    } catch (...) {
+        munmap(const_cast<char*>(data_), size_);
+        throw;
+    }
+}
+
+ModelBundle::~ModelBundle() { munmap(const_cast<char*>(data_), size_); }
+
+bool ModelBundle::IsBundle(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(kMagic)];
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+size_t ModelBundle::Write(const std::string& modelDir, const std::string& path)
+{
+    using boost::property_tree::ptree;
+
+    static const std::string version = "ConsensusModelVersion";
+    static const std::string chemistry = "ChemistryName";
+    static const std::string form = "ModelForm";
+
+    Writer payload;
+    uint32_t nModels = 0;
+
+    for (const auto& file : ModelFiles(modelDir)) {
+        ptree pt;
+        try {
+            read_json(file, pt);
+            if (pt.get<std::string>(version) != "3.0.0") throw MalformedModelFile();
+
+            payload.WriteString(pt.get<std::string>(chemistry));
+            payload.WriteString(ModelForm(pt.get<std::string>(form)));
+            const auto isMetadata = [&](const ptree::value_type& item) {
+                return item.first == version || item.first == chemistry || item.first == form;
+            };
+            uint32_t nMatrices = 0;
+            for (const auto& item : pt)
+                if (!isMetadata(item)) ++nMatrices;
+
+            payload.Write(nMatrices);
+            for (const auto& item : pt) {
+                if (isMetadata(item)) continue;
+                std::vector<double> values;
+                Flatten(item.second, &values);
+                payload.WriteString(item.first);
+                payload.Write(static_cast<uint32_t>(values.size()));
+                for (const double v : values)
+                    payload.Write(v);
+            }
+        } catch (boost::property_tree::ptree_error&) {
+            throw Exception::ModelError("unable to compile model file: " + file);
+        } catch (Exception::ModelNamingError&) {
+            throw Exception::ModelError("unable to compile model file: " + file);
+        } catch (Exception::ModelError&) {
+            throw Exception::ModelError("unable to compile model file: " + file);
+        }
+        ++nModels;
+    }
+
+    const auto& buf = payload.Buffer();
+    Writer header;
+    for (const char c : kMagic)
+        header.Write(c);
+    header.Write(Version);
+    header.Write(nModels);
+    header.Write(static_cast<uint64_t>(buf.size()));
+    header.Write(Checksum(buf.data(), buf.size()));
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(header.Buffer().data(), header.Buffer().size());
+    out.write(buf.data(), buf.size());
+    if (!out) throw Exception::ModelError("unable to write model bundle: " + path);
+
+    return nModels;
+}
+
+}  // namespace Consensus
+}  // namespace PacBio
@@ -0,0 +1,129 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <pacbio/exception/ModelError.h>
+
+#include "ModelNaming.h"
+
+namespace PacBio {
+namespace Consensus {
+
+// A flat view of the numeric parameters of one model, keyed by their
+//   top-level name in the JSON model file, each stored as a run of
+//   doubles in row-major order. The view does not own its data.
+class ModelParams
+{
+public:
+    void Add(const std::string& key, const char* data, size_t size);
+
+    // copy the parameter named key into out, which must be a double
+    //   or a (possibly multidimensional) array of doubles of exactly
+    //   the stored size
+    template <typename T>
+    void Get(const std::string& key, T* out) const
+    {
+        static_assert(std::is_same<typename std::remove_all_extents<T>::type, double>::value,
+                      "model parameters are stored as doubles");
+        const auto it = params_.find(key);
+        if (it == params_.end() || it->second.second * sizeof(double) != sizeof(T))
+            throw Exception::MalformedModelFile();
+        std::memcpy(out, it->second.first, sizeof(T));
+    }
+
+private:
+    std::map<std::string, std::pair<const char*, size_t>> params_;
+};
+
+// A precompiled model bundle, memory-mapped read-only for as long as
+//   the bundle lives. The on-disk layout, in native byte order, is a
+//   32-byte header
+//
+//     char[8] magic "PBMODELS", uint32 version, uint32 model count,
+//     uint64 payload size, uint64 FNV-1a checksum of the payload
+//
+//   followed by the payload, one record per model
+//
+//     string chemistry, string form, uint32 parameter count,
+//     per parameter: string key, uint32 size, size * double
+//
+//   where strings are a uint32 length followed by their bytes.
+class ModelBundle
+{
+public:
+    struct Entry
+    {
+        std::string Chemistry;
+        ModelForm Form;
+        ModelParams Params;
+    };
+
+    static constexpr uint32_t Version = 1;
+
+    // maps and validates the bundle at path, throwing
+    //   MalformedModelFile if it is truncated, of another version, or
+    //   fails its checksum
+    explicit ModelBundle(const std::string& path);
+    ModelBundle(const ModelBundle&) = delete;
+    ModelBundle& operator=(const ModelBundle&) = delete;
+    ~ModelBundle();
+
+    const std::vector<Entry>& Models() const { return models_; }
+
+    // whether the file at path starts with the bundle magic
+    static bool IsBundle(const std::string& path);
+
+    // compile the JSON model files found in modelDir into a bundle
+    //   at path, returning the number of models written
+    static size_t Write(const std::string& modelDir, const std::string& path);
+
+private:
+    const char* data_;
+    size_t size_;
+    std::vector<Entry> models_;
+};
+
+}  // namespace Consensus
+}  // namespace PacBio
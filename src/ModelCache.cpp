@@ -0,0 +1,173 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <pacbio/consensus/ModelConfig.h>
+#include <pacbio/consensus/Template.h>
+
+#include "ModelCache.h"
+#include "ModelFactory.h"
+
+namespace PacBio {
+namespace Consensus {
+namespace {
+
+// A ModelConfig sharing a cached model, which outlives its eviction for as
+//   long as any Template still refers to it
+class SharedModelConfig : public ModelConfig
+{
+public:
+    SharedModelConfig(std::shared_ptr<const ModelConfig> model) : model_{std::move(model)} {}
+
+    std::unique_ptr<AbstractRecursor> CreateRecursor(const PacBio::Data::MappedRead& mr,
+                                                     double scoreDiff) const override
+    {
+        return model_->CreateRecursor(mr, scoreDiff);
+    }
+
+    std::vector<TemplatePosition> Populate(const std::string& tpl) const override
+    {
+        return model_->Populate(tpl);
+    }
+
+    std::pair<Data::Read, std::vector<MoveType>> SimulateRead(
+        std::default_random_engine* const rng, const std::string& tpl,
+        const std::string& readname) const override
+    {
+        return model_->SimulateRead(rng, tpl, readname);
+    }
+
+    double ExpectedLLForEmission(MoveType move, const AlleleRep& prev, const AlleleRep& curr,
+                                 MomentType moment) const override
+    {
+        return model_->ExpectedLLForEmission(move, prev, curr, moment);
+    }
+
+private:
+    std::shared_ptr<const ModelConfig> model_;
+};
+
+}  // namespace anonymous
+
+ModelCache::ModelCache() : snrResolution_{0.0}, capacity_{1024}, hits_{0}, misses_{0} {}
+
+ModelCache& ModelCache::Instance()
+{
+    static ModelCache cache;
+    return cache;
+}
+
+void ModelCache::Configure(const double snrResolution, const size_t capacity)
+{
+    if (!(snrResolution >= 0.0))
+        throw std::invalid_argument("model cache SNR resolution must be non-negative");
+
+    std::lock_guard<std::mutex> lock(m_);
+    snrResolution_ = snrResolution;
+    capacity_ = capacity;
+    hits_ = 0;
+    misses_ = 0;
+    entries_.clear();
+    index_.clear();
+}
+
+SNR ModelCache::Round(const SNR& snr) const
+{
+    if (snrResolution_ == 0.0) return snr;
+
+    // never round down to an SNR of zero
+    const auto round = [this](const double x) {
+        return std::max(1.0, std::round(x / snrResolution_)) * snrResolution_;
+    };
+    return SNR(round(snr.A), round(snr.C), round(snr.G), round(snr.T));
+}
+
+std::unique_ptr<ModelConfig> ModelCache::Create(const std::string& name, const SNR& snr,
+                                                const ModelCreator& creator)
+{
+    std::unique_lock<std::mutex> lock(m_);
+
+    if (capacity_ == 0) {
+        lock.unlock();
+        return creator.Create(snr);
+    }
+
+    const SNR rounded = Round(snr);
+    const Key key{name, rounded.A, rounded.C, rounded.G, rounded.T};
+
+    const auto it = index_.find(key);
+    if (it != index_.end()) {
+        ++hits_;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return std::unique_ptr<ModelConfig>(new SharedModelConfig(it->second->second));
+    }
+
+    // compute the model without holding the lock; should another thread
+    //   get there first, keep theirs
+    ++misses_;
+    lock.unlock();
+    std::shared_ptr<const ModelConfig> model(creator.Create(rounded));
+    lock.lock();
+
+    const auto ins = index_.find(key);
+    if (ins != index_.end())
+        model = ins->second->second;
+    else if (capacity_ > 0) {
+        entries_.emplace_front(key, model);
+        index_.emplace(key, entries_.begin());
+
+        while (entries_.size() > capacity_) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+    }
+
+    return std::unique_ptr<ModelConfig>(new SharedModelConfig(std::move(model)));
+}
+
+ModelCacheStats ModelCache::Statistics() const
+{
+    std::lock_guard<std::mutex> lock(m_);
+    return ModelCacheStats{hits_, misses_, entries_.size()};
+}
+
+}  // namespace Consensus
+}  // namespace PacBio
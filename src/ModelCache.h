@@ -0,0 +1,96 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include <pacbio/consensus/ModelSelection.h>
+#include <pacbio/data/Read.h>
+
+namespace PacBio {
+namespace Consensus {
+
+// forward declarations
+class ModelConfig;
+class ModelCreator;
+
+using SNR = PacBio::Data::SNR;
+
+// A process-wide, thread-safe LRU cache of concrete models keyed by model
+//   name and SNR. Otherwise every read recomputes its model's transition
+//   tables from the SNR, although all reads of a ZMW share one. With a
+//   non-zero SNR resolution, SNRs are rounded to a multiple of it before the
+//   lookup, such that ZMWs of similar SNR share models as well.
+class ModelCache
+{
+public:
+    static ModelCache& Instance();
+
+    void Configure(double snrResolution, size_t capacity);
+
+    // the model created by creator for the (possibly rounded) snr,
+    //   computed only if it is not cached already
+    std::unique_ptr<ModelConfig> Create(const std::string& name, const SNR& snr,
+                                        const ModelCreator& creator);
+
+    ModelCacheStats Statistics() const;
+
+private:
+    using Key = std::tuple<std::string, double, double, double, double>;
+    using Entry = std::pair<Key, std::shared_ptr<const ModelConfig>>;
+
+    ModelCache();
+
+    SNR Round(const SNR& snr) const;
+
+    mutable std::mutex m_;
+    double snrResolution_;
+    size_t capacity_;
+    size_t hits_;
+    size_t misses_;
+    std::list<Entry> entries_;  // most recently used first
+    std::map<Key, std::list<Entry>::iterator> index_;
+};
+
+}  // namespace Consensus
+}  // namespace PacBio
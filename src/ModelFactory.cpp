@@ -35,18 +35,27 @@
 
 // Author: Lance Hepler
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include <sys/stat.h>
+
 #include <boost/optional.hpp>
 
 #include <pacbio/consensus/ModelConfig.h>
 #include <pacbio/exception/StateError.h>
 
+#include "ModelCache.h"
 #include "ModelFactory.h"
+#include "ModelFormFactory.h"
 
 namespace PacBio {
 namespace Consensus {
@@ -74,15 +83,30 @@ size_t Count(const std::string& str, const std::string& delim)
 
 void LoadBundleModels()
 {
-    static bool updatesLoaded = false;
+    // threads creating their first models at once must load the updates
+    // once; $SMRT_CHEMISTRY_BUNDLE_DIR is only read by the first of them, so
+    // that later ones take neither the lock nor getenv()
+    static std::atomic<bool> updatesLoaded(false);
+    static std::mutex m;
+
+    if (updatesLoaded) return;
+
+    std::lock_guard<std::mutex> lock(m);
     if (!updatesLoaded) {
         const char* pth = getenv("SMRT_CHEMISTRY_BUNDLE_DIR");
         if (pth != nullptr && pth[0] != '\0') {
-            if (!LoadModelsFromDirectory(std::string(pth) + "/arrow", ModelOrigin::BUNDLED, true))
+            // prefer a precompiled bundle over the JSON model files
+            const std::string bundle = std::string(pth) + "/arrow.bundle";
+            struct stat st;
+            if (stat(bundle.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+                if (ModelFormFactory::LoadBundle(bundle, ModelOrigin::BUNDLED) == 0)
+                    throw Exception::ModelError("unable to load arrow model bundle: " + bundle);
+            } else if (!LoadModelsFromDirectory(std::string(pth) + "/arrow", ModelOrigin::BUNDLED,
+                                                true))
                 throw Exception::ModelError(
                     std::string("unable to load arrow model updates from: ") + pth);
-            updatesLoaded = true;
         }
+        updatesLoaded = true;
     }
 }
 }
@@ -97,12 +121,18 @@ std::unique_ptr<ModelConfig> ModelFactory::Create(const std::string& name, const
     if (!(model = ModelOverride()))
         if (!(model = Resolve(name))) throw ChemistryNotFound(name);
 
-    const auto& tbl = CreatorTable();
-    const auto it = tbl.find(*model);
-
-    if (it == tbl.end()) throw ChemistryNotFound(name);
+    // creators are never removed from the table, so one found stays valid
+    // once the lock is released
+    const ModelCreator* creator = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(CreatorTableMutex());
+        const auto& tbl = CreatorTable();
+        const auto it = tbl.find(*model);
+        if (it == tbl.end()) throw ChemistryNotFound(name);
+        creator = it->second.get();
+    }
 
-    return it->second->Create(snr);
+    return ModelCache::Instance().Create(*model, snr, *creator);
 }
 
 std::unique_ptr<ModelConfig> ModelFactory::Create(const PacBio::Data::Read& read)
@@ -112,6 +142,7 @@ std::unique_ptr<ModelConfig> ModelFactory::Create(const PacBio::Data::Read& read
 
 bool ModelFactory::Register(const ModelName& name, std::unique_ptr<ModelCreator>&& ctor)
 {
+    std::lock_guard<std::mutex> lock(CreatorTableMutex());
     return CreatorTable().emplace(name, std::move(ctor)).second;
 }
 
@@ -119,6 +150,7 @@ boost::optional<std::string> ModelFactory::Resolve(const std::string& name)
 {
     const std::vector<std::string> forms = ModelForm::Preferences();
     const std::vector<std::string> origins = ModelOrigin::Preferences();
+    std::lock_guard<std::mutex> lock(CreatorTableMutex());
     const auto& tbl = CreatorTable();
     const size_t nParts = Count(name, "::") + 1;
 
@@ -150,6 +182,7 @@ std::set<std::string> ModelFactory::SupportedModels()
     // Load update bundle models before we report anything
     LoadBundleModels();
 
+    std::lock_guard<std::mutex> lock(CreatorTableMutex());
     const auto& tbl = CreatorTable();
     std::set<std::string> result;
     for (const auto& item : tbl)
@@ -157,12 +190,57 @@ std::set<std::string> ModelFactory::SupportedModels()
     return result;
 }
 
+size_t ModelFactory::Materialize(const size_t nThreads)
+{
+    LoadBundleModels();
+
+    // snapshot the lazy creators, which stay put as models are registered
+    std::vector<const LazyModelCreator*> lazy;
+    {
+        std::lock_guard<std::mutex> lock(CreatorTableMutex());
+        for (const auto& item : CreatorTable())
+            if (const auto* creator = dynamic_cast<const LazyModelCreator*>(item.second.get()))
+                lazy.push_back(creator);
+    }
+
+    std::atomic<size_t> next(0);
+    std::exception_ptr exc(nullptr);
+    std::mutex m;
+
+    const auto worker = [&]() {
+        for (size_t i; (i = next++) < lazy.size();) {
+            try {
+                lazy[i]->Materialize();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(m);
+                if (!exc) exc = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(nThreads, lazy.size()); ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+
+    if (exc) std::rethrow_exception(exc);
+    return lazy.size();
+}
+
 std::map<ModelName, std::unique_ptr<ModelCreator>>& ModelFactory::CreatorTable()
 {
     static std::map<ModelName, std::unique_ptr<ModelCreator>> tbl;
     return tbl;
 }
 
+std::mutex& ModelFactory::CreatorTableMutex()
+{
+    static std::mutex m;
+    return m;
+}
+
 boost::optional<std::string>& ModelOverride()
 {
     static boost::optional<std::string> ovr = boost::none;
@@ -39,6 +39,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 
@@ -77,7 +78,8 @@ public:
 
 // A static class containing the map of parameterized models that need
 //   only SNR to become concrete, with methods to create such models,
-//   register models, resolve models, and list available models
+//   register models, resolve models, list available models, and parse
+//   all lazily registered models (see LazyModelCreator) up front
 class ModelFactory
 {
 public:
@@ -86,9 +88,11 @@ public:
     static bool Register(const ModelName& name, std::unique_ptr<ModelCreator>&& ctor);
     static boost::optional<std::string> Resolve(const std::string& name);
     static std::set<std::string> SupportedModels();
+    static size_t Materialize(size_t nThreads);
 
 private:
     static std::map<ModelName, std::unique_ptr<ModelCreator>>& CreatorTable();
+    static std::mutex& CreatorTableMutex();
 };
 
 // The concrete form of ModelCreator, which registers a compiled-in
@@ -35,13 +35,19 @@
 
 // Author: Lance Hepler
 
+#include <cctype>
+#include <fstream>
 #include <map>
+#include <mutex>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include <boost/optional.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <pacbio/consensus/ModelConfig.h>
 #include <pacbio/exception/ModelError.h>
 
 #include "ModelFactory.h"
@@ -56,30 +62,128 @@ std::map<ModelForm, ModelFormCreator*>& ModelFormFactory::CreatorTable()
     return tbl;
 }
 
-bool ModelFormFactory::LoadModel(const std::string& path, const ModelOrigin origin)
+namespace {  // anonymous
+
+// the header fields precede the parameters in model files, so these
+//   leading bytes hold them if anything does
+constexpr size_t HeaderBytes = 4096;
+
+// Reads the string value of key from the leading bytes of a JSON model
+//   file, without parsing the rest of it. Gives up on anything but
+//   the simplest escapes, leaving those files to the full parser
+boost::optional<std::string> HeaderField(const std::string& head, const std::string& key)
+{
+    size_t i = head.find('"' + key + '"');
+    if (i == std::string::npos) return boost::none;
+    i += key.length() + 2;
+
+    const auto skipSpace = [&head, &i]() {
+        while (i < head.length() && std::isspace(static_cast<unsigned char>(head[i])))
+            ++i;
+    };
+
+    skipSpace();
+    if (i >= head.length() || head[i++] != ':') return boost::none;
+    skipSpace();
+    if (i >= head.length() || head[i++] != '"') return boost::none;
+
+    std::string value;
+    for (; i < head.length(); ++i) {
+        if (head[i] == '"') return value;
+        if (head[i] == '\\') {
+            if (++i >= head.length()) break;
+            if (head[i] != '"' && head[i] != '\\' && head[i] != '/') break;
+        }
+        value.push_back(head[i]);
+    }
+
+    return boost::none;
+}
+
+// Parses the whole model file, which must be JSON
+std::unique_ptr<ModelCreator> ParseModel(const std::string& path, const ModelFormCreator& form)
 {
     using boost::property_tree::ptree;
     using boost::property_tree::read_json;
 
     ptree pt;
-
     try {
         read_json(path, pt);
-        // verify we're looking at consensus model parameters
-        std::string version = pt.get<std::string>("ConsensusModelVersion");
-        if (version != "3.0.0") return false;
+    } catch (boost::property_tree::ptree_error&) {
+        throw Exception::MalformedModelFile();
+    }
+    return form.LoadParams(pt);
+}
+
+}  // namespace anonymous
+
+LazyModelCreator::LazyModelCreator(const std::string& path, const ModelFormCreator& form)
+    : path_{path}, form_(form), parsed_{false}
+{
+}
 
-        const std::string chemistry = pt.get<std::string>("ChemistryName");
-        const ModelForm form(pt.get<std::string>("ModelForm"));
+std::unique_ptr<ModelConfig> LazyModelCreator::Create(const SNR& snr) const
+{
+    return Materialize().Create(snr);
+}
 
-        const auto tbl = CreatorTable();
+const ModelCreator& LazyModelCreator::Materialize() const
+{
+    // should parsing throw, parsed_ stays false and the next caller tries again
+    if (!parsed_) {
+        std::lock_guard<std::mutex> lock(parseMutex_);
+        if (!parsed_) {
+            creator_ = ParseModel(path_, form_);
+            parsed_ = true;
+        }
+    }
+    return *creator_;
+}
+
+bool ModelFormFactory::LoadModel(const std::string& path, const ModelOrigin origin)
+{
+    using boost::property_tree::ptree;
+    using boost::property_tree::read_json;
+
+    try {
+        std::string head(HeaderBytes, '\0');
+        {
+            std::ifstream in(path);
+            in.read(&head[0], head.size());
+            head.resize(in.gcount());
+        }
+
+        auto version = HeaderField(head, "ConsensusModelVersion");
+        auto chemistry = HeaderField(head, "ChemistryName");
+        auto formName = HeaderField(head, "ModelForm");
+
+        // fall back to parsing the whole file if its header is elsewhere
+        boost::optional<ptree> pt(boost::none);
+        if (!(version && chemistry && formName)) {
+            pt = ptree();
+            read_json(path, *pt);
+            version = pt->get<std::string>("ConsensusModelVersion");
+            chemistry = pt->get<std::string>("ChemistryName");
+            formName = pt->get<std::string>("ModelForm");
+        }
+
+        // verify we're looking at consensus model parameters
+        if (*version != "3.0.0") return false;
+
+        const ModelForm form(*formName);
+        const auto& tbl = CreatorTable();
         const auto it = tbl.find(form);
 
         if (it == tbl.end()) return false;
 
-        const ModelName name(chemistry, form, origin);
+        const ModelName name(*chemistry, form, origin);
+
+        // register the model now, parse it when it is first used
+        if (!pt)
+            return ModelFactory::Register(
+                name, std::unique_ptr<ModelCreator>(new LazyModelCreator(path, *it->second)));
 
-        return ModelFactory::Register(name, it->second->LoadParams(pt));
+        return ModelFactory::Register(name, it->second->LoadParams(*pt));
     } catch (boost::property_tree::ptree_error&) {
     } catch (Exception::ModelNamingError&) {
     } catch (Exception::ModelError& e) {
@@ -87,6 +191,31 @@ bool ModelFormFactory::LoadModel(const std::string& path, const ModelOrigin orig
     return false;
 }
 
+size_t ModelFormFactory::LoadBundle(const std::string& path, const ModelOrigin origin)
+{
+    try {
+        const ModelBundle bundle(path);
+        const auto& tbl = CreatorTable();
+
+        // validate every model before registering any of them
+        std::vector<std::pair<ModelName, std::unique_ptr<ModelCreator>>> creators;
+        for (const auto& model : bundle.Models()) {
+            const auto it = tbl.find(model.Form);
+            if (it == tbl.end()) return 0;
+            creators.emplace_back(ModelName(model.Chemistry, model.Form, origin),
+                                  it->second->LoadParams(model.Params));
+        }
+
+        size_t nModels = 0;
+        for (auto& creator : creators)
+            if (ModelFactory::Register(creator.first, std::move(creator.second))) ++nModels;
+        return nModels;
+    } catch (Exception::ModelNamingError&) {
+    } catch (Exception::ModelError&) {
+    }
+    return 0;
+}
+
 bool ModelFormFactory::Register(const ModelForm form, ModelFormCreator* ctor)
 {
     return CreatorTable().insert(std::make_pair(form, ctor)).second;
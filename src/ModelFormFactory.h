@@ -37,12 +37,15 @@
 
 #pragma once
 
+#include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 
 #include <boost/property_tree/ptree.hpp>
 
+#include "ModelBundle.h"
 #include "ModelFactory.h"
 #include "ModelNaming.h"
 
@@ -52,15 +55,41 @@ namespace Consensus {
 // this pattern is based on
 // http://blog.fourthwoods.com/2011/06/04/factory-design-pattern-in-c/
 
-// An abstract class defining a single abstract method, LoadParams, for
+// An abstract class defining an abstract method, LoadParams, for
 //   parameterizing a model form yielding a ModelCreator that can be
-//   used to instantiate a concrete model given an SNR (see ModelCreator)
+//   used to instantiate a concrete model given an SNR (see ModelCreator),
+//   either from a parsed JSON model file or from a precompiled bundle
 class ModelFormCreator
 {
 public:
     virtual ~ModelFormCreator() {}
     virtual std::unique_ptr<ModelCreator> LoadParams(
         const boost::property_tree::ptree& pt) const = 0;
+    virtual std::unique_ptr<ModelCreator> LoadParams(const ModelParams& params) const = 0;
+};
+
+// A ModelCreator standing in for a JSON model file of which only the
+//   header naming the model has been read. The file is parsed into the
+//   actual ModelCreator once, by whichever thread first creates a model
+//   from it or calls Materialize, so registering a directory of models
+//   costs little more than listing it
+class LazyModelCreator : public ModelCreator
+{
+public:
+    LazyModelCreator(const std::string& path, const ModelFormCreator& form);
+
+    std::unique_ptr<ModelConfig> Create(const SNR& snr) const override;
+
+    // parse the model file, if that has not happened yet; throws
+    //   MalformedModelFile if it cannot be parsed
+    const ModelCreator& Materialize() const;
+
+private:
+    std::string path_;
+    const ModelFormCreator& form_;
+    mutable std::mutex parseMutex_;
+    mutable std::atomic<bool> parsed_;
+    mutable std::unique_ptr<ModelCreator> creator_;
 };
 
 // A static factory class that holds onto all available model forms,
@@ -68,11 +97,15 @@ public:
 //   by their form name; to register a form within said map; and to load
 //   a model parameter file, find its model form, and insert a
 //   parameterized model into the ModelFactory where it is discoverable
-//   by the rest of the library
+//   by the rest of the library; or to do the same for every model of a
+//   precompiled bundle (see ModelBundle). Model files are registered
+//   lazily (see LazyModelCreator) unless their header cannot be read
+//   without parsing the whole file
 class ModelFormFactory
 {
 public:
     static bool LoadModel(const std::string& path, const ModelOrigin origin);
+    static size_t LoadBundle(const std::string& path, const ModelOrigin origin);
     static bool Register(ModelForm form, ModelFormCreator* ctor);
 
 private:
@@ -97,6 +130,11 @@ public:
     {
         return std::unique_ptr<ModelCreator>(new T(pt));
     }
+
+    virtual std::unique_ptr<ModelCreator> LoadParams(const ModelParams& params) const
+    {
+        return std::unique_ptr<ModelCreator>(new T(params));
+    }
 };
 
 #define REGISTER_MODELFORM(cls) \
@@ -35,6 +35,7 @@
 
 // Author: Lance Hepler
 
+#include <algorithm>
 #include <mutex>
 #include <set>
 #include <string>
@@ -48,6 +49,8 @@
 
 #include <pacbio/consensus/ModelSelection.h>
 
+#include "ModelBundle.h"
+#include "ModelCache.h"
 #include "ModelFactory.h"
 #include "ModelFormFactory.h"
 #include "ModelNaming.h"
@@ -81,6 +84,13 @@ bool UnOverrideModel()
     return true;
 }
 
+void ConfigureModelCache(const double snrResolution, const size_t capacity)
+{
+    ModelCache::Instance().Configure(snrResolution, capacity);
+}
+
+ModelCacheStats ModelCacheStatistics() { return ModelCache::Instance().Statistics(); }
+
 bool LoadModelFromFile(const std::string& path, const ModelOrigin origin)
 {
     struct stat st;
@@ -138,9 +148,21 @@ size_t LoadModels(const std::string& path)
         return 0;
     else if (S_ISDIR(st.st_mode))
         return LoadModelsFromDirectory(path, origin, false).get_value_or(0);
+    else if (S_ISREG(st.st_mode) && ModelBundle::IsBundle(path))
+        return ModelFormFactory::LoadBundle(path, origin);
     else if (S_ISREG(st.st_mode))
         return LoadModelFromFile(path, origin) ? 1 : 0;
     return 0;
 }
+
+size_t MaterializeModels(const size_t nThreads)
+{
+    return ModelFactory::Materialize(std::max<size_t>(1, nThreads));
+}
+
+size_t CompileModelBundle(const std::string& modelDir, const std::string& bundlePath)
+{
+    return ModelBundle::Write(modelDir, bundlePath);
+}
 }
 }
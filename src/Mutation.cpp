@@ -164,19 +164,39 @@ std::ostream& operator<<(std::ostream& out, const ScoredMutation& smut)
 std::string ApplyMutations(const std::string& oldTpl, std::vector<Mutation>* const muts)
 {
     std::sort(muts->begin(), muts->end(), Mutation::SiteComparer);
-    std::vector<Mutation>::const_reverse_iterator it;
 
     if (muts->empty() || oldTpl.empty()) return oldTpl;
 
-    // TODO(lhepler) make this algorithm not (n^2)
-    std::string newTpl(oldTpl);
+    // overlapping mutations depend on the order of application, so apply them
+    //   back to front as before; the common disjoint case is spliced in one pass
+    for (size_t i = 1; i < muts->size(); ++i) {
+        if ((*muts)[i - 1].End() > (*muts)[i].Start()) {
+            std::string newTpl(oldTpl);
+
+            for (auto it = muts->crbegin(); it != muts->crend(); ++it) {
+                if (it->IsInsertion())
+                    newTpl.insert(it->Start(), it->Bases());
+                else
+                    newTpl.replace(it->Start(), it->Length(), it->Bases());
+            }
+
+            return newTpl;
+        }
+    }
+
+    if (muts->back().Start() > oldTpl.length())
+        throw std::out_of_range("mutation starts beyond the template end");
+
+    std::string newTpl;
+    newTpl.reserve(oldTpl.length() + muts->size());
 
-    for (it = muts->crbegin(); it != muts->crend(); ++it) {
-        if (it->IsInsertion())
-            newTpl.insert(it->Start(), it->Bases());
-        else
-            newTpl.replace(it->Start(), it->Length(), it->Bases());
+    size_t i = 0;
+    for (const auto& mut : *muts) {
+        newTpl.append(oldTpl, i, mut.Start() - i);
+        newTpl.append(mut.Bases());
+        i = std::min(mut.End(), oldTpl.length());
     }
+    newTpl.append(oldTpl, i, std::string::npos);
 
     return newTpl;
 }
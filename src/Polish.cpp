@@ -34,13 +34,17 @@
 // SUCH DAMAGE.
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <functional>
+#include <future>
 #include <iterator>
 #include <limits>
 #include <list>
+#include <memory>
 #include <set>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -49,11 +53,15 @@
 
 #include <pbcopper/logging/Logging.h>
 
+#include <pacbio/align/LinearAlignment.h>
 #include <pacbio/consensus/Integrator.h>
 #include <pacbio/consensus/Polish.h>
+#include <pacbio/data/Sequence.h>
+#include <pacbio/data/internal/ConversionFunctions.h>
 #include <pacbio/exception/InvalidEvaluatorException.h>
 
 #include "MutationTracker.h"
+#include "RepeatIndex.h"
 
 using std::list;
 using std::pair;
@@ -64,28 +72,100 @@ using std::vector;
 using std::make_pair;
 using std::tie;
 
+using PacBio::Data::MappedRead;
+using PacBio::Data::StrandType;
+
 namespace PacBio {
 namespace Consensus {
 
 PolishConfig::PolishConfig(const size_t iterations, const size_t separation,
-                           const size_t neighborhood, const bool diploid)
+                           const size_t neighborhood, const bool diploid,
+                           const size_t homopolymerShift, const size_t diploidSupport)
     : MaximumIterations(iterations)
     , MutationSeparation(separation)
     , MutationNeighborhood(neighborhood)
     , Diploid(diploid)
+    , MaximumHomopolymerShift(homopolymerShift)
+    , MinimumDiploidSupport(diploidSupport)
 {
 }
 
 RepeatConfig::RepeatConfig(const size_t repeatSize, const size_t elementCount,
-                           const size_t iterations)
+                           const size_t iterations, const size_t separation,
+                           const size_t homopolymerShift)
     : MaximumRepeatSize{repeatSize}
     , MinimumElementCount{elementCount}
     , MaximumIterations{iterations}
+    , MutationSeparation{separation}
+    , MaximumHomopolymerShift{homopolymerShift}
+{
+}
+
+WindowConfig::WindowConfig(const size_t windowSize, const size_t overlap, const size_t nThreads)
+    : WindowSize{windowSize}, WindowOverlap{overlap}, NThreads{nThreads}
+{
+    if (WindowOverlap >= WindowSize)
+        throw std::invalid_argument("window overlap must be smaller than the window size");
+}
+
+QvConfig::QvConfig(const double maxDisagreement, const size_t minCoverage, const int cap)
+    : MaxDisagreement{maxDisagreement}, MinCoverage{minCoverage}, Cap{cap}
+{
+    if (MaxDisagreement < 0.0) throw std::invalid_argument("negative maximum disagreement");
+}
+
+PolishBudget::PolishBudget(const size_t maxMutationsTested, const size_t maxMilliseconds)
+    : maxMutationsTested_{maxMutationsTested}
+    , maxTime_{maxMilliseconds}
+    , start_{std::chrono::steady_clock::now()}
+    , mutationsTested_{0}
+    , exhausted_{false}
 {
 }
 
+bool PolishBudget::Consume(const size_t mutationsTested)
+{
+    if (exhausted_) return false;
+
+    mutationsTested_ += mutationsTested;
+
+    if ((maxMutationsTested_ > 0 && mutationsTested_ > maxMutationsTested_) ||
+        (maxTime_.count() > 0 && std::chrono::steady_clock::now() - start_ > maxTime_))
+        exhausted_ = true;
+
+    return !exhausted_;
+}
+
+// Appends the expansions and contractions by minShift to maxShift bases of
+// the homopolymer runs of pure bases with at least minLength bases starting
+// within [start, end). Both are applied at the start of the run.
+void HomopolymerMutations(vector<Mutation>* muts, const Integrator& ai, const size_t start,
+                          const size_t end, const size_t minShift, const size_t maxShift,
+                          const size_t minLength = 1)
+{
+    const size_t len = ai.TemplateLength();
+
+    for (size_t i = start; i < end;) {
+        const char base = ai[i];
+        size_t runEnd = i + 1;
+        while (runEnd < len && ai[runEnd] == base)
+            ++runEnd;
+
+        // only the first base of a run straddling the start of the range is ours
+        if ((i == 0 || ai[i - 1] != base) && runEnd - i >= minLength &&
+            std::string("ACGT").find(base) != std::string::npos) {
+            for (size_t k = std::max<size_t>(1, minShift); k <= maxShift; ++k) {
+                muts->emplace_back(Mutation::Insertion(i, string(k, base)));
+                if (k <= runEnd - i) muts->emplace_back(Mutation::Deletion(i, k));
+            }
+        }
+
+        i = runEnd;
+    }
+}
+
 void Mutations(vector<Mutation>* muts, const Integrator& ai, const size_t start, const size_t end,
-               const bool diploid = false)
+               const bool diploid = false, const size_t maxHomopolymerShift = 1)
 {
     const std::vector<char> bases{
         diploid ? std::vector<char>{'A', 'C', 'G', 'T', 'Y', 'R', 'W', 'S', 'K', 'M'}
@@ -134,13 +214,16 @@ void Mutations(vector<Mutation>* muts, const Integrator& ai, const size_t start,
     // homopolymer insertion
     for (const char j : bases)
         if (!containedWithin(last, j)) muts->emplace_back(Mutation::Insertion(end, j));
+
+    // the shifts by a single base are among the above
+    HomopolymerMutations(muts, ai, start, end, 2, maxHomopolymerShift);
 }
 
 vector<Mutation> Mutations(const Integrator& ai, const size_t start, const size_t end,
-                           const bool diploid = false)
+                           const bool diploid = false, const size_t maxHomopolymerShift = 1)
 {
     vector<Mutation> muts;
-    Mutations(&muts, ai, start, end, diploid);
+    Mutations(&muts, ai, start, end, diploid, maxHomopolymerShift);
     return muts;
 }
 
@@ -149,50 +232,107 @@ vector<Mutation> Mutations(const Integrator& ai, const bool diploid)
     return Mutations(ai, 0, ai.TemplateLength(), diploid);
 }
 
-void RepeatMutations(vector<Mutation>* muts, const Integrator& ai, const RepeatConfig& cfg,
-                     const size_t start, const size_t end)
+// Appends the haploid mutations of [start, end), and the diploid
+// substitutions at the sites where at least minSupport reads prefer
+// another base over the template's. If given, alleles caches those
+// bases per site, and is only filled in where unknown. Every histogram
+// computed scores all four substitutions at its site, so it is accounted
+// for as four tested mutations, charged to the budget if given; once that
+// is exhausted, no further histograms are computed. Returns the number of
+// mutations tested.
+size_t DiploidMutations(vector<Mutation>* muts, Integrator& ai, const size_t start,
+                        const size_t end, const size_t minSupport, const size_t maxHomopolymerShift,
+                        vector<boost::optional<string>>* const alleleCache = nullptr,
+                        PolishBudget* const budget = nullptr)
 {
-    if (cfg.MaximumRepeatSize < 2 || cfg.MinimumElementCount <= 0) return;
+    using Data::detail::createAmbiguousBase;
 
-    const string tpl(ai);
+    constexpr size_t histogramCost = 4;
+    size_t mutationsTested = 0;
 
-    for (size_t repeatSize = 2; repeatSize <= cfg.MaximumRepeatSize; ++repeatSize) {
-        for (size_t i = start; i + repeatSize <= end;) {
-            size_t nElem = 1;
+    Mutations(muts, ai, start, end, false, maxHomopolymerShift);
 
-            for (size_t j = i + repeatSize; j + repeatSize <= end; j += repeatSize) {
-                if (tpl.compare(j, repeatSize, tpl, i, repeatSize) == 0)
-                    ++nElem;
-                else
-                    break;
-            }
+    for (size_t i = start; i < end; ++i) {
+        const char curr = ai[i];
 
-            if (nElem >= cfg.MinimumElementCount) {
-                muts->emplace_back(Mutation::Insertion(i, tpl.substr(i, repeatSize)));
-                muts->emplace_back(Mutation::Deletion(i, repeatSize));
-            }
+        // haploid mutations skip the bases an ambiguity code contains,
+        // here we want those and the other codes
+        if (string("ACGT").find(curr) == string::npos) {
+            for (const char j : {'A', 'C', 'G', 'T'})
+                if (Data::detail::ambiguousBaseContainsPureBase(curr, j))
+                    muts->emplace_back(Mutation::Substitution(i, j));
+            for (const char j : {'Y', 'R', 'W', 'S', 'K', 'M'})
+                if (j != curr) muts->emplace_back(Mutation::Substitution(i, j));
+            continue;
+        }
 
-            if (nElem > 1)
-                i += repeatSize * (nElem - 1) + 1;
-            else
-                ++i;
+        // the template base and the bases enough reads prefer over it
+        string alleles(1, curr);
+        if (alleleCache && (*alleleCache)[i]) {
+            alleles += *(*alleleCache)[i];
+        } else {
+            if (budget && !budget->Consume(histogramCost)) continue;
+            mutationsTested += histogramCost;
+
+            for (const auto& bin : ai.BestMutationHistogram(i, MutationType::SUBSTITUTION))
+                if (bin.second >= static_cast<int>(minSupport) && bin.first != curr)
+                    alleles.push_back(bin.first);
+            if (alleleCache) (*alleleCache)[i] = alleles.substr(1);
         }
+
+        for (size_t a = 0; a < alleles.length(); ++a)
+            for (size_t b = a + 1; b < alleles.length(); ++b)
+                muts->emplace_back(
+                    Mutation::Substitution(i, createAmbiguousBase(alleles[a], alleles[b])));
     }
 
-    sort(muts->begin(), muts->end(), Mutation::SiteComparer);
+    return mutationsTested;
 }
 
-vector<Mutation> RepeatMutations(const Integrator& ai, const RepeatConfig& cfg, const size_t start,
-                                 const size_t end)
+vector<Mutation> DiploidMutations(Integrator& ai, const size_t minSupport,
+                                  const size_t maxHomopolymerShift)
 {
     vector<Mutation> muts;
-    RepeatMutations(&muts, ai, cfg, start, end);
+    DiploidMutations(&muts, ai, 0, ai.TemplateLength(), minSupport, maxHomopolymerShift);
     return muts;
 }
 
+// Carries the alleles cached by DiploidMutations() over the applied
+// mutations, sorted by site, to the new template of the given length.
+// Sites within radius of an applied mutation are dropped, to be
+// recomputed, as their histograms may have changed with it.
+void UpdateAlleleCache(vector<boost::optional<string>>* const alleleCache,
+                       const vector<Mutation>& applied, const size_t radius, const size_t newLength)
+{
+    vector<boost::optional<string>> result(newLength);
+    auto it = applied.cbegin();
+    int lengthDiff = 0;
+
+    for (size_t i = 0; i < alleleCache->size(); ++i) {
+        for (; it != applied.cend() && it->End() + radius < i; ++it)
+            lengthDiff += it->LengthDiff();
+        if (it != applied.cend() && it->Start() <= i + radius) continue;
+
+        const size_t j = i + lengthDiff;
+        if (j < newLength) result[j] = std::move((*alleleCache)[i]);
+    }
+
+    *alleleCache = std::move(result);
+}
+
 vector<Mutation> RepeatMutations(const Integrator& ai, const RepeatConfig& cfg)
 {
-    return RepeatMutations(ai, cfg, 0, ai.TemplateLength());
+    if (cfg.MaximumRepeatSize < 2 || cfg.MinimumElementCount <= 0) return {};
+
+    return RepeatIndex(string(ai), cfg.MaximumRepeatSize, cfg.MinimumElementCount).Mutations();
+}
+
+vector<Mutation> HomopolymerMutations(const Integrator& ai, const size_t maxShift,
+                                      const size_t minLength)
+{
+    vector<Mutation> muts;
+    HomopolymerMutations(&muts, ai, 0, ai.TemplateLength(), 1, maxShift, minLength);
+    return muts;
 }
 
 vector<Mutation> BestMutations(list<ScoredMutation>* scoredMuts, const size_t separation)
@@ -218,16 +358,14 @@ vector<Mutation> BestMutations(list<ScoredMutation>* scoredMuts, const size_t se
     return result;
 }
 
-vector<Mutation> NearbyMutations(vector<Mutation>* applied, vector<Mutation>* centers,
-                                 const Integrator& ai, const size_t neighborhood,
-                                 const bool diploid = false)
+// The ranges of the template of length len within neighborhood of the
+// centers, shifted by the applied mutations preceding them
+vector<pair<size_t, size_t>> NearbyRanges(vector<Mutation>* applied, vector<Mutation>* centers,
+                                          const size_t len, const size_t neighborhood)
 {
-    const size_t len = ai.TemplateLength();
     const auto clamp = [len](const int i) { return std::max(0, std::min<int>(len, i)); };
 
-    vector<Mutation> result;
-
-    if (centers->empty()) return result;
+    if (centers->empty()) return {};
 
     sort(applied->begin(), applied->end(), Mutation::SiteComparer);
     sort(centers->begin(), centers->end(), Mutation::SiteComparer);
@@ -267,12 +405,26 @@ vector<Mutation> NearbyMutations(vector<Mutation>* applied, vector<Mutation>* ce
         }
     }
 
-    for (const auto& range : ranges)
-        Mutations(&result, ai, range.first, range.second, diploid);
+    return ranges;
+}
 
+vector<Mutation> NearbyMutations(vector<Mutation>* applied, vector<Mutation>* centers,
+                                 const Integrator& ai, const size_t neighborhood,
+                                 const bool diploid, const size_t maxHomopolymerShift)
+{
+    vector<Mutation> result;
+    for (const auto& range : NearbyRanges(applied, centers, ai.TemplateLength(), neighborhood))
+        Mutations(&result, ai, range.first, range.second, diploid, maxHomopolymerShift);
     return result;
 }
 
+vector<Mutation> NearbyMutations(vector<Mutation>* applied, vector<Mutation>* centers,
+                                 const Integrator& ai, const size_t neighborhood,
+                                 const bool diploid = false)
+{
+    return NearbyMutations(applied, centers, ai, neighborhood, diploid, 1);
+}
+
 // The significance level for the likelihood-ratio test of
 // rejecting the null of having a purely haploid site.
 // We use 0.5%, in order to make strong claims for our discoveries
@@ -280,14 +432,43 @@ vector<Mutation> NearbyMutations(vector<Mutation>* applied, vector<Mutation>* ce
 //   https://www.nature.com/articles/s41562-017-0189-z
 static constexpr const double significanceLevel = 0.005;
 
-PolishResult Polish(Integrator* ai, const PolishConfig& cfg)
+PolishResult Polish(Integrator* ai, const PolishConfig& cfg, PolishBudget* const budget)
 {
-    vector<Mutation> muts = Mutations(*ai, cfg.Diploid);
+    PolishResult result;
+
+    // the candidate mutations within [start, end) of the current template,
+    // the histograms of the diploid prefilter count as tested mutations
+    const bool prefilter = cfg.Diploid && cfg.MinimumDiploidSupport > 0;
+    vector<boost::optional<string>> alleleCache(prefilter ? ai->TemplateLength() : 0);
+    const auto candidates = [ai, &cfg, prefilter, &alleleCache, budget, &result](
+        vector<Mutation>* muts, const size_t start, const size_t end) {
+        if (prefilter)
+            result.mutationsTested +=
+                DiploidMutations(muts, *ai, start, end, cfg.MinimumDiploidSupport,
+                                 cfg.MaximumHomopolymerShift, &alleleCache, budget);
+        else
+            Mutations(muts, *ai, start, end, cfg.Diploid, cfg.MaximumHomopolymerShift);
+    };
+    const auto nearbyCandidates = [ai, &cfg, prefilter, &alleleCache, &candidates](
+        vector<Mutation>* applied, vector<Mutation>* centers) {
+        // only recompute the histograms within MutationSeparation of the
+        // mutations applied, the distance at which Polish() already takes
+        // mutations not to interact
+        if (prefilter)
+            UpdateAlleleCache(&alleleCache, *applied, cfg.MutationSeparation, ai->TemplateLength());
+        vector<Mutation> result;
+        for (const auto& range :
+             NearbyRanges(applied, centers, ai->TemplateLength(), cfg.MutationNeighborhood))
+            candidates(&result, range.first, range.second);
+        return result;
+    };
+
+    vector<Mutation> muts;
+    candidates(&muts, 0, ai->TemplateLength());
     std::hash<string> hashFn;
     size_t oldTpl = hashFn(*ai);
     set<size_t> history = {oldTpl};
 
-    PolishResult result;
     // keep track of the changes to the original template over many rounds
     MutationTracker mutTracker{static_cast<std::string>(*ai)};
 
@@ -333,6 +514,7 @@ PolishResult Polish(Integrator* ai, const PolishConfig& cfg)
                 try {
                     // Get set of possible mutations
                     for (const auto& mut : muts) {
+                        if (budget && !budget->Consume()) break;
                         ++mutationsTested;
                         const double ll = ai->LL(mut);
                         if (ll - LL > (mut.IsDeletion() ? 0 : minImprovementThreshold))
@@ -350,6 +532,12 @@ PolishResult Polish(Integrator* ai, const PolishConfig& cfg)
 
             result.mutationsTested += mutationsTested;
 
+            // out of budget, keep the template of the last round
+            if (budget && budget->IsExhausted()) {
+                result.budgetExhausted = true;
+                return result;
+            }
+
             // take best mutations in separation window, apply them
             muts = BestMutations(&scoredMuts, cfg.MutationSeparation);
         }
@@ -394,7 +582,7 @@ PolishResult Polish(Integrator* ai, const PolishConfig& cfg)
 
             // get the mutations for the next round
             vector<Mutation> applied = {muts.front()};
-            muts = NearbyMutations(&applied, &muts, *ai, cfg.MutationNeighborhood, cfg.Diploid);
+            muts = nearbyCandidates(&applied, &muts);
         } else {
             ai->ApplyMutations(&muts);
             oldTpl = newTpl;
@@ -403,7 +591,7 @@ PolishResult Polish(Integrator* ai, const PolishConfig& cfg)
             diagnostics(ai);
 
             // get the mutations for the next round
-            muts = NearbyMutations(&muts, &muts, *ai, cfg.MutationNeighborhood, cfg.Diploid);
+            muts = nearbyCandidates(&muts, &muts);
         }
 
         // keep track of which templates we've seen
@@ -413,7 +601,8 @@ PolishResult Polish(Integrator* ai, const PolishConfig& cfg)
     return result;
 }
 
-PolishResult PolishRepeats(Integrator* const ai, const RepeatConfig& cfg)
+PolishResult PolishRepeats(Integrator* const ai, const RepeatConfig& cfg,
+                           PolishBudget* const budget)
 {
     PolishResult result;
 
@@ -423,9 +612,23 @@ PolishResult PolishRepeats(Integrator* const ai, const RepeatConfig& cfg)
         result.maxNumFlipFlops.emplace_back(ai->MaxNumFlipFlops());
     };
 
+    if ((cfg.MaximumRepeatSize < 2 && cfg.MaximumHomopolymerShift == 0) ||
+        cfg.MinimumElementCount <= 0) {
+        result.hasConverged = true;
+        return result;
+    }
+
+    // the repeats are indexed once, and then updated along with the template
+    RepeatIndex index(string(*ai), cfg.MaximumRepeatSize, cfg.MinimumElementCount);
+    std::hash<string> hashFn;
+    set<size_t> history = {hashFn(*ai)};
+
     for (size_t i = 0; i < cfg.MaximumIterations; ++i) {
-        const vector<Mutation> muts = RepeatMutations(*ai, cfg);
-        boost::optional<ScoredMutation> bestMut = boost::none;
+        vector<Mutation> muts = index.Mutations();
+        if (cfg.MaximumHomopolymerShift > 0)
+            HomopolymerMutations(&muts, *ai, 0, ai->TemplateLength(), 1,
+                                 cfg.MaximumHomopolymerShift, cfg.MinimumElementCount);
+        list<ScoredMutation> scoredMuts;
         size_t mutationsTested = 0;
         bool hasNewInvalidEvaluator = false;
 
@@ -435,27 +638,48 @@ PolishResult PolishRepeats(Integrator* const ai, const RepeatConfig& cfg)
             hasNewInvalidEvaluator = false;
             try {
                 for (const auto& mut : muts) {
+                    if (budget && !budget->Consume()) break;
+                    ++mutationsTested;
                     const double ll = ai->LL(mut);
-                    if (ll > LL && (!bestMut || bestMut->Score < ll)) bestMut = mut.WithScore(ll);
+                    if (ll > LL) scoredMuts.emplace_back(mut.WithScore(ll));
                 }
             } catch (const Exception::InvalidEvaluatorException& e) {
                 PBLOG_INFO << e.what();
                 hasNewInvalidEvaluator = true;
-                bestMut = boost::none;
+                scoredMuts.clear();
                 mutationsTested = 0;
             }
         } while (hasNewInvalidEvaluator);
 
         result.mutationsTested += mutationsTested;
 
-        if (!bestMut) {
+        if (budget && budget->IsExhausted()) {
+            result.budgetExhausted = true;
+            break;
+        }
+
+        if (scoredMuts.empty()) {
             result.hasConverged = true;
             break;
         }
 
-        std::vector<Mutation> mut = {Mutation(*bestMut)};
-        ai->ApplyMutations(&mut);
-        ++result.mutationsApplied;
+        vector<Mutation> best;
+        if (cfg.MutationSeparation > 0)
+            best = BestMutations(&scoredMuts, cfg.MutationSeparation);
+        else
+            best.emplace_back(
+                *max_element(scoredMuts.begin(), scoredMuts.end(), ScoredMutation::ScoreComparer));
+
+        // same cyclic behavior guard as in Polish(), fall back to the single best mutation
+        if (best.size() > 1) {
+            const Mutation top = best.front();
+            if (history.find(hashFn(ApplyMutations(*ai, &best))) != history.end()) best = {top};
+        }
+
+        ai->ApplyMutations(&best);
+        index.ApplyMutations(best);
+        history.insert(hashFn(*ai));
+        result.mutationsApplied += best.size();
         diagnostics(ai);
     }
 
@@ -464,6 +688,204 @@ PolishResult PolishRepeats(Integrator* const ai, const RepeatConfig& cfg)
 
 namespace {  // anonymous
 
+// number of bases on either side of a stitch point
+// both neighbouring windows have to agree upon
+static constexpr const size_t kStitchAnchor = 8;
+
+struct PolishedWindow
+{
+    // start of the window in the draft template
+    size_t Start = 0;
+    // the polished window
+    string Tpl;
+    // for each draft position of the window, its position in the polished window
+    vector<int> Positions;
+    PolishResult Result;
+};
+
+// Evaluates f(0), ..., f(n - 1) on up to nThreads threads,
+// rethrowing the first exception encountered
+template <typename T, typename F>
+vector<T> ParallelMap(const size_t n, const size_t nThreads, const F& f)
+{
+    vector<T> results(n);
+    std::atomic<size_t> next{0};
+    vector<std::future<void>> workers;
+
+    for (size_t t = 0; t < std::max<size_t>(1, std::min(nThreads, n)); ++t)
+        workers.emplace_back(std::async(std::launch::async, [&]() {
+            for (size_t i = next++; i < n; i = next++)
+                results[i] = f(i);
+        }));
+
+    for (auto& worker : workers)
+        worker.get();
+
+    return results;
+}
+
+// For each position of the read's span on the template, taken in the
+// orientation of the read, returns the corresponding read position
+vector<int> TemplateToReadPositions(const string& tpl, const MappedRead& read)
+{
+    if (read.Strand == StrandType::UNMAPPED || read.TemplateEnd > tpl.length() ||
+        read.TemplateStart >= read.TemplateEnd)
+        return {};
+
+    const string span = tpl.substr(read.TemplateStart, read.TemplateEnd - read.TemplateStart);
+    const std::unique_ptr<Align::PairwiseAlignment> aln(Align::AlignLinear(
+        read.Strand == StrandType::REVERSE ? Data::ReverseComplement(span) : span, read.Seq));
+
+    return Align::TargetToQueryPositions(*aln);
+}
+
+// Clips the read to the template window [start, end), provided it covers
+// at least half of the window. The clipped read is mapped relative to start.
+boost::optional<MappedRead> ClipToWindow(const MappedRead& read, const vector<int>& tplToRead,
+                                         const size_t start, const size_t end)
+{
+    if (tplToRead.empty()) return boost::none;
+
+    const size_t clipStart = std::max(start, read.TemplateStart);
+    const size_t clipEnd = std::min(end, read.TemplateEnd);
+
+    if (clipEnd <= clipStart || 2 * (clipEnd - clipStart) < end - start) return boost::none;
+
+    size_t readStart, readEnd;
+    if (read.Strand == StrandType::FORWARD) {
+        readStart = tplToRead[clipStart - read.TemplateStart];
+        readEnd = tplToRead[clipEnd - read.TemplateStart];
+    } else {
+        readStart = tplToRead[read.TemplateEnd - clipEnd];
+        readEnd = tplToRead[read.TemplateEnd - clipStart];
+    }
+
+    if (readEnd <= readStart) return boost::none;
+
+    // reads running past a window boundary are pinned to it
+    const bool pinStart = read.PinStart || clipStart > read.TemplateStart;
+    const bool pinEnd = read.PinEnd || clipEnd < read.TemplateEnd;
+
+    return MappedRead(
+        Data::Read(
+            read.Name, read.Seq.substr(readStart, readEnd - readStart),
+            vector<uint8_t>(read.IPD.begin() + readStart, read.IPD.begin() + readEnd),
+            vector<uint8_t>(read.PulseWidth.begin() + readStart, read.PulseWidth.begin() + readEnd),
+            read.SignalToNoise, read.Model),
+        read.Strand, clipStart - start, clipEnd - start, pinStart, pinEnd);
+}
+
+// Returns a draft position within the overlap [rhs.Start, overlapEnd) of two
+// neighbouring windows, around which both polished windows agree.
+// Falls back to the middle of the overlap.
+size_t StitchPoint(const PolishedWindow& lhs, const PolishedWindow& rhs, const size_t overlapEnd)
+{
+    const size_t overlapStart = rhs.Start;
+    const size_t mid = (overlapStart + overlapEnd) / 2;
+
+    const auto agrees = [&lhs, &rhs](const size_t pos) {
+        const size_t l = lhs.Positions[pos - lhs.Start];
+        const size_t r = rhs.Positions[pos - rhs.Start];
+        if (l < kStitchAnchor || r < kStitchAnchor) return false;
+        if (l + kStitchAnchor > lhs.Tpl.length() || r + kStitchAnchor > rhs.Tpl.length())
+            return false;
+        return lhs.Tpl.compare(l - kStitchAnchor, 2 * kStitchAnchor, rhs.Tpl, r - kStitchAnchor,
+                               2 * kStitchAnchor) == 0;
+    };
+
+    for (size_t d = 0; overlapStart + d <= mid || mid + d < overlapEnd; ++d) {
+        if (overlapStart + d <= mid && agrees(mid - d)) return mid - d;
+        if (mid + d < overlapEnd && agrees(mid + d)) return mid + d;
+    }
+
+    return mid;
+}
+
+}  // anonymous namespace
+
+PolishResult PolishWindows(string* const tpl, const vector<MappedRead>& reads,
+                           const IntegratorConfig& integratorCfg, const PolishConfig& polishCfg,
+                           const WindowConfig& windowCfg)
+{
+    const size_t len = tpl->length();
+    const size_t step = windowCfg.WindowSize - windowCfg.WindowOverlap;
+    const size_t nThreads = windowCfg.NThreads
+                                ? windowCfg.NThreads
+                                : std::max<size_t>(1, std::thread::hardware_concurrency());
+
+    vector<pair<size_t, size_t>> windows;
+    for (size_t start = 0;; start += step) {
+        const size_t end = std::min(start + windowCfg.WindowSize, len);
+        windows.emplace_back(start, end);
+        if (end == len) break;
+    }
+
+    // align each read to the draft once, to be able to clip it to any window
+    const auto tplToReads = ParallelMap<vector<int>>(
+        reads.size(), nThreads,
+        [tpl, &reads](const size_t i) { return TemplateToReadPositions(*tpl, reads[i]); });
+
+    const auto polishWindow = [&](const size_t w) {
+        size_t start, end;
+        tie(start, end) = windows[w];
+
+        const string draft = tpl->substr(start, end - start);
+        Integrator ai(draft, integratorCfg);
+
+        for (size_t i = 0; i < reads.size(); ++i)
+            if (const auto read = ClipToWindow(reads[i], tplToReads[i], start, end))
+                ai.AddRead(*read);
+
+        PolishedWindow window;
+        window.Start = start;
+        window.Result = Polish(&ai, polishCfg);
+        window.Tpl = string(ai);
+
+        const std::unique_ptr<Align::PairwiseAlignment> aln(Align::AlignLinear(draft, window.Tpl));
+        window.Positions = Align::TargetToQueryPositions(*aln);
+
+        return window;
+    };
+
+    const auto polished = ParallelMap<PolishedWindow>(windows.size(), nThreads, polishWindow);
+
+    // stitch points, in draft coordinates
+    vector<size_t> cuts = {0};
+    for (size_t w = 1; w < polished.size(); ++w)
+        cuts.emplace_back(StitchPoint(polished[w - 1], polished[w], windows[w - 1].second));
+    cuts.emplace_back(len);
+
+    string stitched;
+    vector<DiploidSite> diploidSites;
+    PolishResult result;
+    result.hasConverged = true;
+
+    for (size_t w = 0; w < polished.size(); ++w) {
+        const auto& window = polished[w];
+        const size_t from = (w == 0) ? 0 : window.Positions[cuts[w] - window.Start];
+        const size_t to = (w + 1 == polished.size()) ? window.Tpl.length()
+                                                     : window.Positions[cuts[w + 1] - window.Start];
+
+        stitched.append(window.Tpl, from, to - from);
+        result = result + window.Result;
+
+        // only keep the diploid sites within the stitched part, in draft coordinates
+        for (const auto& site : window.Result.diploidSites) {
+            const int64_t pos = site.pos + window.Start;
+            if (static_cast<int64_t>(cuts[w]) <= pos && pos < static_cast<int64_t>(cuts[w + 1])) {
+                diploidSites.emplace_back(site);
+                diploidSites.back().pos = pos;
+            }
+        }
+    }
+
+    result.diploidSites = std::move(diploidSites);
+    *tpl = std::move(stitched);
+    return result;
+}
+
+namespace {  // anonymous
+
 int ProbabilityToQV(double probability)
 {
     if (probability < 0.0 || probability > 1.0)
@@ -514,7 +936,7 @@ vector<int> ConsensusQualities(Integrator& ai)
     return quals;
 }
 
-QualityValues ConsensusQVs(Integrator& ai)
+QualityValues ConsensusQVs(Integrator& ai, PolishBudget* const budget, const QvConfig& cfg)
 {
     const size_t len = ai.TemplateLength();
     vector<int> quals, delQVs, insQVs, subQVs;
@@ -523,12 +945,28 @@ QualityValues ConsensusQVs(Integrator& ai)
     insQVs.reserve(len);
     subQVs.reserve(len);
     const double LL = ai.LL();
+
+    vector<std::pair<size_t, double>> disagreement;
+    if (cfg.MaxDisagreement > 0.0) disagreement = ai.SiteDisagreement();
+
     for (size_t i = 0; i < len; ++i) {
+        // sites the reads overwhelmingly agree on are capped without scoring
+        if (!disagreement.empty() && disagreement[i].first >= cfg.MinCoverage &&
+            disagreement[i].second <= cfg.MaxDisagreement) {
+            quals.emplace_back(cfg.Cap);
+            delQVs.emplace_back(cfg.Cap);
+            insQVs.emplace_back(cfg.Cap);
+            subQVs.emplace_back(cfg.Cap);
+            continue;
+        }
+
         double qualScoreSum = 0.0, delScoreSum = 0.0, insScoreSum = 0.0, subScoreSum = 0.0;
         for (const auto& m : Mutations(ai, i, i + 1)) {
             // skip mutations that start beyond the current site (e.g. trailing insertions)
             if (m.Start() > i) continue;
 
+            if (budget && !budget->Consume()) break;
+
             // TODO (lhepler): this is dumb, but untestable mutations,
             //   aka insertions at ends, cause all sorts of weird issues
             // See also: Polish::ConsensusQualities(ai)
@@ -555,6 +993,14 @@ QualityValues ConsensusQVs(Integrator& ai)
             else
                 subScoreSum += expScore;
         }
+        // out of budget, this site and all remaining ones are of unknown quality
+        if (budget && budget->IsExhausted()) {
+            quals.resize(len, 0);
+            delQVs.resize(len, 0);
+            insQVs.resize(len, 0);
+            subQVs.resize(len, 0);
+            break;
+        }
         quals.emplace_back(ScoreSumToQV(qualScoreSum));
         delQVs.emplace_back(ScoreSumToQV(delScoreSum));
         insQVs.emplace_back(ScoreSumToQV(insScoreSum));
@@ -44,6 +44,7 @@ PolishResult operator+(const PolishResult& lhs, const PolishResult& rhs)
     result.hasConverged = lhs.hasConverged && rhs.hasConverged;
     result.mutationsTested = lhs.mutationsTested + rhs.mutationsTested;
     result.mutationsApplied = lhs.mutationsApplied + rhs.mutationsApplied;
+    result.budgetExhausted = lhs.budgetExhausted || rhs.budgetExhausted;
     result.maxAlphaPopulated.insert(result.maxAlphaPopulated.end(), lhs.maxAlphaPopulated.begin(),
                                     lhs.maxAlphaPopulated.end());
     result.maxBetaPopulated.insert(result.maxBetaPopulated.end(), lhs.maxBetaPopulated.begin(),
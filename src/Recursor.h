@@ -39,8 +39,11 @@
 
 #include <algorithm>
 #include <climits>
+#include <cmath>
 #include <memory>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 #include <pacbio/consensus/Template.h>
 #include <pacbio/data/Read.h>
@@ -170,6 +173,18 @@ public:
     void ExtendBeta(const AbstractTemplate& tpl, const M& beta, size_t endColumn, M& ext,
                     int lengthDiff = 0) const;
 
+    /// \brief Compute the posterior agreement of the read with each site of
+    ///        the template from the filled alpha and beta matrices.
+    ///
+    /// The match and deletion moves into a column partition all paths, so
+    /// the posterior of a correct match is a ratio of sums within the same
+    /// pair of columns, as in LinkAlphaBeta. The insertion (branch and
+    /// stick) moves within the previous column only need the ratio of its
+    /// beta scale to ours. The first site, pinned to the start of the read,
+    /// is not scored and reported as {0, 0}.
+    std::vector<SiteAgreement> Agreement(const AbstractTemplate& tpl, const M& alpha,
+                                         const M& beta) const;
+
 private:
     std::pair<size_t, size_t> RowRange(size_t j, const M& matrix) const;
 
@@ -495,6 +510,69 @@ double Recursor<Derived>::LinkAlphaBeta(const AbstractTemplate& tpl, const M& al
             beta.GetLogProdScales(betaColumn, beta.Columns()));
 }
 
+template <typename Derived>
+std::vector<SiteAgreement> Recursor<Derived>::Agreement(const AbstractTemplate& tpl, const M& alpha,
+                                                        const M& beta) const
+{
+    const size_t I = read_.Length();
+    const size_t J = tpl.Length();
+
+    assert(alpha.Rows() == I + 1 && alpha.Columns() == J + 1);
+    assert(beta.Rows() == I + 1 && beta.Columns() == J + 1);
+
+    std::vector<SiteAgreement> result(J, SiteAgreement{0.0, 0.0});
+
+    for (size_t j = 2; j <= J; ++j) {
+        const auto& prevTplParams = tpl[j - 2];
+        const auto& currTplParams = tpl[j - 1];
+
+        size_t usedBegin, usedEnd;
+        std::tie(usedBegin, usedEnd) =
+            RangeUnion(alpha.UsedRowRange(j - 2), alpha.UsedRowRange(j - 1),
+                       beta.UsedRowRange(j - 1), beta.UsedRowRange(j));
+
+        double total = 0.0, correct = 0.0, inserted = 0.0;
+        for (size_t i = usedBegin; i < usedEnd; ++i) {
+            const double a = alpha(i, j - 1);
+            if (a == 0.0) continue;
+
+            if (i < I) {
+                // Match into (i + 1, j)
+                const double match =
+                    a * prevTplParams.Match *
+                    static_cast<const Derived*>(this)->EmissionPr(
+                        MoveType::MATCH, emissions_[i], prevTplParams.Idx, currTplParams.Idx) *
+                    beta(i + 1, j);
+                total += match;
+                if (read_.Seq[i] == currTplParams.Base) correct += match;
+
+                // Branch and stick into (i + 1, j - 1), due to pinning not the last read base
+                if (i > 0 && i + 1 < I) {
+                    const double insert = a * (prevTplParams.Branch *
+                                                   static_cast<const Derived*>(this)->EmissionPr(
+                                                       MoveType::BRANCH, emissions_[i],
+                                                       prevTplParams.Idx, currTplParams.Idx) +
+                                               prevTplParams.Stick *
+                                                   static_cast<const Derived*>(this)->EmissionPr(
+                                                       MoveType::STICK, emissions_[i],
+                                                       prevTplParams.Idx, currTplParams.Idx)) *
+                                          beta(i + 1, j - 1);
+                    inserted += insert;
+                }
+            }
+
+            // Delete into (i, j)
+            total += a * prevTplParams.Deletion * beta(i, j);
+        }
+
+        if (total > 0.0)
+            result[j - 1] = {correct / total, inserted / total * std::exp(beta.GetLogScale(j - 1) -
+                                                                          beta.GetLogScale(j))};
+    }
+
+    return result;
+}
+
 /// Note that this method is used EXCLUSIVELY for testing mutations, and so
 /// we don't get the actual parameters and positions from the template, but
 /// we get them after a "virtual" mutation has been applied.
@@ -520,10 +598,13 @@ void Recursor<Derived>::ExtendAlpha(const AbstractTemplate& tpl, const M& alpha,
     size_t maxLeftMovePossible = tpl.Length();
     size_t maxDownMovePossible = read_.Length();
 
-    // completely fill the rectangle bounded by the min and max
+    // completely fill the rectangle bounded by the min and max,
+    // extending to the end of the template covers all remaining columns,
+    // as a deletion there may shorten it by more than a column
+    const bool toEnd = beginColumn + numExtColumns > tpl.Length();
     size_t beginRow, endRow;
     std::tie(beginRow, endRow) = alpha.UsedRowRange(beginColumn);
-    for (size_t j = 1; j + beginColumn < alpha.Columns() && j <= numExtColumns; ++j)
+    for (size_t j = 1; j + beginColumn < alpha.Columns() && (toEnd || j <= numExtColumns); ++j)
         endRow = std::max(alpha.UsedRowRange(j + beginColumn).second, endRow);
 
     for (size_t extCol = 0; extCol < numExtColumns; extCol++) {
@@ -622,6 +703,10 @@ void Recursor<Derived>::ExtendBeta(const AbstractTemplate& tpl, const M& beta, s
     size_t I = read_.Length();
     size_t J = tpl.Length();
 
+    // A deletion may not reach past the last column, so that there is at
+    // least one column to fill
+    assert(static_cast<int>(lastColumn) + lengthDiff >= 0);
+
     // How far back do we have to go until we are at the zero (first) column?
     // we always go all the way back.
     size_t numExtColumns = 1 + lengthDiff + lastColumn;
@@ -631,12 +716,10 @@ void Recursor<Derived>::ExtendBeta(const AbstractTemplate& tpl, const M& beta, s
     // The new template may not be the same length as the old template.
     // Just make sure that we have enough room to fill out the extend buffer
     assert(lastColumn + 1 <= J);
-    assert(lastColumn < 4);  // Since we are only testing mutations of size 1,
-                             // and the check prior for a beginning mutation is
-                             // < 3, max = 2 + 1 = 3
-    assert(ext.Columns() >= numExtColumns);
+    assert(ext.Columns() >= numExtColumns);  // Mutations here start before column 3,
+                                             // and EvaluatorImpl::LL only stitches
+                                             // multi-base ones whose extension fits
     assert(beta.Rows() == I + 1 && ext.Rows() == I + 1);
-    assert(abs(lengthDiff) < 2);
 
     // completely fill the rectangle bounded by the min and max
     int beginRow, endRow;
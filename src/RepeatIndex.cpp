@@ -0,0 +1,151 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "RepeatIndex.h"
+
+namespace PacBio {
+namespace Consensus {
+
+RepeatIndex::RepeatIndex(std::string tpl, const size_t maxRepeatSize, const size_t minElementCount)
+    : tpl_{std::move(tpl)}
+    , maxRepeatSize_{maxRepeatSize}
+    , minElementCount_{std::max<size_t>(2, minElementCount)}
+{
+    for (size_t k = 2; k <= maxRepeatSize_; ++k) {
+        runs_.emplace_back();
+        Scan(k, 0, tpl_.length(), &runs_.back());
+    }
+}
+
+std::vector<Mutation> RepeatIndex::Mutations() const
+{
+    std::vector<Mutation> muts;
+
+    for (size_t k = 2; k <= maxRepeatSize_; ++k) {
+        for (const auto& run : runs_[k - 2]) {
+            const size_t nElem = (run.second - run.first) / k + 1;
+            if (nElem < minElementCount_) continue;
+            muts.emplace_back(Mutation::Insertion(run.first, tpl_.substr(run.first, k)));
+            muts.emplace_back(Mutation::Deletion(run.first, k));
+        }
+    }
+
+    std::sort(muts.begin(), muts.end(), Mutation::SiteComparer);
+
+    return muts;
+}
+
+void RepeatIndex::ApplyMutations(std::vector<Mutation> muts)
+{
+    // apply back to front, so the sites of the remaining mutations stay valid
+    std::sort(muts.begin(), muts.end(), Mutation::SiteComparer);
+    for (auto it = muts.crbegin(); it != muts.crend(); ++it)
+        ApplyMutation(*it);
+}
+
+void RepeatIndex::ApplyMutation(const Mutation& mut)
+{
+    const size_t start = mut.Start();
+    const size_t end = mut.End();
+    const int diff = mut.LengthDiff();
+
+    tpl_.replace(start, mut.Length(), mut.Bases());
+
+    for (size_t k = 2; k <= maxRepeatSize_; ++k) {
+        auto& runs = runs_[k - 2];
+
+        // positions i < end whose pair (i, i + k) overlaps the mutated bases,
+        // all runs touching these, and all runs downstream of the mutation
+        const size_t dirtyStart = (start > k) ? start - k : 0;
+        const auto first =
+            std::lower_bound(runs.begin(), runs.end(), dirtyStart,
+                             [](const Run& run, const size_t pos) { return run.second < pos; });
+        const auto last =
+            std::upper_bound(first, runs.end(), end,
+                             [](const size_t pos, const Run& run) { return pos < run.first; });
+
+        size_t rescanStart = dirtyStart;
+        size_t rescanEnd = end;
+        if (first != last) {
+            rescanStart = std::min(rescanStart, first->first);
+            rescanEnd = std::max(rescanEnd, std::prev(last)->second);
+        }
+        rescanEnd += diff;
+
+        for (auto it = last; it != runs.end(); ++it) {
+            it->first += diff;
+            it->second += diff;
+        }
+
+        std::vector<Run> rescanned;
+        Scan(k, rescanStart, rescanEnd, &rescanned);
+
+        const auto pos = runs.erase(first, last);
+        runs.insert(pos, rescanned.begin(), rescanned.end());
+    }
+}
+
+void RepeatIndex::Scan(const size_t k, size_t start, size_t end, std::vector<Run>* runs) const
+{
+    // extend to the boundaries of the runs overlapping [start, end)
+    while (start > 0 && Matches(start - 1, k))
+        --start;
+    while (Matches(end, k))
+        ++end;
+
+    for (size_t i = start; i < end;) {
+        if (!Matches(i, k)) {
+            ++i;
+            continue;
+        }
+
+        size_t j = i + 1;
+        while (j < end && Matches(j, k))
+            ++j;
+
+        if (j - i >= k) runs->emplace_back(i, j);
+
+        i = j;
+    }
+}
+
+}  // namespace Consensus
+}  // namespace PacBio
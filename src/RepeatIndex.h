@@ -0,0 +1,95 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <pacbio/consensus/Mutation.h>
+
+namespace PacBio {
+namespace Consensus {
+
+/// Index of the tandem repeats of a template with 2 up to maxRepeatSize
+/// bases per element.
+///
+/// For each repeat size k, the index stores the maximal runs of positions
+/// i with tpl[i] == tpl[i + k] that span at least k positions, i.e., the
+/// runs holding at least two elements. The runs are found by a single scan
+/// upon construction; applying mutations only rescans the neighbourhood of
+/// each mutated site.
+class RepeatIndex
+{
+public:
+    /// minElementCount values below 2 are treated as 2
+    RepeatIndex(std::string tpl, size_t maxRepeatSize, size_t minElementCount);
+
+    /// Returns the insertion and deletion of one element at the start of each
+    /// repeat with at least minElementCount elements,
+    /// sorted according to Mutation::SiteComparer.
+    std::vector<Mutation> Mutations() const;
+
+    /// Applies the mutations to the template and updates the index.
+    /// The mutations must not overlap.
+    void ApplyMutations(std::vector<Mutation> muts);
+
+    const std::string& Template() const { return tpl_; }
+
+private:
+    // half-open interval of positions i with tpl[i] == tpl[i + k]
+    using Run = std::pair<size_t, size_t>;
+
+    bool Matches(const size_t i, const size_t k) const
+    {
+        return i + k < tpl_.length() && tpl_[i] == tpl_[i + k];
+    }
+
+    void ApplyMutation(const Mutation& mut);
+
+    // appends the maximal runs of size k intersecting [start, end) to runs
+    void Scan(size_t k, size_t start, size_t end, std::vector<Run>* runs) const;
+
+private:
+    std::string tpl_;
+    size_t maxRepeatSize_;
+    size_t minElementCount_;
+    // runs_[k - 2] holds the sorted runs of repeat size k
+    std::vector<std::vector<Run>> runs_;
+};
+
+}  // namespace Consensus
+}  // namespace PacBio
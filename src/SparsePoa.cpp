@@ -36,7 +36,11 @@
 // Author: Lance Hepler
 
 #include <algorithm>
+#include <cassert>
+#include <future>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -49,11 +53,17 @@
 #include <pacbio/ccs/SparseAlignment.h>
 #include <pacbio/denovo/SparsePoa.h>
 #include <pbcopper/logging/Logging.h>
+#include <pbcopper/qgram/Index.h>
 
+#include "poa/ReadOrientation.h"
+
+using PacBio::Poa::detail::Orientation;
+using PacBio::Poa::detail::OrientRead;
 using PacBio::Poa::detail::SdpAnchorVector;
 using PacBio::Align::AlignConfig;
 using PacBio::Align::AlignMode;
 using PacBio::Poa::DefaultPoaConfig;
+using PacBio::Poa::PoaAlignmentMatrix;
 using PacBio::Poa::PoaConsensus;
 using PacBio::Poa::PoaGraph;
 using PacBio::Data::ReverseComplement;
@@ -63,10 +73,96 @@ namespace Poa {
 
 using Vertex = PoaGraph::Vertex;
 
+namespace {
+
+// Summarize how a read's path through the graph follows the consensus,
+// given the position of each consensus vertex
+PoaAlignmentSummary SummarizeReadPath(const std::vector<Vertex>& readPath,
+                                      const std::map<Vertex, size_t>& cssPosition,
+                                      const bool reverseComplemented)
+{
+    size_t readS = 0, readE = 0;
+    size_t cssS = 0, cssE = 0;
+    bool foundStart = false;
+    size_t nErr = 0;
+
+    for (size_t readPos = 0; readPos < readPath.size(); readPos++) {
+        const auto it = cssPosition.find(readPath[readPos]);
+        if (it != cssPosition.end()) {
+            if (!foundStart) {
+                cssS = it->second;
+                readS = readPos;
+                foundStart = true;
+            }
+
+            cssE = it->second + 1;
+            readE = readPos + 1;
+        } else {
+            nErr += 1;
+        }
+    }
+
+    PoaAlignmentSummary summary;
+    summary.ReverseComplementedRead = reverseComplemented;
+    summary.ExtentOnRead = Interval(readS, readE);
+    summary.ExtentOnConsensus = Interval(cssS, cssE);
+    summary.AlignmentIdentity = std::max(0.0f, 1.0f - 1.0f * nErr / cssPosition.size());
+    return summary;
+}
+
+// The edit distance between two sequences if it is at most maxDist, and
+// maxDist + 1 otherwise, computed on a band of maxDist diagonals
+size_t BoundedEditDistance(const std::string& a, const std::string& b, const size_t maxDist)
+{
+    const size_t n = a.length(), m = b.length();
+    const size_t tooFar = maxDist + 1;
+    if ((n > m ? n - m : m - n) > maxDist) return tooFar;
+
+    std::vector<size_t> prev(m + 1, tooFar), cur(m + 1, tooFar);
+    for (size_t j = 0; j <= std::min(m, maxDist); ++j)
+        prev[j] = j;
+
+    for (size_t i = 1; i <= n; ++i) {
+        const size_t lo = i > maxDist ? i - maxDist : 0;
+        const size_t hi = std::min(m, i + maxDist);
+        size_t rowMin = tooFar;
+        if (lo == 0)
+            rowMin = cur[0] = i;
+        else
+            cur[lo - 1] = tooFar;
+        for (size_t j = std::max<size_t>(lo, 1); j <= hi; ++j) {
+            const size_t subst = prev[j - 1] + (a[i - 1] != b[j - 1]);
+            cur[j] = std::min({subst, prev[j] + 1, cur[j - 1] + 1});
+            rowMin = std::min(rowMin, cur[j]);
+        }
+        if (hi < m) cur[hi + 1] = tooFar;
+        if (rowMin > maxDist) return tooFar;
+        std::swap(prev, cur);
+    }
+    return std::min(prev[m], tooFar);
+}
+
+}  // namespace anonymous
+
+SdpRangeFinder::SdpRangeFinder() = default;
+SdpRangeFinder::~SdpRangeFinder() = default;
+
 SdpAnchorVector SdpRangeFinder::FindAnchors(const std::string& consensusSequence,
-                                            const std::string& readSequence) const
+                                            const std::string& readSequence)
 {
-    return CCS::SparseAlign(6, consensusSequence, readSequence);
+    static constexpr size_t qGramSize = 6;
+
+    // The consensus often stays put from one read to the next (and always
+    // between the two orientations of a read), so it is only reindexed
+    // when it changes; the anchors are the ones
+    // CCS::SparseAlign(qGramSize, consensusSequence, readSequence) finds.
+    if (consensusSequence.size() < qGramSize) return SdpAnchorVector();
+    if (!consensusIndex_ || consensusSequence != indexedConsensus_) {
+        consensusIndex_.reset(new QGram::Index(qGramSize, consensusSequence));
+        indexedConsensus_ = consensusSequence;
+        ++numIndexBuilds_;
+    }
+    return CCS::SparseAlign(*consensusIndex_, readSequence);
 }
 
 SparsePoa::SparsePoa()
@@ -74,6 +170,13 @@ SparsePoa::SparsePoa()
     , readPaths_()
     , reverseComplemented_()
     , rangeFinder_(new SdpRangeFinder())
+    , consensusReads_(-1)
+    , checkedReads_(0)
+    , stableReads_(0)
+    , prunedReads_(0)
+    , peakVertices_(0)
+    , prunedVertices_(0)
+    , prunings_(0)
 {
 }
 
@@ -126,29 +229,252 @@ SparsePoa::ReadKey SparsePoa::OrientAndAddRead(const std::string& readSequence,
         reverseComplemented_.push_back(false);
         key = graph_->NumReads() - 1;
     } else {
-        auto c1 = graph_->TryAddRead(readSequence, config, rangeFinder_);
-        auto c2 = graph_->TryAddRead(ReverseComplement(readSequence), config, rangeFinder_);
+        // Orient the read by the k-mers it shares with the consensus so
+        // far, and only align it both ways if that is inconclusive
+        const Orientation orientation = OrientRead(currentConsensus(), readSequence);
+
+        if (orientation == Orientation::AMBIGUOUS) {
+            auto c1 = graph_->TryAddRead(readSequence, config, rangeFinder_);
+            auto c2 = graph_->TryAddRead(ReverseComplement(readSequence), config, rangeFinder_);
+
+            if (c1->Score() >= c2->Score() && c1->Score() >= minScoreToAdd) {
+                graph_->CommitAdd(c1, &outputPath);
+                readPaths_.push_back(outputPath);
+                reverseComplemented_.push_back(false);
+                key = graph_->NumReads() - 1;
+            } else if (c2->Score() >= c1->Score() && c2->Score() >= minScoreToAdd) {
+                graph_->CommitAdd(c2, &outputPath);
+                readPaths_.push_back(outputPath);
+                reverseComplemented_.push_back(true);
+                key = graph_->NumReads() - 1;
+            } else {
+                key = -1;
+            }
 
-        if (c1->Score() >= c2->Score() && c1->Score() >= minScoreToAdd) {
-            graph_->CommitAdd(c1, &outputPath);
-            readPaths_.push_back(outputPath);
-            reverseComplemented_.push_back(false);
-            key = graph_->NumReads() - 1;
-        } else if (c2->Score() >= c1->Score() && c2->Score() >= minScoreToAdd) {
-            graph_->CommitAdd(c2, &outputPath);
-            readPaths_.push_back(outputPath);
-            reverseComplemented_.push_back(true);
-            key = graph_->NumReads() - 1;
+            delete c1;
+            delete c2;
         } else {
-            key = -1;
-        }
+            const bool reverse = orientation == Orientation::REVERSE;
+            auto c = graph_->TryAddRead(reverse ? ReverseComplement(readSequence) : readSequence,
+                                        config, rangeFinder_);
+
+            if (c->Score() >= minScoreToAdd) {
+                graph_->CommitAdd(c, &outputPath);
+                readPaths_.push_back(outputPath);
+                reverseComplemented_.push_back(reverse);
+                key = graph_->NumReads() - 1;
+            } else {
+                key = -1;
+            }
 
-        delete c1;
-        delete c2;
+            delete c;
+        }
     }
     return key;
 }
 
+std::vector<SparsePoa::ReadKey> SparsePoa::OrientAndAddReads(
+    const std::vector<std::string>& readSequences, const size_t nThreads, const PoaPruning& pruning,
+    const PoaAlignmentOptions& alnOptions, const float minScoreToAdd)
+{
+    const size_t nReads = readSequences.size();
+    const size_t nParts = std::max<size_t>(1, std::min(nThreads, nReads / MinPartitionReads));
+    std::vector<ReadKey> keys(nReads, -1);
+
+    if (nParts == 1) {
+        for (size_t i = 0; i < nReads; ++i) {
+            keys[i] = OrientAndAddRead(readSequences[i], alnOptions, minScoreToAdd);
+            if (keys[i] >= 0) PruneIfDue(pruning);
+        }
+        return keys;
+    }
+
+    // partition p holds the reads [bounds[p], bounds[p + 1])
+    std::vector<size_t> bounds;
+    for (size_t p = 0; p <= nParts; ++p)
+        bounds.push_back(p * nReads / nParts);
+
+    std::vector<std::unique_ptr<SparsePoa>> parts(nParts);
+    std::vector<std::future<void>> workers;
+    for (size_t p = 0; p < nParts; ++p) {
+        workers.emplace_back(std::async(std::launch::async, [&, p]() {
+            parts[p].reset(new SparsePoa());
+            for (size_t i = bounds[p]; i < bounds[p + 1]; ++i) {
+                keys[i] = parts[p]->OrientAndAddRead(readSequences[i], alnOptions, minScoreToAdd);
+                if (keys[i] >= 0) parts[p]->PruneIfDue(pruning);
+            }
+        }));
+    }
+    for (auto& worker : workers)
+        worker.get();
+
+    // merge the reads [begin, end) of other into poa, offsetting their keys
+    const auto merge = [&keys](SparsePoa* poa, const SparsePoa& other, const size_t begin,
+                               const size_t end) {
+        const ReadKey offset = poa->Merge(other);
+        for (size_t i = begin; i < end; ++i)
+            if (keys[i] >= 0) keys[i] += offset;
+    };
+
+    // in each round, partition p takes in its neighbour p + stride
+    for (size_t stride = 1; stride < nParts; stride *= 2) {
+        workers.clear();
+        for (size_t p = 0; p + stride < nParts; p += 2 * stride) {
+            workers.emplace_back(std::async(std::launch::async, [&, p, stride]() {
+                const size_t end = bounds[std::min(p + 2 * stride, nParts)];
+                merge(parts[p].get(), *parts[p + stride], bounds[p + stride], end);
+                parts[p + stride].reset();
+            }));
+        }
+        for (auto& worker : workers)
+            worker.get();
+    }
+    merge(this, *parts[0], 0, nReads);
+
+    return keys;
+}
+
+SparsePoa::ReadKey SparsePoa::Merge(const SparsePoa& other)
+{
+    const ReadKey offset = graph_->NumReads();
+    if (other.graph_->NumReads() == 0) return offset;
+
+    AlignConfig config = DefaultPoaConfig(AlignMode::LOCAL);
+    bool reverse = false;
+
+    if (graph_->NumReads() > 0) {
+        const std::string& css = other.currentConsensus();
+        const Orientation orientation = OrientRead(currentConsensus(), css);
+
+        if (orientation == Orientation::AMBIGUOUS) {
+            std::unique_ptr<PoaAlignmentMatrix> fwd(graph_->TryAddRead(css, config, rangeFinder_));
+            std::unique_ptr<PoaAlignmentMatrix> rev(
+                graph_->TryAddRead(ReverseComplement(css), config, rangeFinder_));
+            reverse = rev->Score() > fwd->Score();
+        } else {
+            reverse = orientation == Orientation::REVERSE;
+        }
+    }
+
+    std::vector<Vertex> vertexMap;
+    graph_->MergeGraph(*other.graph_, config, reverse, rangeFinder_, &vertexMap);
+
+    // the paths of reads merged reversed run the other way, as the reads
+    // are now taken reverse complemented; steps through vertices pruned
+    // from other map to NullVertex, as do ones already at NullVertex
+    for (size_t readId = 0; readId < other.readPaths_.size(); ++readId) {
+        Path path;
+        path.reserve(other.readPaths_[readId].size());
+        for (const Vertex v : other.readPaths_[readId]) {
+            assert(v == PoaGraph::NullVertex || v < vertexMap.size());
+            path.push_back(v < vertexMap.size() ? vertexMap[v] : Vertex{PoaGraph::NullVertex});
+        }
+        if (reverse) std::reverse(path.begin(), path.end());
+        readPaths_.push_back(std::move(path));
+        reverseComplemented_.push_back(other.reverseComplemented_[readId] != reverse);
+    }
+    consensusReads_ = -1;
+
+    peakVertices_ = std::max({peakVertices_, other.peakVertices_, graph_->NumVertices()});
+    prunedVertices_ += other.prunedVertices_;
+    prunings_ += other.prunings_;
+
+    return offset;
+}
+
+SparsePoa::ReadKey SparsePoa::MapRead(const PoaConsensus& consensus,
+                                      const std::string& readSequence,
+                                      std::vector<PoaAlignmentSummary>* summaries,
+                                      float minScoreToAdd)
+{
+    if (consensus.Sequence.empty()) return -1;
+
+    AlignConfig config = DefaultPoaConfig(AlignMode::LOCAL);
+    PoaGraph backbone;
+    Path backbonePath;
+    backbone.AddFirstRead(consensus.Sequence, &backbonePath);
+
+    std::map<Vertex, size_t> cssPosition;
+    for (size_t i = 0; i < backbonePath.size(); ++i)
+        cssPosition[backbonePath[i]] = i;
+
+    const Orientation orientation = OrientRead(consensus.Sequence, readSequence);
+    const std::string rcSequence =
+        (orientation == Orientation::FORWARD) ? std::string() : ReverseComplement(readSequence);
+
+    std::unique_ptr<PoaAlignmentMatrix> fwd, rev;
+    if (orientation != Orientation::REVERSE)
+        fwd.reset(backbone.TryAddRead(readSequence, config, rangeFinder_));
+    if (orientation != Orientation::FORWARD)
+        rev.reset(backbone.TryAddRead(rcSequence, config, rangeFinder_));
+
+    const bool reverse = !fwd || (rev && rev->Score() > fwd->Score());
+    PoaAlignmentMatrix* mat = reverse ? rev.get() : fwd.get();
+    if (mat->Score() < minScoreToAdd) return -1;
+
+    Path outputPath;
+    backbone.CommitAdd(mat, &outputPath);
+    summaries->push_back(SummarizeReadPath(outputPath, cssPosition, reverse));
+    return summaries->size() - 1;
+}
+
+bool SparsePoa::HasConverged(const PoaConvergence& convergence) const
+{
+    if (!convergence.Enabled() || graph_->NumReads() == 0) return false;
+
+    if (checkedReads_ != graph_->NumReads()) {
+        const std::string& css = currentConsensus();
+        const size_t nUndecided = graph_->NumUndecidedVertices(convergence.MinMargin);
+
+        // every edit to the consensus since the last check has to be
+        // accounted for by an undecided vertex, so that no decided one
+        // flipped in between
+        const bool stable = nUndecided <= convergence.MaxUndecided * css.length() &&
+                            (css == checkedConsensus_ ||
+                             BoundedEditDistance(checkedConsensus_, css, nUndecided) <= nUndecided);
+        stableReads_ = stable ? stableReads_ + 1 : 0;
+        checkedConsensus_ = css;
+        checkedReads_ = graph_->NumReads();
+    }
+    return stableReads_ >= convergence.StableReads;
+}
+
+size_t SparsePoa::PruneIfDue(const PoaPruning& pruning)
+{
+    const size_t nReads = graph_->NumReads();
+    if (!pruning.Enabled() || nReads < pruning.MinReads ||
+        (prunings_ > 0 && nReads < prunedReads_ + pruning.ReadInterval))
+        return 0;
+
+    peakVertices_ = std::max(peakVertices_, graph_->NumVertices());
+    const size_t nPruned = graph_->PruneUnsupportedVertices(pruning.MinSupport);
+    prunedReads_ = nReads;
+    prunedVertices_ += nPruned;
+    ++prunings_;
+    if (nPruned > 0) consensusReads_ = -1;
+    return nPruned;
+}
+
+PoaGraphStats SparsePoa::GraphStats() const
+{
+    PoaGraphStats stats;
+    stats.NumVertices = graph_->NumVertices();
+    stats.NumEdges = graph_->NumEdges();
+    stats.PeakVertices = std::max(peakVertices_, stats.NumVertices);
+    stats.PrunedVertices = prunedVertices_;
+    stats.Prunings = prunings_;
+    return stats;
+}
+
+const std::string& SparsePoa::currentConsensus() const
+{
+    if (consensusReads_ != graph_->NumReads()) {
+        consensus_ = graph_->FindConsensusSequence(DefaultPoaConfig(AlignMode::LOCAL));
+        consensusReads_ = graph_->NumReads();
+    }
+    return consensus_;
+}
+
 std::shared_ptr<const PoaConsensus> SparsePoa::FindConsensus(
     int minCoverage, std::vector<PoaAlignmentSummary>* summaries) const
 {
@@ -170,39 +496,9 @@ std::shared_ptr<const PoaConsensus> SparsePoa::FindConsensus(
         }
 
         for (size_t readId = 0; readId < graph_->NumReads(); readId++) {
-            size_t readS = 0, readE = 0;
-            size_t cssS = 0, cssE = 0;
-            bool foundStart = false;
-            size_t nErr = 0;
-
-            const std::vector<Vertex>& readPath = readPaths_[readId];
-
-            for (size_t readPos = 0; readPos < readPath.size(); readPos++) {
-                Vertex v = readPath[readPos];
-                if (cssPosition.find(v) != cssPosition.end()) {
-                    if (!foundStart) {
-                        cssS = cssPosition[v];
-                        readS = readPos;
-                        foundStart = true;
-                    }
-
-                    cssE = cssPosition[v] + 1;
-                    readE = readPos + 1;
-                } else {
-                    nErr += 1;
-                }
-            }
-
-            Interval readExtent(readS, readE);
-            Interval cssExtent(cssS, cssE);
-
-            PoaAlignmentSummary summary;
-            summary.ReverseComplementedRead = reverseComplemented_[readId];
-            summary.ExtentOnRead = readExtent;
-            summary.ExtentOnConsensus = cssExtent;
-            summary.AlignmentIdentity = std::max(0.0f, 1.0f - 1.0f * nErr / cssPosition.size());
-
-            (*summaries).push_back(summary);
+            (*summaries)
+                .push_back(SummarizeReadPath(readPaths_[readId], cssPosition,
+                                             reverseComplemented_[readId]));
         }
     }
 
@@ -225,7 +521,12 @@ void SparsePoa::WriteGraphCsvFile(const std::string& filename) const
     graph_->WriteGraphCsvFile(filename);
 }
 
-void SparsePoa::PruneGraph(const int minCoverage) { graph_->PruneGraph(minCoverage); }
+void SparsePoa::PruneGraph(const int minCoverage)
+{
+    peakVertices_ = std::max(peakVertices_, graph_->NumVertices());
+    graph_->PruneGraph(minCoverage);
+    consensusReads_ = -1;
+}
 
 void SparsePoa::repCheck()
 {
@@ -33,10 +33,14 @@
 // OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
 // SUCH DAMAGE.
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <new>
 #include <sstream>
 #include <stdexcept>
+#include <tuple>
+#include <type_traits>
 
 #include <pacbio/consensus/Template.h>
 #include <pacbio/exception/StateError.h>
@@ -46,6 +50,33 @@ namespace Consensus {
 
 using TemplateTooSmall = PacBio::Exception::TemplateTooSmall;
 
+namespace {
+
+constexpr char kBases[] = "ACGT";
+
+int BaseIndex(const char base)
+{
+    switch (base) {
+        case 'A':
+            return 0;
+        case 'C':
+            return 1;
+        case 'G':
+            return 2;
+        case 'T':
+            return 3;
+        default:
+            return -1;
+    }
+}
+
+TemplatePosition TerminalPosition(const char base)
+{
+    return TemplatePosition{base, 1.0, 0.0, 0.0, 0.0};
+}
+
+}  // namespace anonymous
+
 //
 // AbstractTemplate Function Definitions
 //
@@ -186,11 +217,16 @@ std::pair<double, double> AbstractTemplate::NormalParameters() const
 */
 std::pair<double, double> AbstractTemplate::SiteNormalParameters(const size_t i) const
 {
-    const auto params = (*this)[i];
     // TODO: This is a bit unsafe, we should understand context and have this conversion in one
     // place (or really just move directly to using .Idx without bit shifting
     const auto prev =
         (i == 0) ? AlleleRep::FromASCII('A') : (*this)[i - 1].Idx;  // default base : A
+    return SiteNormalParameters((*this)[i], prev);
+}
+
+std::pair<double, double> AbstractTemplate::SiteNormalParameters(const TemplatePosition& params,
+                                                                 const AlleleRep& prev) const
+{
     const auto curr = params.Idx;
 
     const double p_m = params.Match, l_m = std::log(p_m), l2_m = l_m * l_m;
@@ -227,6 +263,11 @@ std::pair<double, double> AbstractTemplate::SiteNormalParameters(const size_t i)
     return std::make_pair(mean, var);
 }
 
+TemplatePosition AbstractTemplate::ContextParameters(const char base, const char next) const
+{
+    return Config().Populate({base, next})[0];
+}
+
 bool AbstractTemplate::InRange(const size_t start, const size_t end) const
 {
     if ((pinStart_ || start_ < end) && (pinEnd_ || start < end_)) return true;
@@ -253,6 +294,17 @@ Template::Template(const std::string& tpl, std::unique_ptr<ModelConfig>&& cfg, c
     , cfg_(std::move(cfg))
     , tpl_{cfg_->Populate(tpl)}
 {
+    ctx_.reserve(16);
+    for (size_t i = 0; i < 4; ++i)
+        for (size_t j = 0; j < 4; ++j)
+            ctx_.emplace_back(cfg_->Populate({kBases[i], kBases[j]})[0]);
+
+    sites_.reserve(tpl_.size());
+    for (size_t i = 0; i < tpl_.size(); ++i)
+        sites_.emplace_back((i + 1 < tpl_.size()) ? SiteNormalParameters(i)
+                                                  : std::make_pair(0.0, 0.0));
+    UpdatePrefixSums(0);
+
     assert(end_ - start_ == tpl_.size());
     assert(!pinStart_ || start_ == 0);
     // cannot test this unfortunately =(
@@ -275,19 +327,23 @@ bool Template::ApplyMutation(const Mutation& mut)
 
             if (b > 0) {
                 if (b < tpl_.size())
-                    tpl_[b - 1] = cfg_->Populate({tpl_[b - 1].Base, tpl_[b].Base})[0];
+                    tpl_[b - 1] = ContextParameters(tpl_[b - 1].Base, tpl_[b].Base);
                 else
-                    tpl_[b - 1] = TemplatePosition{tpl_[b - 1].Base, 1.0, 0.0, 0.0, 0.0};
+                    tpl_[b - 1] = TerminalPosition(tpl_[b - 1].Base);
             }
+
+            UpdateNormalParameters(b, e - b, 0);
         } else if (mut.IsInsertion()) {
             const auto elems = cfg_->Populate(mut.Bases());
             const size_t e = b + elems.size();
 
             tpl_.insert(tpl_.begin() + b, elems.begin(), elems.end());
 
-            if (b > 0) tpl_[b - 1] = cfg_->Populate({tpl_[b - 1].Base, tpl_[b].Base})[0];
+            if (b > 0) tpl_[b - 1] = ContextParameters(tpl_[b - 1].Base, tpl_[b].Base);
             if (0 < e && e < tpl_.size())
-                tpl_[e - 1] = cfg_->Populate({tpl_[e - 1].Base, tpl_[e].Base})[0];
+                tpl_[e - 1] = ContextParameters(tpl_[e - 1].Base, tpl_[e].Base);
+
+            UpdateNormalParameters(b, 0, elems.size());
         } else if (mut.IsSubstitution()) {
             const auto elems = cfg_->Populate(mut.Bases());
             const size_t e = mut.End() - start_;
@@ -295,9 +351,11 @@ bool Template::ApplyMutation(const Mutation& mut)
             for (size_t i = b; i < e; ++i)
                 tpl_[i] = elems[i - b];
 
-            if (b > 0) tpl_[b - 1] = cfg_->Populate({tpl_[b - 1].Base, tpl_[b].Base})[0];
+            if (b > 0) tpl_[b - 1] = ContextParameters(tpl_[b - 1].Base, tpl_[b].Base);
             if (0 < e && e < tpl_.size())
-                tpl_[e - 1] = cfg_->Populate({tpl_[e - 1].Base, tpl_[e].Base})[0];
+                tpl_[e - 1] = ContextParameters(tpl_[e - 1].Base, tpl_[e].Base);
+
+            UpdateNormalParameters(b, e - b, e - b);
         } else
             throw std::invalid_argument(
                 "invalid mutation type! must be DELETION, INSERTION, or "
@@ -322,6 +380,146 @@ finish:
     return mutApplied;
 }
 
+bool Template::ApplyMutations(std::vector<Mutation>* const muts)
+{
+    // make sure the mutations are sorted by site: End() then Start()
+    std::sort(muts->begin(), muts->end(), Mutation::SiteComparer);
+
+    const size_t oldStart = start_;
+    const size_t oldEnd = end_;
+
+    // Walk the batch back to front, exactly as the sequential path does, so the
+    // start_/end_ bookkeeping is identical; only record the local edit sites here
+    std::vector<std::pair<size_t, const Mutation*>> edits;
+    size_t length = tpl_.size();
+    size_t nextStart = length;
+
+    for (auto it = muts->crbegin(); it != muts->crend(); ++it) {
+        const Mutation& mut = *it;
+
+        if ((length > 0 || mut.LengthDiff() > 0) && InRange(mut.Start(), mut.End())) {
+            const size_t b = mut.Start() - start_;
+            const size_t e = mut.End() - start_;
+
+            // overlapping edits cannot be spliced in one pass; let the
+            //   sequential path sort them out
+            if (e > nextStart) {
+                start_ = oldStart;
+                end_ = oldEnd;
+                return AbstractTemplate::ApplyMutations(muts);
+            }
+
+            edits.emplace_back(b, &mut);
+            length += mut.LengthDiff();
+            nextStart = b;
+        }
+
+        AbstractTemplate::ApplyMutation(mut);
+
+        if (length < 2) throw TemplateTooSmall();
+    }
+
+    if (edits.empty()) return false;
+
+    // splice the edits into a fresh template, remembering the positions whose
+    //   successor changed and therefore need their context repopulated, and
+    //   the sites whose normal parameters need refreshing
+    std::vector<TemplatePosition> tpl;
+    std::vector<std::pair<double, double>> sites;
+    std::vector<size_t> dirty;
+    std::vector<std::pair<size_t, size_t>> stale;
+    tpl.reserve(length);
+    sites.reserve(length);
+    dirty.reserve(2 * edits.size());
+    stale.reserve(edits.size());
+
+    size_t i = 0;
+    for (auto it = edits.crbegin(); it != edits.crend(); ++it) {
+        const size_t b = it->first;
+        const Mutation& mut = *it->second;
+
+        tpl.insert(tpl.end(), tpl_.begin() + i, tpl_.begin() + b);
+        sites.insert(sites.end(), sites_.begin() + i, sites_.begin() + b);
+        if (!tpl.empty()) dirty.emplace_back(tpl.size() - 1);
+        const size_t first = tpl.empty() ? 0 : tpl.size() - 1;
+
+        if (!mut.IsDeletion()) {
+            const auto elems = cfg_->Populate(mut.Bases());
+            tpl.insert(tpl.end(), elems.begin(), elems.end());
+            sites.resize(tpl.size(), std::make_pair(0.0, 0.0));
+            dirty.emplace_back(tpl.size() - 1);
+        }
+
+        // the site after the edit sees a new predecessor
+        stale.emplace_back(first, tpl.size() + 1);
+        i = b + mut.Length();
+    }
+    tpl.insert(tpl.end(), tpl_.begin() + i, tpl_.end());
+    sites.insert(sites.end(), sites_.begin() + i, sites_.end());
+
+    for (const size_t j : dirty) {
+        if (j + 1 < tpl.size())
+            tpl[j] = ContextParameters(tpl[j].Base, tpl[j + 1].Base);
+        else
+            tpl[j] = TerminalPosition(tpl[j].Base);
+    }
+
+    tpl_ = std::move(tpl);
+    sites_ = std::move(sites);
+
+    for (const auto& range : stale)
+        for (size_t j = range.first; j < std::min(range.second, tpl_.size()); ++j)
+            sites_[j] = (j + 1 < tpl_.size()) ? SiteNormalParameters(j) : std::make_pair(0.0, 0.0);
+    UpdatePrefixSums(stale.front().first);
+
+    assert(tpl_.size() == end_ - start_);
+    assert(sites_.size() == tpl_.size());
+    assert(!pinStart_ || start_ == 0);
+
+    return true;
+}
+
+void Template::UpdateNormalParameters(const size_t b, const size_t removed, const size_t inserted)
+{
+    sites_.erase(sites_.begin() + b, sites_.begin() + b + removed);
+    sites_.insert(sites_.begin() + b, inserted, std::make_pair(0.0, 0.0));
+
+    // the site before the edit, the edited sites, and the site after
+    const size_t first = (b > 0) ? b - 1 : 0;
+    const size_t last = std::min(tpl_.size(), b + inserted + 1);
+    for (size_t i = first; i < last; ++i)
+        sites_[i] = (i + 1 < tpl_.size()) ? SiteNormalParameters(i) : std::make_pair(0.0, 0.0);
+
+    UpdatePrefixSums(first);
+}
+
+void Template::UpdatePrefixSums(const size_t first)
+{
+    // sites before first are unchanged, so their sums are as well; the
+    //   last site is never included (see AbstractTemplate::NormalParameters)
+    prefix_.resize(std::max<size_t>(tpl_.size(), 1));
+    prefix_[0] = std::make_pair(0.0, 0.0);
+    for (size_t i = first; i + 1 < tpl_.size(); ++i)
+        prefix_[i + 1] = std::make_pair(prefix_[i].first + sites_[i].first,
+                                        prefix_[i].second + sites_[i].second);
+}
+
+std::pair<double, double> Template::NormalParameters() const { return prefix_.back(); }
+
+std::pair<double, double> Template::NormalParameters(const size_t begin, const size_t end) const
+{
+    assert(begin < end && end <= tpl_.size());
+    if (end - begin < 2) return std::make_pair(0.0, 0.0);
+
+    // a template of its own has no predecessor for its first site and
+    //   a terminal last site, which does not contribute either way
+    double mean, var;
+    std::tie(mean, var) = SiteNormalParameters(tpl_[begin], AlleleRep::FromASCII('A'));
+    mean += prefix_[end - 1].first - prefix_[begin + 1].first;
+    var += prefix_[end - 1].second - prefix_[begin + 1].second;
+    return std::make_pair(mean, var);
+}
+
 size_t Template::Length() const { return tpl_.size(); }
 
 const TemplatePosition& Template::operator[](size_t i) const { return tpl_[i]; }
@@ -331,12 +529,100 @@ std::unique_ptr<AbstractRecursor> Template::CreateRecursor(const PacBio::Data::M
 {
     return cfg_->CreateRecursor(mr, scoreDiff);
 }
+TemplatePosition Template::ContextParameters(const char base, const char next) const
+{
+    const int i = BaseIndex(base);
+    const int j = BaseIndex(next);
+    if (i < 0 || j < 0) return AbstractTemplate::ContextParameters(base, next);
+    return ctx_[4 * i + j];
+}
+
 double Template::ExpectedLLForEmission(MoveType move, const AlleleRep& prev, const AlleleRep& curr,
                                        MomentType moment) const
 {
     return cfg_->ExpectedLLForEmission(move, prev, curr, moment);
 }
 
+//
+// WindowedTemplate Function Definitions
+//
+WindowedTemplate::WindowedTemplate(std::shared_ptr<const Template> master, const size_t start,
+                                   const size_t end, const bool pinStart, const bool pinEnd)
+    : AbstractTemplate(start, end, pinStart, pinEnd)
+    , master_{std::move(master)}
+    , last_{TerminalPosition((*master_)[end - 1].Base)}
+{
+    assert(end_ <= master_->Length());
+    assert(!pinStart_ || start_ == 0);
+}
+
+size_t WindowedTemplate::Length() const { return end_ - start_; }
+
+bool WindowedTemplate::UpdateWindow(const Mutation& mut)
+{
+    // mirror Template::ApplyMutation, without touching the bases
+    const bool nonEmpty = Length() > 0 || mut.LengthDiff() > 0;
+    const bool mutApplied = AbstractTemplate::ApplyMutation(mut) && nonEmpty;
+
+    if (Length() < 2) throw TemplateTooSmall();
+
+    return mutApplied;
+}
+
+bool WindowedTemplate::ApplyMutation(const Mutation& mut)
+{
+    const bool mutApplied = UpdateWindow(mut);
+
+    assert(end_ <= master_->Length());
+    last_ = TerminalPosition((*master_)[end_ - 1].Base);
+
+    return mutApplied;
+}
+
+bool WindowedTemplate::ApplyMutations(std::vector<Mutation>* const muts)
+{
+    bool mutsApplied = false;
+
+    // make sure the mutations are sorted by site: End() then Start()
+    std::sort(muts->begin(), muts->end(), Mutation::SiteComparer);
+
+    for (auto it = muts->crbegin(); it != muts->crend(); ++it)
+        mutsApplied |= UpdateWindow(*it);
+
+    // only now does the window agree with the (already mutated) master
+    assert(end_ <= master_->Length());
+    last_ = TerminalPosition((*master_)[end_ - 1].Base);
+
+    return mutsApplied;
+}
+
+std::unique_ptr<AbstractRecursor> WindowedTemplate::CreateRecursor(
+    const PacBio::Data::MappedRead& mr, double scoreDiff) const
+{
+    return master_->CreateRecursor(mr, scoreDiff);
+}
+
+double WindowedTemplate::ExpectedLLForEmission(MoveType move, const AlleleRep& prev,
+                                               const AlleleRep& curr, MomentType moment) const
+{
+    return master_->ExpectedLLForEmission(move, prev, curr, moment);
+}
+
+std::pair<double, double> WindowedTemplate::NormalParameters() const
+{
+    return master_->NormalParameters(start_, end_);
+}
+
+const ModelConfig& WindowedTemplate::Config() const
+{
+    return static_cast<const AbstractTemplate&>(*master_).Config();
+}
+
+TemplatePosition WindowedTemplate::ContextParameters(const char base, const char next) const
+{
+    return static_cast<const AbstractTemplate&>(*master_).ContextParameters(base, next);
+}
+
 //
 // MutatedTemplate Function Definitions
 //
@@ -348,13 +634,19 @@ MutatedTemplate::MutatedTemplate(const AbstractTemplate& master, const Mutation&
     , mut_{mut}
     , mutStart_{(mut.Start() > 0) ? mut.Start() - 1 : 0}
     , mutOff_{mut.LengthDiff()}
+    , mutSize_{(mut.Start() > 0) + mut.Bases().size()}
 {
+    static_assert(std::is_trivially_copyable<TemplatePosition>::value,
+                  "TemplatePosition must be trivially copyable to be stored inline");
+
     // Sanity check the input arguments and calculate the relative position of our mutation
     assert(!pinStart_ || start_ == 0);
     assert(!pinEnd_ || end_ - start_ == master_.Length());
 
-    // Fill out mutTpl_ with the model parameters for the base before the mutation and all the
-    // bases changed by it.
+    if (mutSize_ > InlineCapacity) mutHeap_.reserve(mutSize_);
+
+    // Fill out the mutated positions with the model parameters for the base before the
+    // mutation and all the bases changed by it.
     //
     // All mutations below are described as Before(B), Position(P), or After(A) with Mutated(M)
     // for the new nucleotide, such that the pre-mutation template can be read as "B-P-A".  Since
@@ -362,38 +654,47 @@ MutatedTemplate::MutatedTemplate(const AbstractTemplate& master, const Mutation&
     // of the targeted position is "B-P", and the context of the successor base is "P-A".
     const size_t mStart = mut_.Start();
     const size_t mEnd = mut_.End();
+    const bool hasNext = mEnd < master_.Length();
     if (mut_.IsDeletion()) {
         if (mStart > 0) {
-            if (mEnd < master_.Length()) {
-                mutTpl_.emplace_back(
-                    master_.Config().Populate({master_[mStart - 1].Base, master_[mEnd].Base})[0]);
-            } else
-                mutTpl_.emplace_back(TemplatePosition{master[mStart - 1].Base, 1.0, 0.0, 0.0, 0.0});
+            const char prev = master_[mStart - 1].Base;
+            SetMutatedPosition(0, hasNext ? master_.ContextParameters(prev, master_[mEnd].Base)
+                                          : TerminalPosition(prev));
         }
     } else if (mut_.IsInsertion() || mut_.IsSubstitution()) {
+        const std::string& bases = mut_.Bases();
+        size_t i = 0;
+
         if (mStart > 0)
-            mutTpl_.emplace_back(
-                master_.Config().Populate({master_[mStart - 1].Base, mut_.Bases()[0]})[0]);
+            SetMutatedPosition(i++, master_.ContextParameters(master_[mStart - 1].Base, bases[0]));
 
-        auto elems = master_.Config().Populate(mut.Bases());
-        mutTpl_.reserve(mutTpl_.size() + elems.size());
-        mutTpl_.insert(mutTpl_.end(), elems.begin(), elems.end());
+        for (size_t j = 0; j + 1 < bases.size(); ++j)
+            SetMutatedPosition(i++, master_.ContextParameters(bases[j], bases[j + 1]));
 
-        if (mEnd < master_.Length())
-            mutTpl_.back() =
-                master_.Config().Populate({mut_.Bases().back(), master_[mEnd].Base})[0];
+        SetMutatedPosition(i, hasNext ? master_.ContextParameters(bases.back(), master_[mEnd].Base)
+                                      : TerminalPosition(bases.back()));
     } else
         throw std::invalid_argument(
             "invalid mutation type! must be DELETION, INSERTION, or "
             "SUBSTITUTION");
 
-    assert((mut_.IsDeletion() && mutTpl_.size() == (mut.Start() > 0)) ||
-           (mutTpl_.size() == mut_.Bases().size() + (mut.Start() > 0)));
+    assert(mutSize_ <= InlineCapacity || mutHeap_.size() == mutSize_);
     assert(Length() == 0 ||
            ((*this)[Length() - 1].Match == 1.0 && (*this)[Length() - 1].Branch == 0.0 &&
             (*this)[Length() - 1].Stick == 0.0 && (*this)[Length() - 1].Deletion == 0.0));
 }
 
+void MutatedTemplate::SetMutatedPosition(const size_t i, const TemplatePosition& pos)
+{
+    assert(i < mutSize_);
+    if (mutSize_ <= InlineCapacity)
+        new (&mutBuf_[i]) TemplatePosition(pos);
+    else {
+        assert(i == mutHeap_.size());
+        mutHeap_.emplace_back(pos);
+    }
+}
+
 bool MutatedTemplate::ApplyMutation(const Mutation& mut)
 {
     throw std::runtime_error("MutatedTemplate cannot perform ApplyMutation!");
@@ -416,10 +717,10 @@ const TemplatePosition& MutatedTemplate::operator[](const size_t i) const
 
     // if we're beyond the mutation position, we have to adjust for any change in
     // template length caused by the mutation before returning
-    else if (i >= mutStart_ + mutTpl_.size())
+    else if (i >= mutStart_ + mutSize_)
         return master_[i - mutOff_];
 
-    return mutTpl_[i - mutStart_];
+    return MutatedPosition(i - mutStart_);
 }
 
 std::unique_ptr<AbstractRecursor> MutatedTemplate::CreateRecursor(
@@ -428,6 +729,11 @@ std::unique_ptr<AbstractRecursor> MutatedTemplate::CreateRecursor(
     return master_.CreateRecursor(mr, scoreDiff);
 }
 
+TemplatePosition MutatedTemplate::ContextParameters(const char base, const char next) const
+{
+    return master_.ContextParameters(base, next);
+}
+
 double MutatedTemplate::ExpectedLLForEmission(MoveType move, const AlleleRep& prev,
                                               const AlleleRep& curr, MomentType moment) const
 {
@@ -0,0 +1,191 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#include <algorithm>
+#include <cctype>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <pacbio/align/LinearAlignment.h>
+#include <pacbio/data/State.h>
+#include <pacbio/genomic/WindowConsensus.h>
+
+using std::pair;
+using std::string;
+using std::vector;
+
+using PacBio::Consensus::ConsensusQVs;
+using PacBio::Consensus::Integrator;
+using PacBio::Consensus::Polish;
+using PacBio::Data::MappedRead;
+using PacBio::Data::State;
+
+namespace PacBio {
+namespace Genomic {
+
+WindowConsensusConfig::WindowConsensusConfig(const size_t minCoverage, const int minConfidence)
+    : MinCoverage{minCoverage}, MinConfidence{minConfidence}
+{
+}
+
+namespace {  // anonymous
+
+// A single matching column of the alignment of template and consensus,
+// or a maximal run of differing columns
+struct Segment
+{
+    size_t TplStart;
+    size_t TplEnd;
+    size_t CnsStart;
+    size_t CnsEnd;
+    bool IsMatch;
+};
+
+vector<Segment> AlignSegments(const string& tpl, const string& cns)
+{
+    const std::unique_ptr<Align::PairwiseAlignment> aln(Align::AlignLinear(tpl, cns));
+    const string transcript = aln->Transcript();
+
+    vector<Segment> segments;
+    size_t t = 0, c = 0;
+
+    for (size_t k = 0; k < transcript.length();) {
+        if (transcript[k] == 'M') {
+            segments.emplace_back(Segment{t, t + 1, c, c + 1, true});
+            ++t, ++c, ++k;
+            continue;
+        }
+
+        Segment seg{t, t, c, c, false};
+        for (; k < transcript.length() && transcript[k] != 'M'; ++k) {
+            if (transcript[k] != 'I') ++t;
+            if (transcript[k] != 'D') ++c;
+        }
+        seg.TplEnd = t;
+        seg.CnsEnd = c;
+        segments.emplace_back(seg);
+    }
+
+    return segments;
+}
+
+// The lowest QV of the consensus bases of the segment,
+// or of the bases flanking it if it is a deletion
+int Confidence(const Segment& seg, const vector<int>& qvs)
+{
+    const size_t begin =
+        seg.CnsStart == seg.CnsEnd && seg.CnsStart > 0 ? seg.CnsStart - 1 : seg.CnsStart;
+    const size_t end = std::min(qvs.size(), std::max(seg.CnsEnd, seg.CnsStart + 1));
+
+    if (begin >= end) return 0;
+    return *std::min_element(qvs.begin() + begin, qvs.begin() + end);
+}
+
+}  // namespace anonymous
+
+WindowConsensus ConsensusForWindow(const string& tpl, const size_t start, const size_t end,
+                                   const vector<MappedRead>& reads,
+                                   const WindowConsensusConfig& cfg)
+{
+    if (start >= end || end > tpl.length())
+        throw std::invalid_argument("window must be a nonempty range of the template");
+
+    WindowConsensus result;
+
+    const bool pure = std::all_of(tpl.begin(), tpl.end(), [](const char b) {
+        return b == 'A' || b == 'C' || b == 'G' || b == 'T';
+    });
+
+    Integrator ai(tpl, cfg.Integrator);
+    vector<pair<size_t, size_t>> spans;
+
+    if (pure) {
+        for (const auto& read : reads) {
+            if (read.Length() < 2 || read.TemplateEnd <= read.TemplateStart) continue;
+            if (ai.AddRead(read) == State::VALID)
+                spans.emplace_back(read.TemplateStart, read.TemplateEnd);
+        }
+    }
+
+    result.Coverage = spans.size();
+
+    // no call, emit the reference
+    if (result.Coverage < cfg.MinCoverage || result.Coverage == 0) {
+        result.Sequence = tpl.substr(start, end - start);
+        std::transform(result.Sequence.begin(), result.Sequence.end(), result.Sequence.begin(),
+                       [](const char b) { return std::tolower(b); });
+        result.Qualities.assign(end - start, 0);
+        return result;
+    }
+
+    result.Result = Polish(&ai, cfg.Polish);
+
+    const string cns(ai);
+    const vector<int> qvs = ConsensusQVs(ai).Qualities;
+
+    for (const auto& seg : AlignSegments(tpl, cns)) {
+        // segments are anchored at their template start, trailing insertions
+        // belong to the window ending the template
+        if (seg.TplStart < start || seg.TplStart > end ||
+            (seg.TplStart == end && end != tpl.length()))
+            continue;
+
+        result.Sequence.append(cns, seg.CnsStart, seg.CnsEnd - seg.CnsStart);
+        result.Qualities.insert(result.Qualities.end(), qvs.begin() + seg.CnsStart,
+                                qvs.begin() + seg.CnsEnd);
+
+        if (seg.IsMatch) continue;
+
+        const size_t coverage =
+            std::count_if(spans.begin(), spans.end(), [&seg](const pair<size_t, size_t>& span) {
+                return span.first <= seg.TplStart && seg.TplEnd <= span.second;
+            });
+        const int confidence = Confidence(seg, qvs);
+
+        if (coverage < cfg.MinCoverage || confidence < cfg.MinConfidence) continue;
+
+        result.Variants.emplace_back(
+            Variant{seg.TplStart, seg.TplEnd, tpl.substr(seg.TplStart, seg.TplEnd - seg.TplStart),
+                    cns.substr(seg.CnsStart, seg.CnsEnd - seg.CnsStart), confidence, coverage});
+    }
+
+    return result;
+}
+
+}  // namespace Genomic
+}  // namespace PacBio
@@ -43,6 +43,7 @@
 #include <map>
 #include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -186,6 +187,7 @@ void WriteBamRecords(BamWriter& ccsBam, unique_ptr<PbiBuilder>& ccsPbi, Results&
             zScores.emplace_back(static_cast<float>(z));
         tags["zs"] = zScores;
         tags["rs"] = ccs.StatusCounts;
+        if (settings.PoaConvergence.Enabled()) tags["pc"] = static_cast<int32_t>(ccs.PoaCoverage);
 
         if (ccs.Barcodes) {
             int16_t first, second;
@@ -334,6 +336,9 @@ void WriteResultsReport(ostream& report, const Results& counts)
     report << "Failed -- CCS did not converge," << counts.NonConvergent << ","
            << 100.0 * counts.NonConvergent / total << '%' << endl;
 
+    report << "Failed -- CCS exceeded per-ZMW polishing budget," << counts.ExceededBudget << ","
+           << 100.0 * counts.ExceededBudget / total << '%' << endl;
+
     report << "Failed -- CCS below minimum predicted accuracy," << counts.PoorQuality << ","
            << 100.0 * counts.PoorQuality / total << '%' << endl;
 
@@ -436,6 +441,14 @@ static int Runner(const PacBio::CLI::Results& args)
         }
     }
 
+    // share models between reads of the same (or, if rounded, similar) SNR
+    try {
+        ConfigureModelCache(settings.ModelSnrResolution);
+    } catch (const std::invalid_argument& e) {
+        PBLOG_FATAL << "option --modelSnrResolution: " << e.what();
+        exit(EXIT_FAILURE);
+    }
+
     // start processing chunks!
     //
     //
@@ -625,6 +638,10 @@ static int Runner(const PacBio::CLI::Results& args)
         WriteResultsReport(stream, counts);
     }
 
+    const auto cacheStats = ModelCacheStatistics();
+    PBLOG_INFO << "Model cache: " << cacheStats.Hits << " hits, " << cacheStats.Misses
+               << " misses (" << 100.0 * cacheStats.HitRate() << "% hit rate)";
+
     return EXIT_SUCCESS;
 }
 
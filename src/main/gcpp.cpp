@@ -0,0 +1,569 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/algorithm/string/join.hpp>
+
+#include <pbcopper/cli/CLI.h>
+#include <pbcopper/logging/Logging.h>
+#include <pbcopper/utility/FileUtils.h>
+
+#include <pbbam/BamRecord.h>
+#include <pbbam/DataSet.h>
+#include <pbbam/GenomicInterval.h>
+#include <pbbam/GenomicIntervalQuery.h>
+#include <pbbam/IndexedFastaReader.h>
+
+#include <pacbio/consensus/ModelSelection.h>
+#include <pacbio/data/PlainOption.h>
+#include <pacbio/data/Read.h>
+#include <pacbio/genomic/WindowConsensus.h>
+#include <pacbio/io/Utility.h>
+#include <pacbio/parallel/WorkQueue.h>
+
+#include <pacbio/UnanimityVersion.h>
+
+using std::set;
+using std::string;
+using std::vector;
+
+using std::ofstream;
+using std::ostream;
+
+using std::cerr;
+using std::endl;
+
+using std::future;
+using std::launch;
+using std::ref;
+
+using namespace PacBio::BAM;
+using namespace PacBio::Consensus;
+using namespace PacBio::Data;
+using namespace PacBio::Genomic;
+using namespace PacBio::IO;
+using namespace PacBio::Logging;
+using namespace PacBio::Parallel;
+using namespace PacBio::Utility;
+
+// these strings are part of the output headers, they CANNOT contain newlines
+const string DESCRIPTION = "Compute genomic consensus and call variants from aligned subreads.";
+const string APPNAME = "gcpp";
+
+namespace OptionNames {
+// clang-format off
+const PlainOption WindowSize{
+    "window_size",
+    { "windowSize" },
+    "Window Size",
+    "Length of the reference windows polished independently.",
+    PacBio::CLI::Option::IntType(2000)
+};
+const PlainOption WindowFlank{
+    "window_flank",
+    { "windowFlank" },
+    "Window Flank",
+    "Reference bases polished on either side of a window, but not reported. Must be positive.",
+    PacBio::CLI::Option::IntType(200)
+};
+const PlainOption MinCoverage{
+    "min_coverage",
+    { "minCoverage" },
+    "Minimum Coverage",
+    "Windows and variants covered by fewer reads are not called.",
+    PacBio::CLI::Option::IntType(5)
+};
+const PlainOption MaxCoverage{
+    "max_coverage",
+    { "maxCoverage" },
+    "Maximum Coverage",
+    "Polish each window with at most this many reads, preferring the longest.",
+    PacBio::CLI::Option::IntType(100)
+};
+const PlainOption MinConfidence{
+    "min_confidence",
+    { "minConfidence" },
+    "Minimum Confidence",
+    "Minimum phred-scaled confidence of reported variants.",
+    PacBio::CLI::Option::IntType(40)
+};
+const PlainOption MinMapQV{
+    "min_map_qv",
+    { "minMapQV" },
+    "Minimum Mapping QV",
+    "Ignore reads aligned with a lower mapping quality.",
+    PacBio::CLI::Option::IntType(10)
+};
+const PlainOption Variants{
+    "variants",
+    { "variants" },
+    "Variants Output",
+    "Write variant calls to this VCF file.",
+    PacBio::CLI::Option::StringType("")
+};
+const PlainOption ModelPath{
+    "model_path",
+    { "modelPath" },
+    "Model(s) Path",
+    "Path to a model file or directory containing model files.",
+    PacBio::CLI::Option::StringType("")
+};
+const PlainOption ModelSpec{
+    "model_spec",
+    { "modelSpec" },
+    "Model Override",
+    "Name of chemistry or model to use, overriding default selection.",
+    PacBio::CLI::Option::StringType("")
+};
+const PlainOption NumThreads{
+    "num_threads",
+    { "numThreads" },
+    "Number of Threads",
+    "Number of threads to use, 0 means autodetection.",
+    PacBio::CLI::Option::IntType(0)
+};
+const PlainOption LogFile{
+    "log_file",
+    { "logFile" },
+    "Log to a File",
+    "Log to a file, instead of STDERR.",
+    PacBio::CLI::Option::StringType("")
+};
+// clang-format on
+}  // namespace OptionNames
+
+struct GcppSettings
+{
+    size_t WindowSize;
+    size_t WindowFlank;
+    size_t MaxCoverage;
+    uint8_t MinMapQV;
+    string ModelPath;
+    string ModelSpec;
+    string VariantsFile;
+    size_t NThreads;
+    WindowConsensusConfig WindowConfig;
+
+    GcppSettings(const PacBio::CLI::Results& options)
+        : WindowSize(static_cast<int>(options[OptionNames::WindowSize]))
+        , WindowFlank(static_cast<int>(options[OptionNames::WindowFlank]))
+        , MaxCoverage(static_cast<int>(options[OptionNames::MaxCoverage]))
+        , MinMapQV(static_cast<int>(options[OptionNames::MinMapQV]))
+        , ModelPath(std::forward<string>(options[OptionNames::ModelPath]))
+        , ModelSpec(std::forward<string>(options[OptionNames::ModelSpec]))
+        , VariantsFile(std::forward<string>(options[OptionNames::Variants]))
+        , WindowConfig(static_cast<int>(options[OptionNames::MinCoverage]),
+                       options[OptionNames::MinConfidence])
+    {
+        const int m = std::thread::hardware_concurrency();
+        const int n = options[OptionNames::NumThreads];
+        NThreads = n < 1 ? std::max(1, m + n) : std::min(m, n);
+    }
+};
+
+// A window of a reference contig, with the flanking template it is polished on
+struct Window
+{
+    string RefName;
+    size_t RefLength;
+    size_t Start;
+    size_t End;
+    size_t PadStart;
+    size_t PadEnd;
+    string Template;
+};
+
+struct WindowResult
+{
+    string RefName;
+    bool EndsContig;
+    string Sequence;
+    vector<int> Qualities;
+    vector<string> VcfLines;
+};
+
+inline string QVsToASCII(const vector<int>& qvs)
+{
+    string result;
+    result.reserve(qvs.size());
+
+    for (const int qv : qvs) {
+        result.push_back(static_cast<char>(std::min(std::max(0, qv), 93) + 33));
+    }
+
+    return result;
+}
+
+// VCF wants indels anchored on the preceding reference base,
+//   or on the following one at the start of a contig. A variant spanning
+//   the whole window has neither, so it is anchored on an unknown base (N)
+string VcfLine(const Window& win, const Variant& var)
+{
+    const string& tpl = win.Template;
+    size_t pos = win.PadStart + var.RefStart;
+    string refBases = var.RefBases;
+    string altBases = var.AltBases;
+
+    if (refBases.empty() || altBases.empty()) {
+        if (var.RefStart > 0) {
+            --pos;
+            refBases.insert(0, 1, tpl[var.RefStart - 1]);
+            altBases.insert(0, 1, tpl[var.RefStart - 1]);
+        } else if (var.RefEnd < tpl.size()) {
+            refBases.push_back(tpl[var.RefEnd]);
+            altBases.push_back(tpl[var.RefEnd]);
+        } else {
+            refBases.push_back('N');
+            altBases.push_back('N');
+        }
+    }
+
+    std::ostringstream line;
+    line << win.RefName << '\t' << pos + 1 << "\t.\t" << refBases << '\t' << altBases << '\t'
+         << var.Confidence << "\tPASS\tDP=" << var.Coverage;
+    return line.str();
+}
+
+vector<MappedRead> WindowReads(const string& inputFile, const Window& win,
+                               const GcppSettings& settings)
+{
+    DataSet ds(inputFile);
+    GenomicIntervalQuery query(GenomicInterval(win.RefName, win.PadStart, win.PadEnd), ds);
+    vector<MappedRead> reads;
+
+    for (const auto& record : query) {
+        if (!record.IsMapped() || record.MapQuality() < settings.MinMapQV) continue;
+
+        const auto read = record.Clipped(ClipType::CLIP_TO_REFERENCE, win.PadStart, win.PadEnd);
+        const size_t tStart = read.ReferenceStart();
+        const size_t tEnd = read.ReferenceEnd();
+        if (tEnd <= tStart) continue;
+
+        const string seq = read.Sequence(Orientation::NATIVE, false, true);
+
+        vector<uint8_t> ipd;
+        if (read.HasIPD())
+            ipd = read.IPD(Orientation::NATIVE, false, true).Encode();
+        else
+            ipd = vector<uint8_t>(seq.length(), 0);
+
+        vector<uint8_t> pw;
+        if (read.HasPulseWidth())
+            pw = read.PulseWidth(Orientation::NATIVE, false, true).Encode();
+        else
+            pw = vector<uint8_t>(seq.length(), 0);
+
+        const string chem(settings.ModelSpec.empty() ? read.ReadGroup().SequencingChemistry()
+                                                     : settings.ModelSpec);
+        const StrandType strand =
+            read.AlignedStrand() == Strand::FORWARD ? StrandType::FORWARD : StrandType::REVERSE;
+
+        reads.emplace_back(Read(read.FullName(), seq, std::move(ipd), std::move(pw),
+                                SNR(read.SignalToNoise()), chem),
+                           strand, tStart - win.PadStart, tEnd - win.PadStart,
+                           tStart == win.PadStart, tEnd == win.PadEnd);
+    }
+
+    // prefer the reads spanning most of the window
+    if (reads.size() > settings.MaxCoverage) {
+        std::stable_sort(reads.begin(), reads.end(), [](const MappedRead& a, const MappedRead& b) {
+            return a.TemplateEnd - a.TemplateStart > b.TemplateEnd - b.TemplateStart;
+        });
+        reads.resize(settings.MaxCoverage);
+    }
+
+    return reads;
+}
+
+WindowResult PolishWindow(const string& inputFile, const Window& win, const GcppSettings& settings)
+{
+    const auto cns =
+        ConsensusForWindow(win.Template, win.Start - win.PadStart, win.End - win.PadStart,
+                           WindowReads(inputFile, win, settings), settings.WindowConfig);
+
+    WindowResult result{win.RefName, win.End == win.RefLength, cns.Sequence, cns.Qualities, {}};
+    for (const auto& var : cns.Variants)
+        result.VcfLines.emplace_back(VcfLine(win, var));
+
+    PBLOG_DEBUG << win.RefName << ':' << win.Start << '-' << win.End << ": " << cns.Coverage
+                << " reads, " << cns.Variants.size() << " variants";
+
+    return result;
+}
+
+// Concatenates the windows of a contig into a single record
+struct ConsensusWriter
+{
+    ostream& Output;
+    bool IsFastq;
+    std::unique_ptr<ofstream> Vcf;
+    string Sequence;
+    vector<int> Qualities;
+
+    void operator()(WindowResult&& result)
+    {
+        Sequence += result.Sequence;
+        Qualities.insert(Qualities.end(), result.Qualities.begin(), result.Qualities.end());
+
+        if (Vcf) {
+            for (const auto& line : result.VcfLines)
+                *Vcf << line << '\n';
+        }
+
+        if (!result.EndsContig) return;
+
+        const string name = result.RefName + "|arrow";
+        if (IsFastq)
+            Output << '@' << name << '\n' << Sequence << "\n+\n" << QVsToASCII(Qualities) << '\n';
+        else
+            Output << '>' << name << '\n' << Sequence << '\n';
+
+        Output.flush();
+        if (Vcf) Vcf->flush();
+
+        Sequence.clear();
+        Qualities.clear();
+    }
+};
+
+void WriterThread(WorkQueue<WindowResult>& queue, ConsensusWriter& writer)
+{
+    while (queue.ConsumeWith(ref(writer)))
+        ;
+}
+
+static int Runner(const PacBio::CLI::Results& args)
+{
+    // logging
+    //
+    // Initialize logging as the very first step. This allows us to redirect
+    // incorrect CLI usage to a log file.
+    ofstream logStream;
+    {
+        const auto logLevel = args.LogLevel();
+        const string logFile = args[OptionNames::LogFile];
+
+        Logger* logger;
+        if (!logFile.empty()) {
+            logStream.open(logFile);
+            logger = &Logger::Default(new Logger(logStream, logLevel));
+        } else {
+            logger = &Logger::Default(new Logger(cerr, logLevel));
+        }
+        InstallSignalHandlers(*logger);
+    }
+
+    using boost::algorithm::join;
+
+    const vector<string> files = args.PositionalArguments();
+
+    // input validation
+    if (files.size() != 3) {
+        PBLOG_FATAL << "ERROR: Please provide the INPUT, REFERENCE, and OUTPUT files. See --help "
+                       "for more info about positional arguments.";
+        exit(EXIT_FAILURE);
+    }
+
+    const string& inputFile = files[0];
+    const string& referenceFile = files[1];
+    const string& outputFile = files[2];
+
+    const GcppSettings settings(args);
+
+    if (!FileExists(inputFile)) {
+        PBLOG_FATAL << "INPUT: file does not exist: '" + inputFile + "'";
+        exit(EXIT_FAILURE);
+    }
+
+    if (!FileExists(referenceFile)) {
+        PBLOG_FATAL << "REFERENCE: file does not exist: '" + referenceFile + "'";
+        exit(EXIT_FAILURE);
+    }
+
+    if (settings.WindowSize == 0 || settings.WindowFlank == 0) {
+        PBLOG_FATAL << "options --windowSize and --windowFlank must be positive";
+        exit(EXIT_FAILURE);
+    }
+
+    const string outputExt = FileExtension(outputFile);
+    const bool isFastq = outputExt == "fastq" || outputExt == "fq";
+    if (!isFastq && outputExt != "fasta" && outputExt != "fa") {
+        PBLOG_FATAL << "OUTPUT: invalid file extension: '" + outputExt + "'";
+        exit(EXIT_FAILURE);
+    }
+
+    // load models from file or directory
+    if (!settings.ModelPath.empty()) {
+        PBLOG_INFO << "Loading model parameters from: '" << settings.ModelPath << "'";
+        if (!LoadModels(settings.ModelPath)) {
+            PBLOG_FATAL << "Failed to load models from: " << settings.ModelPath;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    DataSet ds(inputFile);
+
+    // test that all input chemistries are supported
+    if (!settings.ModelSpec.empty()) {
+        PBLOG_INFO << "Overriding model selection with: '" << settings.ModelSpec << "'";
+        if (!OverrideModel(settings.ModelSpec)) {
+            PBLOG_FATAL << "Failed to find specified model: " << settings.ModelSpec;
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        const auto avail = SupportedChemistries();
+        set<string> used;
+        try {
+            used = ds.SequencingChemistries();
+        } catch (InvalidSequencingChemistryException& e) {
+            PBLOG_FATAL << e.what();
+            exit(EXIT_FAILURE);
+        }
+
+        vector<string> unavail;
+        set_difference(used.begin(), used.end(), avail.begin(), avail.end(),
+                       back_inserter(unavail));
+
+        if (!unavail.empty()) {
+            PBLOG_FATAL << "Unsupported chemistries found: (" << join(unavail, ", ") << "), "
+                        << "supported chemistries are: (" << join(avail, ", ") << ")";
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!ValidBaseFeatures(ds)) {
+        PBLOG_FATAL << "Missing base features: IPD or PulseWidth";
+        exit(EXIT_FAILURE);
+    }
+
+    IndexedFastaReader reference(referenceFile);
+    const vector<string> refNames = reference.Names();
+
+    ofstream output(outputFile);
+    ConsensusWriter writer{output, isFastq, nullptr, {}, {}};
+
+    if (!settings.VariantsFile.empty()) {
+        writer.Vcf = std::make_unique<ofstream>(settings.VariantsFile);
+        *writer.Vcf << "##fileformat=VCFv4.2\n"
+                    << "##source=" << APPNAME << '-' << PacBio::UnanimityVersion() << '\n'
+                    << "##reference=" << referenceFile << '\n';
+        for (const auto& refName : refNames)
+            *writer.Vcf << "##contig=<ID=" << refName
+                        << ",length=" << reference.SequenceLength(refName) << ">\n";
+        *writer.Vcf << "##INFO=<ID=DP,Number=1,Type=Integer,Description=\"Read Depth\">\n"
+                    << "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n";
+    }
+
+    WorkQueue<WindowResult> workQueue(settings.NThreads);
+    future<void> writerThread = async(launch::async, WriterThread, ref(workQueue), ref(writer));
+
+    // windows are queued in reference order, which is the order they are written in
+    for (const auto& refName : refNames) {
+        const size_t refLength = reference.SequenceLength(refName);
+
+        for (size_t start = 0; start < refLength; start += settings.WindowSize) {
+            Window win;
+            win.RefName = refName;
+            win.RefLength = refLength;
+            win.Start = start;
+            win.End = std::min(refLength, start + settings.WindowSize);
+            win.PadStart = start > settings.WindowFlank ? start - settings.WindowFlank : 0;
+            win.PadEnd = std::min(refLength, win.End + settings.WindowFlank);
+            win.Template = reference.Subsequence(refName, win.PadStart, win.PadEnd);
+            std::transform(win.Template.begin(), win.Template.end(), win.Template.begin(),
+                           [](const char b) { return std::toupper(b); });
+
+            workQueue.ProduceWith(PolishWindow, inputFile, std::move(win), settings);
+        }
+    }
+
+    // wait for the queue to be done
+    workQueue.Finalize();
+    writerThread.get();
+
+    return EXIT_SUCCESS;
+}
+
+// Entry point
+int main(int argc, char* argv[])
+{
+    const auto version =
+        PacBio::UnanimityVersion() + " (commit " + PacBio::UnanimityGitSha1() + ")";
+
+    PacBio::CLI::Interface i{APPNAME, DESCRIPTION, version};
+
+    i.AddHelpOption();      // use built-in help output
+    i.AddLogLevelOption();  // use built-in logLevel option
+    i.AddVersionOption();   // use built-in version output
+
+    // clang-format off
+    i.AddPositionalArguments({
+        {"input",     "Aligned subreads, BAM or DataSet, indexed.", "INPUT"},
+        {"reference", "Reference FASTA, indexed.",                  "REFERENCE"},
+        {"output",    "Consensus FASTA or FASTQ.",                  "OUTPUT"}
+    });
+
+    i.AddOptions(
+    {
+        OptionNames::WindowSize,
+        OptionNames::WindowFlank,
+        OptionNames::MinCoverage,
+        OptionNames::MaxCoverage,
+        OptionNames::MinConfidence,
+        OptionNames::MinMapQV,
+        OptionNames::Variants,
+        OptionNames::ModelPath,
+        OptionNames::ModelSpec,
+        OptionNames::NumThreads,
+        OptionNames::LogFile
+    });
+    // clang-format on
+
+    return PacBio::CLI::Run(argc, argv, i, &Runner);
+}
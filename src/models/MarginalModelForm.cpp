@@ -117,6 +117,7 @@ class MarginalModelCreator : public ModelCreator
 public:
     static ModelForm Form() { return ModelForm::MARGINAL; }
     MarginalModelCreator(const boost::property_tree::ptree& pt);
+    MarginalModelCreator(const ModelParams& params);
     std::unique_ptr<ModelConfig> Create(const SNR& snr) const override
     {
         return std::unique_ptr<ModelConfig>(new MarginalModel(this, snr));
@@ -231,6 +232,12 @@ MarginalModelCreator::MarginalModelCreator(const boost::property_tree::ptree& pt
     }
 }
 
+MarginalModelCreator::MarginalModelCreator(const ModelParams& params)
+{
+    params.Get("EmissionParameters", &emissionPmf_);
+    params.Get("TransitionParameters", &transitionPmf_);
+}
+
 class MarginalModelInitializeModel
 {
 public:
@@ -52,6 +52,7 @@
 #include "../Simulator.h"
 #include "CounterWeight.h"
 #include "HelperFunctions.h"
+#include "TransitionGrid.h"
 
 using namespace PacBio::Data;
 
@@ -121,15 +122,19 @@ class PwSnrAModelCreator : public ModelCreator
 public:
     static ModelForm Form() { return ModelForm::PWSNRA; }
     PwSnrAModelCreator(const boost::property_tree::ptree& pt);
+    PwSnrAModelCreator(const ModelParams& params);
     std::unique_ptr<ModelConfig> Create(const SNR& snr) const override
     {
         return std::unique_ptr<ModelConfig>(new PwSnrAModel(this, snr));
     };
 
 private:
+    void SetTransitionGrid();
+
     double snrRanges_[2];
     double emissionPmf_[3][CONTEXT_NUMBER][OUTCOME_NUMBER];
     double transitionParams_[CONTEXT_NUMBER][3][4];
+    detail::TransitionGrid<CONTEXT_NUMBER> transitions_;
 };
 
 REGISTER_MODELFORM_IMPL(PwSnrAModelCreator);
@@ -153,24 +158,10 @@ inline double PwSnrAModel::CalculateExpectedLLForEmission(const size_t move, con
 PwSnrAModel::PwSnrAModel(const PwSnrAModelCreator* params, const SNR& snr)
     : params_{params}, snr_(snr)
 {
-    const double snr1 = clip(snr_.A, params_->snrRanges_), snr2 = snr1 * snr1, snr3 = snr2 * snr1;
-    for (size_t ctx = 0; ctx < CONTEXT_NUMBER; ++ctx) {
-        double sum = 1.0;
-
-        // cached transitions
-        ctxTrans_[ctx][0] = 1.0;
-        for (size_t j = 0; j < 3; ++j) {
-            double xb = params_->transitionParams_[ctx][j][0] +
-                        params_->transitionParams_[ctx][j][1] * snr1 +
-                        params_->transitionParams_[ctx][j][2] * snr2 +
-                        params_->transitionParams_[ctx][j][3] * snr3;
-            xb = std::exp(xb);
-            ctxTrans_[ctx][j + 1] = xb;
-            sum += xb;
-        }
-        for (size_t j = 0; j < 4; ++j)
-            ctxTrans_[ctx][j] /= sum;
+    // cached transitions
+    params_->transitions_.Interpolate(snr_, ctxTrans_);
 
+    for (size_t ctx = 0; ctx < CONTEXT_NUMBER; ++ctx) {
         // cached expectations
         for (size_t move = 0; move < 3; ++move)
             for (size_t moment = 0; moment < 2; ++moment)
@@ -260,6 +251,7 @@ PwSnrAModelCreator::PwSnrAModelCreator(const boost::property_tree::ptree& pt)
         ReadMatrix<3, CONTEXT_NUMBER, OUTCOME_NUMBER>(emissionPmf_,
                                                       pt.get_child("EmissionParameters"));
         ReadMatrix<CONTEXT_NUMBER, 3, 4>(transitionParams_, pt.get_child("TransitionParameters"));
+        SetTransitionGrid();
     } catch (std::invalid_argument& e) {
         throw MalformedModelFile();
     } catch (boost::property_tree::ptree_error&) {
@@ -267,6 +259,20 @@ PwSnrAModelCreator::PwSnrAModelCreator(const boost::property_tree::ptree& pt)
     }
 }
 
+PwSnrAModelCreator::PwSnrAModelCreator(const ModelParams& params)
+{
+    params.Get("SnrRanges", &snrRanges_);
+    params.Get("EmissionParameters", &emissionPmf_);
+    params.Get("TransitionParameters", &transitionParams_);
+    SetTransitionGrid();
+}
+
+void PwSnrAModelCreator::SetTransitionGrid()
+{
+    for (size_t ctx = 0; ctx < CONTEXT_NUMBER; ++ctx)
+        transitions_.SetContext(ctx, 0, snrRanges_, transitionParams_[ctx]);
+}
+
 class PwSnrAInitializeModel
 {
 public:
@@ -52,6 +52,7 @@
 #include "../Simulator.h"
 #include "CounterWeight.h"
 #include "HelperFunctions.h"
+#include "TransitionGrid.h"
 
 using namespace PacBio::Data;
 
@@ -115,15 +116,19 @@ class SnrModelCreator : public ModelCreator
 public:
     static ModelForm Form() { return ModelForm::SNR; }
     SnrModelCreator(const boost::property_tree::ptree& pt);
+    SnrModelCreator(const ModelParams& params);
     std::unique_ptr<ModelConfig> Create(const SNR& snr) const override
     {
         return std::unique_ptr<ModelConfig>(new SnrModel(this, snr));
     };
 
 private:
+    void SetTransitionGrid();
+
     double snrRanges_[4][2];
     double emissionPmf_[3][1][2];
     double transitionParams_[CONTEXT_NUMBER][3][4];
+    detail::TransitionGrid<CONTEXT_NUMBER> transitions_;
     double substitutionRate_;
 };
 
@@ -131,26 +136,8 @@ REGISTER_MODELFORM_IMPL(SnrModelCreator);
 
 SnrModel::SnrModel(const SnrModelCreator* params, const SNR& snr) : params_{params}, snr_(snr)
 {
-    for (size_t ctx = 0; ctx < CONTEXT_NUMBER; ++ctx) {
-        const uint8_t bp = ctx & 3;  // (equivalent to % 4)
-        const double snr1 = clip(snr_[bp], params_->snrRanges_[bp]), snr2 = snr1 * snr1,
-                     snr3 = snr2 * snr1;
-        double sum = 1.0;
-
-        // cached transitions
-        ctxTrans_[ctx][0] = 1.0;
-        for (size_t j = 0; j < 3; ++j) {
-            double xb = params_->transitionParams_[ctx][j][0] +
-                        params_->transitionParams_[ctx][j][1] * snr1 +
-                        params_->transitionParams_[ctx][j][2] * snr2 +
-                        params_->transitionParams_[ctx][j][3] * snr3;
-            xb = std::exp(xb);
-            ctxTrans_[ctx][j + 1] = xb;
-            sum += xb;
-        }
-        for (size_t j = 0; j < 4; ++j)
-            ctxTrans_[ctx][j] /= sum;
-    }
+    // cached transitions
+    params_->transitions_.Interpolate(snr_, ctxTrans_);
 }
 
 std::unique_ptr<AbstractRecursor> SnrModel::CreateRecursor(const MappedRead& mr,
@@ -258,6 +245,7 @@ SnrModelCreator::SnrModelCreator(const boost::property_tree::ptree& pt)
         substitutionRate_ = pt.get<double>("SubstitutionRate");
         emissionPmf_[0][0][0] = 1.0 - substitutionRate_;
         emissionPmf_[0][0][1] = substitutionRate_ / 3.0;
+        SetTransitionGrid();
     } catch (std::invalid_argument& e) {
         throw MalformedModelFile();
     } catch (boost::property_tree::ptree_error&) {
@@ -265,6 +253,23 @@ SnrModelCreator::SnrModelCreator(const boost::property_tree::ptree& pt)
     }
 }
 
+SnrModelCreator::SnrModelCreator(const ModelParams& params)
+    : emissionPmf_{{{0.0, 0.0}}, {{1.0, 0.0}}, {{0.0, 1.0 / 3.0}}}
+{
+    params.Get("SnrRanges", &snrRanges_);
+    params.Get("TransitionParameters", &transitionParams_);
+    params.Get("SubstitutionRate", &substitutionRate_);
+    emissionPmf_[0][0][0] = 1.0 - substitutionRate_;
+    emissionPmf_[0][0][1] = substitutionRate_ / 3.0;
+    SetTransitionGrid();
+}
+
+void SnrModelCreator::SetTransitionGrid()
+{
+    for (size_t ctx = 0; ctx < CONTEXT_NUMBER; ++ctx)
+        transitions_.SetContext(ctx, ctx & 3, snrRanges_[ctx & 3], transitionParams_[ctx]);
+}
+
 class SnrInitializeModel
 {
 public:
@@ -0,0 +1,170 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include <pacbio/data/Read.h>
+
+namespace PacBio {
+namespace Consensus {
+namespace detail {
+
+// The transition probabilities (match, branch, stick, deletion) of a
+//   context at the given SNR, where params holds the coefficients of the
+//   cubic polynomials in SNR of the branch, stick and deletion log-odds
+//   against match
+inline void TransitionsAt(const double (&params)[3][4], const double snr1, double (&trans)[4])
+{
+    const double snr2 = snr1 * snr1, snr3 = snr2 * snr1;
+    double sum = 1.0;
+
+    trans[0] = 1.0;
+    for (size_t j = 0; j < 3; ++j) {
+        double xb = params[j][0] + params[j][1] * snr1 + params[j][2] * snr2 + params[j][3] * snr3;
+        xb = std::exp(xb);
+        trans[j + 1] = xb;
+        sum += xb;
+    }
+    for (size_t j = 0; j < 4; ++j)
+        trans[j] /= sum;
+}
+
+// A table of the context transition probabilities of an SNR-dependent
+//   model form, and their derivatives, over a uniform grid of SNRs,
+//   interpolated by cubic Hermite splines in between. Every context
+//   depends on the SNR of a single channel only, so the grid over all
+//   four channels factors into one axis per context, and multilinear
+//   interpolation reduces to interpolation along each axis. The table is
+//   built on first use, so models that are loaded but never used cost
+//   nothing. With Intervals points per SNR range the interpolated
+//   probabilities of the shipped models are within 1e-8 of their exact
+//   values (see TestTransitionGrid).
+template <size_t CONTEXT_NUMBER>
+class TransitionGrid
+{
+public:
+    static constexpr size_t Intervals = 256;
+
+    // context ctx takes the SNR of channel, clipped to range, with the
+    //   polynomial coefficients params (see TransitionsAt)
+    void SetContext(const size_t ctx, const size_t channel, const double (&range)[2],
+                    const double (&params)[3][4])
+    {
+        Axis& axis = axes_[ctx];
+        axis.channel = channel;
+        axis.lo = range[0];
+        axis.hi = range[1];
+        axis.step = (range[1] - range[0]) / Intervals;
+        std::copy(&params[0][0], &params[0][0] + 12, &axis.params[0][0]);
+    }
+
+    void Interpolate(const Data::SNR& snr, double (&ctxTrans)[CONTEXT_NUMBER][4]) const
+    {
+        std::call_once(built_, [this] { Build(); });
+
+        for (size_t ctx = 0; ctx < CONTEXT_NUMBER; ++ctx) {
+            const Axis& axis = axes_[ctx];
+            const double x = std::max(axis.lo, std::min(snr[axis.channel], axis.hi));
+            const double t = axis.step > 0.0 ? (x - axis.lo) / axis.step : 0.0;
+            const size_t i = std::min(static_cast<size_t>(t), Intervals - 1);
+
+            // cubic Hermite basis
+            const double u = t - i, u2 = u * u, u3 = u2 * u;
+            const double h00 = 2 * u3 - 3 * u2 + 1, h01 = 3 * u2 - 2 * u3;
+            const double h10 = (u3 - 2 * u2 + u) * axis.step, h11 = (u3 - u2) * axis.step;
+
+            const Knot& lo = table_[ctx * (Intervals + 1) + i];
+            const Knot& hi = table_[ctx * (Intervals + 1) + i + 1];
+            for (size_t j = 0; j < 4; ++j)
+                ctxTrans[ctx][j] =
+                    h00 * lo.trans[j] + h10 * lo.slope[j] + h01 * hi.trans[j] + h11 * hi.slope[j];
+        }
+    }
+
+private:
+    struct Axis
+    {
+        size_t channel;
+        double lo;
+        double hi;
+        double step;
+        double params[3][4];
+    };
+
+    // the transitions at a grid point and their derivatives in SNR
+    struct Knot
+    {
+        double trans[4];
+        double slope[4];
+    };
+
+    void Build() const
+    {
+        table_.resize(CONTEXT_NUMBER * (Intervals + 1));
+        for (size_t ctx = 0; ctx < CONTEXT_NUMBER; ++ctx) {
+            const Axis& axis = axes_[ctx];
+            for (size_t i = 0; i <= Intervals; ++i) {
+                const double x = axis.lo + i * axis.step;
+                Knot& knot = table_[ctx * (Intervals + 1) + i];
+                TransitionsAt(axis.params, x, knot.trans);
+
+                // d trans[j] / d snr = trans[j] * (dz[j] - sum_k trans[k] * dz[k]),
+                //   where z[j] are the log-odds against match
+                double dz[4] = {0.0, 0.0, 0.0, 0.0};
+                double mean = 0.0;
+                for (size_t j = 0; j < 3; ++j) {
+                    dz[j + 1] = axis.params[j][1] + 2 * axis.params[j][2] * x +
+                                3 * axis.params[j][3] * x * x;
+                    mean += knot.trans[j + 1] * dz[j + 1];
+                }
+                for (size_t j = 0; j < 4; ++j)
+                    knot.slope[j] = knot.trans[j] * (dz[j] - mean);
+            }
+        }
+    }
+
+    Axis axes_[CONTEXT_NUMBER];
+    mutable std::once_flag built_;
+    mutable std::vector<Knot> table_;
+};
+}  // namespace detail
+}  // namespace Consensus
+}  // namespace PacBio
@@ -0,0 +1,193 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+// A bump-pointer arena for the rows of POA alignment columns.  Aligning
+// a read to the graph fills thousands of short columns; carving them out
+// of a few large blocks, reused from read to read, keeps the aligners of
+// concurrent ZMWs off the shared heap.
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace PacBio {
+namespace Poa {
+namespace detail {
+
+class ColumnArena
+{
+public:
+    // A position in the arena; Rewind() frees everything allocated after it
+    struct Mark
+    {
+        size_t Block;
+        size_t Used;
+    };
+
+    explicit ColumnArena(size_t blockSize = DefaultBlockSize)
+        : blockSize_(std::max<size_t>(blockSize, 1)), current_(0), used_(0)
+    {
+    }
+
+    ColumnArena(const ColumnArena&) = delete;
+    ColumnArena& operator=(const ColumnArena&) = delete;
+
+    // Uninitialized storage for n objects of type T, valid until the
+    // arena is rewound past it or reset
+    template <typename T>
+    T* Allocate(size_t n)
+    {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "arena objects are never destroyed");
+        return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    Mark GetMark() const { return Mark{current_, used_}; }
+
+    void Rewind(const Mark& mark)
+    {
+        assert(mark.Block < current_ || (mark.Block == current_ && mark.Used <= used_));
+        current_ = mark.Block;
+        used_ = mark.Used;
+    }
+
+    // Free everything.  Memory spread over several blocks is merged into
+    // one, so a steady workload settles into a single block.
+    void Reset()
+    {
+        if (blocks_.size() > 1) {
+            size_t total = 0;
+            for (const Block& b : blocks_)
+                total += b.Size;
+            blocks_.clear();
+            blocks_.push_back(Block{std::unique_ptr<char[]>(new char[total]), total});
+        }
+        current_ = 0;
+        used_ = 0;
+    }
+
+    size_t BytesReserved() const
+    {
+        size_t total = 0;
+        for (const Block& b : blocks_)
+            total += b.Size;
+        return total;
+    }
+
+    size_t NumBlocks() const { return blocks_.size(); }
+
+    static constexpr size_t DefaultBlockSize = 1 << 16;
+
+private:
+    struct Block
+    {
+        std::unique_ptr<char[]> Data;
+        size_t Size;
+    };
+
+    void* allocate(size_t bytes, size_t align)
+    {
+        if (!blocks_.empty()) {
+            const size_t offset = (used_ + align - 1) & ~(align - 1);
+            if (offset + bytes <= blocks_[current_].Size) {
+                used_ = offset + bytes;
+                return blocks_[current_].Data.get() + offset;
+            }
+            ++current_;
+        }
+
+        // Blocks past the current one hold nothing live (they were
+        // rewound or reset), so a too-small one is simply replaced
+        if (current_ == blocks_.size() || blocks_[current_].Size < bytes) {
+            const size_t prevSize = current_ > 0 ? blocks_[current_ - 1].Size : 0;
+            const size_t size = std::max({bytes, blockSize_, 2 * prevSize});
+            Block block{std::unique_ptr<char[]>(new char[size]), size};
+            if (current_ == blocks_.size())
+                blocks_.push_back(std::move(block));
+            else
+                blocks_[current_] = std::move(block);
+        }
+        used_ = bytes;
+        return blocks_[current_].Data.get();
+    }
+
+    std::vector<Block> blocks_;
+    size_t blockSize_;
+    size_t current_;
+    size_t used_;
+};
+
+//
+// The arenas of a POA graph.  Acquire() hands out an arena, reset, that
+// no alignment matrix refers to anymore, so the columns of successive
+// reads reuse the same memory.  Copies of a graph start with no arenas.
+//
+class ColumnArenaPool
+{
+public:
+    ColumnArenaPool() = default;
+    ColumnArenaPool(const ColumnArenaPool&) {}
+    ColumnArenaPool& operator=(const ColumnArenaPool&) { return *this; }
+
+    std::shared_ptr<ColumnArena> Acquire()
+    {
+        for (const auto& arena : arenas_) {
+            if (arena.use_count() == 1) {
+                arena->Reset();
+                return arena;
+            }
+        }
+        auto arena = std::make_shared<ColumnArena>();
+        if (arenas_.size() < MaxPooled) arenas_.push_back(arena);
+        return arena;
+    }
+
+    size_t NumPooled() const { return arenas_.size(); }
+
+    // Matrices alive at once before the pool stops keeping their arenas
+    static constexpr size_t MaxPooled = 4;
+
+private:
+    std::vector<std::shared_ptr<ColumnArena>> arenas_;
+};
+
+}  // namespace detail
+}  // namespace Poa
+}  // namespace PacBio
@@ -0,0 +1,453 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+// A flat, append-friendly DAG used to store the POA graph.  Vertices are
+// dense integer ids (their position in the vertex array), in- and
+// out-adjacencies are kept sorted in packed pools, and a topological
+// order is maintained incrementally as vertices and edges are added.
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace PacBio {
+namespace Poa {
+namespace detail {
+
+// Internal vertex id: the position of the vertex in the graph's arrays
+using VD = size_t;
+static const VD null_vertex = std::numeric_limits<VD>::max();
+
+//
+// A contiguous view of the neighbors of a vertex, sorted by id.  Views
+// are invalidated by any subsequent AddEdge.
+//
+class AdjacencyRange
+{
+public:
+    AdjacencyRange(const VD* begin, const VD* end) : begin_(begin), end_(end) {}
+    const VD* begin() const { return begin_; }
+    const VD* end() const { return end_; }
+    size_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+    bool contains(VD v) const { return std::binary_search(begin_, end_, v); }
+
+private:
+    const VD* begin_;
+    const VD* end_;
+};
+
+//
+// Per-vertex neighbor lists packed into one pool.  Each vertex owns a
+// slot of the pool with some slack; a full slot is moved to the end of
+// the pool with twice the capacity, and the pool is compacted once more
+// than half of it is abandoned slots.
+//
+class PackedAdjacency
+{
+public:
+    PackedAdjacency() : garbage_(0) {}
+
+    void AddVertex()
+    {
+        spans_.push_back(Span{pool_.size(), 0, InitialCapacity});
+        pool_.resize(pool_.size() + InitialCapacity, null_vertex);
+    }
+
+    // Insert u into the neighbor list of v; false if it was already there
+    bool Insert(VD v, VD u)
+    {
+        const VD* first = pool_.data() + spans_[v].Offset;
+        const VD* last = first + spans_[v].Size;
+        const VD* it = std::lower_bound(first, last, u);
+        if (it != last && *it == u) return false;
+        const size_t pos = it - first;
+
+        if (spans_[v].Size == spans_[v].Capacity) grow(v);
+        Span& span = spans_[v];
+        VD* base = pool_.data() + span.Offset;
+        std::copy_backward(base + pos, base + span.Size, base + span.Size + 1);
+        base[pos] = u;
+        ++span.Size;
+        return true;
+    }
+
+    AdjacencyRange Get(VD v) const
+    {
+        const VD* first = pool_.data() + spans_[v].Offset;
+        return AdjacencyRange(first, first + spans_[v].Size);
+    }
+
+    size_t Degree(VD v) const { return spans_[v].Size; }
+
+    // Rebuild the lists for the vertices that survive newIndex (old id ->
+    // new id, or null_vertex if removed); newIndex must be monotone.
+    void Remap(const std::vector<VD>& newIndex)
+    {
+        std::vector<Span> spans;
+        std::vector<VD> pool;
+        for (VD v = 0; v < spans_.size(); ++v) {
+            if (newIndex[v] == null_vertex) continue;
+            const size_t offset = pool.size();
+            for (const VD u : Get(v)) {
+                if (newIndex[u] != null_vertex) pool.push_back(newIndex[u]);
+            }
+            const uint32_t size = pool.size() - offset;
+            const uint32_t capacity = size > InitialCapacity ? size : InitialCapacity;
+            pool.resize(offset + capacity, null_vertex);
+            spans.push_back(Span{offset, size, capacity});
+        }
+        spans_.swap(spans);
+        pool_.swap(pool);
+        garbage_ = 0;
+    }
+
+private:
+    struct Span
+    {
+        size_t Offset;
+        uint32_t Size;
+        uint32_t Capacity;
+    };
+
+    // most POA vertices have one or two neighbors each way
+    static constexpr uint32_t InitialCapacity = 2;
+
+    void grow(VD v)
+    {
+        if (2 * (garbage_ + spans_[v].Capacity) > pool_.size()) compact();
+
+        Span& span = spans_[v];
+        const size_t offset = pool_.size();
+        pool_.resize(offset + 2 * span.Capacity, null_vertex);
+        std::copy(pool_.begin() + span.Offset, pool_.begin() + span.Offset + span.Size,
+                  pool_.begin() + offset);
+        garbage_ += span.Capacity;
+        span.Offset = offset;
+        span.Capacity *= 2;
+    }
+
+    void compact()
+    {
+        std::vector<VD> pool;
+        pool.reserve(pool_.size() - garbage_);
+        for (Span& span : spans_) {
+            const size_t offset = pool.size();
+            pool.insert(pool.end(), pool_.begin() + span.Offset,
+                        pool_.begin() + span.Offset + span.Capacity);
+            span.Offset = offset;
+        }
+        pool_.swap(pool);
+        garbage_ = 0;
+    }
+
+    std::vector<Span> spans_;
+    std::vector<VD> pool_;
+    size_t garbage_;
+};
+
+//
+// The graph proper.  VertexInfo is the per-vertex payload.  Edges are
+// unique; they are also logged in insertion order, which is the order
+// they are written out in.
+//
+// The graph keeps its vertices in a topological order at all times: a
+// linked list carrying order-maintenance labels, so Precedes() is O(1)
+// and a vertex can be placed anywhere in the order when it is added.
+// POA threads a read by adding vertices just before the vertex they
+// lead into, which keeps the order valid as is; an edge that does
+// contradict the order falls back to re-sorting the graph.
+//
+// TopologicalOrder() and TopologicalIndex() are a dense numbering of
+// that order, refreshed by IndexOrder() (a linear walk of the list)
+// after the graph has been changed.
+//
+template <typename VertexInfo>
+class FlatGraph
+{
+public:
+    FlatGraph() : head_(null_vertex), tail_(null_vertex), indexed_(true) {}
+
+    size_t NumVertices() const { return info_.size(); }
+    size_t NumEdges() const { return edges_.size(); }
+
+    // Add a vertex, placed in the order immediately before `before`
+    // (or last, by default)
+    VD AddVertex(const VertexInfo& info, VD before = null_vertex)
+    {
+        const VD v = info_.size();
+        info_.push_back(info);
+        in_.AddVertex();
+        out_.AddVertex();
+        prev_.push_back(null_vertex);
+        next_.push_back(null_vertex);
+        label_.push_back(0);
+        link(v, before);
+        indexed_ = false;
+        return v;
+    }
+
+    // Add the edge u -> v, unless it is already present
+    void AddEdge(VD u, VD v)
+    {
+        assert(u < NumVertices() && v < NumVertices());
+        if (out_.Insert(u, v)) {
+            in_.Insert(v, u);
+            edges_.emplace_back(u, v);
+            if (!Precedes(u, v)) sort();
+            indexed_ = false;
+        }
+    }
+
+    VertexInfo& operator[](VD v) { return info_[v]; }
+    const VertexInfo& operator[](VD v) const { return info_[v]; }
+
+    AdjacencyRange InEdges(VD v) const { return in_.Get(v); }
+    AdjacencyRange OutEdges(VD v) const { return out_.Get(v); }
+    size_t InDegree(VD v) const { return in_.Degree(v); }
+    size_t OutDegree(VD v) const { return out_.Degree(v); }
+
+    // (source, target) pairs in insertion order
+    const std::vector<std::pair<VD, VD>>& Edges() const { return edges_; }
+
+    // Whether u comes before v in the maintained topological order
+    bool Precedes(VD u, VD v) const { return label_[u] < label_[v]; }
+
+    // Number the vertices by their position in the maintained order
+    void IndexOrder()
+    {
+        order_.clear();
+        order_.reserve(NumVertices());
+        for (VD v = head_; v != null_vertex; v = next_[v]) {
+            order_.push_back(v);
+        }
+        assert(order_.size() == NumVertices());
+
+        index_.resize(NumVertices());
+        for (size_t i = 0; i < order_.size(); ++i) {
+            index_[order_[i]] = i;
+        }
+        indexed_ = true;
+    }
+
+    bool IsIndexed() const { return indexed_; }
+
+    const std::vector<VD>& TopologicalOrder() const
+    {
+        assert(indexed_);
+        return order_;
+    }
+
+    size_t TopologicalIndex(VD v) const
+    {
+        assert(indexed_);
+        return index_[v];
+    }
+
+    // Remove every vertex whose payload satisfies pred, along with its
+    // edges, and renumber the survivors densely (preserving their relative
+    // order).  Returns the old id -> new id map, with null_vertex for the
+    // removed vertices.
+    template <typename Predicate>
+    std::vector<VD> RemoveVerticesIf(Predicate pred)
+    {
+        std::vector<VD> newIndex(NumVertices(), null_vertex);
+        std::vector<VertexInfo> info;
+        for (VD v = 0; v < NumVertices(); ++v) {
+            if (!pred(info_[v])) {
+                newIndex[v] = info.size();
+                info.push_back(info_[v]);
+            }
+        }
+        info_.swap(info);
+        in_.Remap(newIndex);
+        out_.Remap(newIndex);
+
+        std::vector<std::pair<VD, VD>> edges;
+        for (const auto& e : edges_) {
+            if (newIndex[e.first] != null_vertex && newIndex[e.second] != null_vertex) {
+                edges.emplace_back(newIndex[e.first], newIndex[e.second]);
+            }
+        }
+        edges_.swap(edges);
+
+        // the survivors keep their labels and their places in the order
+        std::vector<VD> order;
+        for (VD v = head_; v != null_vertex; v = next_[v]) {
+            if (newIndex[v] != null_vertex) order.push_back(v);
+        }
+        relink(order, newIndex);
+        indexed_ = false;
+        return newIndex;
+    }
+
+private:
+    static constexpr uint64_t LabelSpace = uint64_t(1) << 62;
+
+    // Labels of the neighbors of the gap (after, before), exclusive
+    uint64_t lowerLabel(VD after) const { return after == null_vertex ? 0 : label_[after]; }
+    uint64_t upperLabel(VD before) const
+    {
+        if (before == null_vertex) return LabelSpace;
+        return label_[before];
+    }
+
+    void link(VD v, VD before)
+    {
+        VD after = (before == null_vertex ? tail_ : prev_[before]);
+        if (upperLabel(before) - lowerLabel(after) < 2) {
+            relabelAround(before != null_vertex ? before : after);
+        }
+        const uint64_t lo = lowerLabel(after);
+        label_[v] = lo + (upperLabel(before) - lo) / 2;
+
+        prev_[v] = after;
+        next_[v] = before;
+        if (after != null_vertex) {
+            next_[after] = v;
+        } else {
+            head_ = v;
+        }
+        if (before != null_vertex) {
+            prev_[before] = v;
+        } else {
+            tail_ = v;
+        }
+    }
+
+    // Out of labels between two neighbors: grow a window of consecutive
+    // vertices around v until its label range leaves room to spare (a
+    // spacing larger than its size), then spread its labels evenly.
+    void relabelAround(VD v)
+    {
+        VD first = v, last = v;
+        uint64_t count = 1;
+        while (true) {
+            const uint64_t lo = lowerLabel(prev_[first]);
+            const uint64_t step = (upperLabel(next_[last]) - lo) / (count + 1);
+            if (step > count) {
+                uint64_t label = lo;
+                for (VD w = first;; w = next_[w]) {
+                    label += step;
+                    label_[w] = label;
+                    if (w == last) break;
+                }
+                return;
+            }
+            assert(prev_[first] != null_vertex || next_[last] != null_vertex);
+            if (prev_[first] != null_vertex) {
+                first = prev_[first];
+                ++count;
+            }
+            if (next_[last] != null_vertex) {
+                last = next_[last];
+                ++count;
+            }
+        }
+    }
+
+    // Re-link the order list as the given sequence of vertices, renamed by
+    // newIndex (if given), with labels spread evenly if relabel is set
+    void relink(const std::vector<VD>& order, const std::vector<VD>& newIndex, bool relabel = false)
+    {
+        const auto rename = [&newIndex](VD v) { return newIndex.empty() ? v : newIndex[v]; };
+        const size_t n = NumVertices();
+        std::vector<uint64_t> label(n);
+        prev_.assign(n, null_vertex);
+        next_.assign(n, null_vertex);
+        head_ = tail_ = null_vertex;
+        const uint64_t step = LabelSpace / (n + 1);
+        for (size_t i = 0; i < order.size(); ++i) {
+            const VD v = rename(order[i]);
+            label[v] = relabel ? (i + 1) * step : label_[order[i]];
+            if (i == 0) {
+                head_ = v;
+            } else {
+                prev_[v] = tail_;
+                next_[tail_] = v;
+            }
+            tail_ = v;
+        }
+        label_.swap(label);
+    }
+
+    // Recompute the order from scratch (Kahn's algorithm, seeded and
+    // expanded in id order, so it is deterministic)
+    void sort()
+    {
+        const size_t n = NumVertices();
+        std::vector<size_t> pending(n);
+        std::vector<VD> order;
+        order.reserve(n);
+        for (VD v = 0; v < n; ++v) {
+            pending[v] = in_.Degree(v);
+            if (pending[v] == 0) order.push_back(v);
+        }
+        for (size_t head = 0; head < order.size(); ++head) {
+            for (const VD w : out_.Get(order[head])) {
+                if (--pending[w] == 0) order.push_back(w);
+            }
+        }
+        assert(order.size() == n);  // the graph must be acyclic
+        relink(order, std::vector<VD>(), true);
+    }
+
+    std::vector<VertexInfo> info_;
+    PackedAdjacency in_;
+    PackedAdjacency out_;
+    std::vector<std::pair<VD, VD>> edges_;
+
+    // the maintained topological order
+    std::vector<VD> prev_;
+    std::vector<VD> next_;
+    std::vector<uint64_t> label_;
+    VD head_;
+    VD tail_;
+
+    // its dense numbering
+    bool indexed_;
+    std::vector<VD> order_;
+    std::vector<size_t> index_;
+};
+
+}  // namespace detail
+}  // namespace Poa
+}  // namespace PacBio
@@ -43,16 +43,17 @@
 
 #include <pacbio/denovo/PoaGraph.h>
 
-#include <boost/unordered_map.hpp>
-#include <boost/utility.hpp>
+#include <cassert>
 #include <cfloat>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
-#include "BoostGraph.h"
+#include "ColumnArena.h"
+#include "FlatGraph.h"
 #include "VectorL.h"
 
-using boost::noncopyable;
-using boost::unordered_map;
-
 namespace PacBio {
 namespace Poa {
 namespace detail {
@@ -69,47 +70,89 @@ enum MoveType
     ExtraMove
 };
 
-struct AlignmentColumn : noncopyable
+struct AlignmentColumn
 {
     VD CurrentVertex;
     VectorL<float> Score;
     VectorL<MoveType> ReachingMove;
     VectorL<VD> PreviousVertex;
 
-    AlignmentColumn(VD vertex, int beginRow, int endRow)
+    AlignmentColumn(ColumnArena& arena, VD vertex, int beginRow, int endRow)
         : CurrentVertex(vertex)
-        , Score(beginRow, endRow, -FLT_MAX)
-        , ReachingMove(beginRow, endRow, InvalidMove)
-        , PreviousVertex(beginRow, endRow, null_vertex)
+        , Score(arena, beginRow, endRow, -FLT_MAX)
+        , ReachingMove(arena, beginRow, endRow, InvalidMove)
+        , PreviousVertex(arena, beginRow, endRow, null_vertex)
     {
     }
 
-    ~AlignmentColumn() {}
     size_t BeginRow() const { return Score.BeginRow(); }
     size_t EndRow() const { return Score.EndRow(); }
     bool HasRow(size_t i) const { return (BeginRow() <= i) && (i < EndRow()); }
 };
 
-using AlignmentColumnMap = unordered_map<VD, const AlignmentColumn*>;
+//
+// The alignment columns of a read, stored densely in the topological
+// order in which they are computed, with their rows (and any scratch
+// space of the fill) in an arena.  Vertices are looked up through their
+// position in that order, recorded as the columns are added, as the
+// graph changes under the columns when the read is threaded.
+//
+class AlignmentColumnMap
+{
+public:
+    AlignmentColumnMap(size_t numVertices, std::shared_ptr<ColumnArena> arena)
+        : position_(numVertices, null_vertex), arena_(std::move(arena))
+    {
+        columns_.reserve(numVertices);
+    }
+
+    AlignmentColumn& Add(VD v, int beginRow, int endRow)
+    {
+        assert(position_.at(v) == null_vertex);
+        assert(columns_.size() < columns_.capacity());  // keeps references stable
+        position_[v] = columns_.size();
+        columns_.emplace_back(*arena_, v, beginRow, endRow);
+        return columns_.back();
+    }
+
+    // The column of v; nullptr if it was not aligned
+    const AlignmentColumn* at(VD v) const
+    {
+        const size_t pos = position_.at(v);
+        return pos == null_vertex ? nullptr : &columns_[pos];
+    }
+
+    size_t size() const { return columns_.size(); }
+    ColumnArena& Arena() const { return *arena_; }
+
+private:
+    std::vector<AlignmentColumn> columns_;
+    std::vector<size_t> position_;
+    std::shared_ptr<ColumnArena> arena_;
+};
 
 class PoaAlignmentMatrixImpl : public PoaAlignmentMatrix
 {
 public:
-    virtual ~PoaAlignmentMatrixImpl()
+    PoaAlignmentMatrixImpl(const PoaGraphImpl* graph, const std::string& readSequence,
+                           PacBio::Align::AlignMode mode, size_t numVertices,
+                           std::shared_ptr<ColumnArena> arena)
+        : graph_(graph)
+        , columns_(numVertices, std::move(arena))
+        , readSequence_(readSequence)
+        , mode_(mode)
+        , score_(-FLT_MAX)
     {
-        for (auto& kv : columns_) {
-            delete kv.second;
-        }
     }
 
+    virtual ~PoaAlignmentMatrixImpl() {}
+
     virtual float Score() const { return score_; }
     size_t NumRows() const { return readSequence_.length() + 1; }
     size_t NumCols() const { return columns_.size(); }
     void Print() const;
 
 public:
-    // TODO: why did I leave these public?  why is there no
-    // constructor?
     const PoaGraphImpl* graph_;
     AlignmentColumnMap columns_;
     std::string readSequence_;
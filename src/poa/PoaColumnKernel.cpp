@@ -0,0 +1,329 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cfloat>
+#include <cstring>
+
+#include "PoaColumnKernel.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define POA_COLUMN_SIMD 1
+#include <immintrin.h>
+#else
+#define POA_COLUMN_SIMD 0
+#endif
+
+using namespace PacBio::Align;
+
+namespace PacBio {
+namespace Poa {
+namespace detail {
+
+namespace {
+
+inline void Update(const float candidate, const uint32_t move, float* score, uint32_t* trace)
+{
+    if (candidate > *score) {
+        *score = candidate;
+        *trace = move;
+    }
+}
+
+// The reference implementation, row by row
+void FillScalar(const PredecessorScores* preds, const size_t nPreds, const char* read,
+                const char base, const AlignParams& params, const int beginRow, const int endRow,
+                float* score, uint32_t* trace)
+{
+    for (int i = beginRow; i < endRow; ++i) {
+        const bool isMatch = read[i - 1] == base;
+        const float matchScore = isMatch ? params.Match : params.Mismatch;
+        const MoveType matchMove = isMatch ? MatchMove : MismatchMove;
+        float* s = score + (i - beginRow);
+        uint32_t* t = trace + (i - beginRow);
+        for (size_t p = 0; p < nPreds; ++p) {
+            const PredecessorScores& pred = preds[p];
+            if (pred.BeginRow <= i - 1 && i - 1 < pred.EndRow)
+                Update(pred.Score[i - 1 - pred.BeginRow] + matchScore, PackTrace(p, matchMove), s,
+                       t);
+            if (pred.BeginRow <= i && i < pred.EndRow)
+                Update(pred.Score[i - pred.BeginRow] + params.Delete, PackTrace(p, DeleteMove), s,
+                       t);
+        }
+    }
+}
+
+size_t ArgMaxScalar(const float* score, const size_t n)
+{
+    return std::distance(score, std::max_element(score, score + n));
+}
+
+#if POA_COLUMN_SIMD
+
+// The vector kernels run down the rows of the column, one predecessor
+// (and move) at a time.  As the rows are independent, and each row still
+// sees the candidates in the same order, this picks the same moves as
+// FillScalar.  Leftover rows use the scalar update.
+
+__attribute__((target("sse4.1"))) void FillSse41(const PredecessorScores* preds,
+                                                 const size_t nPreds, const char* read,
+                                                 const char base, const AlignParams& params,
+                                                 const int beginRow, const int endRow, float* score,
+                                                 uint32_t* trace)
+{
+    const __m128i vbase = _mm_set1_epi32(static_cast<unsigned char>(base));
+    const __m128 vmatch = _mm_set1_ps(params.Match);
+    const __m128 vmismatch = _mm_set1_ps(params.Mismatch);
+    const __m128 vdelete = _mm_set1_ps(params.Delete);
+
+    for (size_t p = 0; p < nPreds; ++p) {
+        const PredecessorScores& pred = preds[p];
+        const __m128i vm = _mm_set1_epi32(PackTrace(p, MatchMove));
+        const __m128i vx = _mm_set1_epi32(PackTrace(p, MismatchMove));
+        const __m128i vd = _mm_set1_epi32(PackTrace(p, DeleteMove));
+
+        // (mis)match from row i - 1
+        int i = std::max(beginRow, pred.BeginRow + 1);
+        const int matchEnd = std::min(endRow, pred.EndRow + 1);
+        for (; i + 4 <= matchEnd; i += 4) {
+            int32_t bases;
+            std::memcpy(&bases, read + i - 1, sizeof(bases));
+            const __m128i eq = _mm_cmpeq_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(bases)), vbase);
+            const __m128 cand = _mm_add_ps(_mm_loadu_ps(pred.Score + (i - 1 - pred.BeginRow)),
+                                           _mm_blendv_ps(vmismatch, vmatch, _mm_castsi128_ps(eq)));
+            float* s = score + (i - beginRow);
+            auto* t = reinterpret_cast<__m128i*>(trace + (i - beginRow));
+            const __m128 best = _mm_loadu_ps(s);
+            const __m128i gt = _mm_castps_si128(_mm_cmpgt_ps(cand, best));
+            _mm_storeu_ps(s, _mm_blendv_ps(best, cand, _mm_castsi128_ps(gt)));
+            const __m128i moves = _mm_blendv_epi8(vx, vm, eq);
+            _mm_storeu_si128(t, _mm_blendv_epi8(_mm_loadu_si128(t), moves, gt));
+        }
+        for (; i < matchEnd; ++i) {
+            const bool isMatch = read[i - 1] == base;
+            Update(pred.Score[i - 1 - pred.BeginRow] + (isMatch ? params.Match : params.Mismatch),
+                   PackTrace(p, isMatch ? MatchMove : MismatchMove), score + (i - beginRow),
+                   trace + (i - beginRow));
+        }
+
+        // deletion from row i
+        i = std::max(beginRow, pred.BeginRow);
+        const int deleteEnd = std::min(endRow, pred.EndRow);
+        for (; i + 4 <= deleteEnd; i += 4) {
+            const __m128 cand = _mm_add_ps(_mm_loadu_ps(pred.Score + (i - pred.BeginRow)), vdelete);
+            float* s = score + (i - beginRow);
+            auto* t = reinterpret_cast<__m128i*>(trace + (i - beginRow));
+            const __m128 best = _mm_loadu_ps(s);
+            const __m128i gt = _mm_castps_si128(_mm_cmpgt_ps(cand, best));
+            _mm_storeu_ps(s, _mm_blendv_ps(best, cand, _mm_castsi128_ps(gt)));
+            _mm_storeu_si128(t, _mm_blendv_epi8(_mm_loadu_si128(t), vd, gt));
+        }
+        for (; i < deleteEnd; ++i) {
+            Update(pred.Score[i - pred.BeginRow] + params.Delete, PackTrace(p, DeleteMove),
+                   score + (i - beginRow), trace + (i - beginRow));
+        }
+    }
+}
+
+__attribute__((target("avx2"))) void FillAvx2(const PredecessorScores* preds, const size_t nPreds,
+                                              const char* read, const char base,
+                                              const AlignParams& params, const int beginRow,
+                                              const int endRow, float* score, uint32_t* trace)
+{
+    const __m256i vbase = _mm256_set1_epi32(static_cast<unsigned char>(base));
+    const __m256 vmatch = _mm256_set1_ps(params.Match);
+    const __m256 vmismatch = _mm256_set1_ps(params.Mismatch);
+    const __m256 vdelete = _mm256_set1_ps(params.Delete);
+
+    for (size_t p = 0; p < nPreds; ++p) {
+        const PredecessorScores& pred = preds[p];
+        const __m256i vm = _mm256_set1_epi32(PackTrace(p, MatchMove));
+        const __m256i vx = _mm256_set1_epi32(PackTrace(p, MismatchMove));
+        const __m256i vd = _mm256_set1_epi32(PackTrace(p, DeleteMove));
+
+        // (mis)match from row i - 1
+        int i = std::max(beginRow, pred.BeginRow + 1);
+        const int matchEnd = std::min(endRow, pred.EndRow + 1);
+        for (; i + 8 <= matchEnd; i += 8) {
+            const __m128i bases = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(read + i - 1));
+            const __m256i eq = _mm256_cmpeq_epi32(_mm256_cvtepu8_epi32(bases), vbase);
+            const __m256 cand =
+                _mm256_add_ps(_mm256_loadu_ps(pred.Score + (i - 1 - pred.BeginRow)),
+                              _mm256_blendv_ps(vmismatch, vmatch, _mm256_castsi256_ps(eq)));
+            float* s = score + (i - beginRow);
+            auto* t = reinterpret_cast<__m256i*>(trace + (i - beginRow));
+            const __m256 best = _mm256_loadu_ps(s);
+            const __m256i gt = _mm256_castps_si256(_mm256_cmp_ps(cand, best, _CMP_GT_OQ));
+            _mm256_storeu_ps(s, _mm256_blendv_ps(best, cand, _mm256_castsi256_ps(gt)));
+            _mm256_storeu_si256(
+                t, _mm256_blendv_epi8(_mm256_loadu_si256(t), _mm256_blendv_epi8(vx, vm, eq), gt));
+        }
+        for (; i < matchEnd; ++i) {
+            const bool isMatch = read[i - 1] == base;
+            Update(pred.Score[i - 1 - pred.BeginRow] + (isMatch ? params.Match : params.Mismatch),
+                   PackTrace(p, isMatch ? MatchMove : MismatchMove), score + (i - beginRow),
+                   trace + (i - beginRow));
+        }
+
+        // deletion from row i
+        i = std::max(beginRow, pred.BeginRow);
+        const int deleteEnd = std::min(endRow, pred.EndRow);
+        for (; i + 8 <= deleteEnd; i += 8) {
+            const __m256 cand =
+                _mm256_add_ps(_mm256_loadu_ps(pred.Score + (i - pred.BeginRow)), vdelete);
+            float* s = score + (i - beginRow);
+            auto* t = reinterpret_cast<__m256i*>(trace + (i - beginRow));
+            const __m256 best = _mm256_loadu_ps(s);
+            const __m256i gt = _mm256_castps_si256(_mm256_cmp_ps(cand, best, _CMP_GT_OQ));
+            _mm256_storeu_ps(s, _mm256_blendv_ps(best, cand, _mm256_castsi256_ps(gt)));
+            _mm256_storeu_si256(t, _mm256_blendv_epi8(_mm256_loadu_si256(t), vd, gt));
+        }
+        for (; i < deleteEnd; ++i) {
+            Update(pred.Score[i - pred.BeginRow] + params.Delete, PackTrace(p, DeleteMove),
+                   score + (i - beginRow), trace + (i - beginRow));
+        }
+    }
+}
+
+// Find the maximum in vectors, then the first row holding it
+__attribute__((target("sse4.1"))) size_t ArgMaxSse41(const float* score, const size_t n)
+{
+    if (n < 4) return ArgMaxScalar(score, n);
+    __m128 vmax = _mm_loadu_ps(score);
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4)
+        vmax = _mm_max_ps(vmax, _mm_loadu_ps(score + i));
+    float lanes[4];
+    _mm_storeu_ps(lanes, vmax);
+    float best = *std::max_element(lanes, lanes + 4);
+    for (; i < n; ++i)
+        best = std::max(best, score[i]);
+    return std::distance(score, std::find(score, score + n, best));
+}
+
+__attribute__((target("avx2"))) size_t ArgMaxAvx2(const float* score, const size_t n)
+{
+    if (n < 8) return ArgMaxScalar(score, n);
+    __m256 vmax = _mm256_loadu_ps(score);
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8)
+        vmax = _mm256_max_ps(vmax, _mm256_loadu_ps(score + i));
+    float lanes[8];
+    _mm256_storeu_ps(lanes, vmax);
+    float best = *std::max_element(lanes, lanes + 8);
+    for (; i < n; ++i)
+        best = std::max(best, score[i]);
+    return std::distance(score, std::find(score, score + n, best));
+}
+
+#endif  // POA_COLUMN_SIMD
+
+ColumnKernel DetectColumnKernel()
+{
+#if POA_COLUMN_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return ColumnKernel::AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return ColumnKernel::SSE41;
+#endif
+    return ColumnKernel::SCALAR;
+}
+
+std::atomic<ColumnKernel>& ActiveKernel()
+{
+    static std::atomic<ColumnKernel> active(BestColumnKernel());
+    return active;
+}
+
+}  // namespace anonymous
+
+ColumnKernel BestColumnKernel()
+{
+    static const ColumnKernel best = DetectColumnKernel();
+    return best;
+}
+
+ColumnKernel ActiveColumnKernel() { return ActiveKernel().load(std::memory_order_relaxed); }
+
+ColumnKernel UseColumnKernel(ColumnKernel kernel)
+{
+    if (kernel > BestColumnKernel()) kernel = BestColumnKernel();
+    ActiveKernel().store(kernel);
+    return kernel;
+}
+
+void FillPredecessorMoves(const ColumnKernel kernel, const PredecessorScores* preds,
+                          const size_t nPreds, const std::string& read, const char base,
+                          const AlignParams& params, const bool local, const int beginRow,
+                          const int endRow, float* score, uint32_t* trace)
+{
+    assert(0 < beginRow && beginRow <= endRow && endRow <= static_cast<int>(read.size()) + 1);
+
+    const size_t nRows = endRow - beginRow;
+    std::fill_n(score, nRows, local ? 0.0f : -FLT_MAX);
+    std::fill_n(trace, nRows, PackTrace(nPreds, local ? StartMove : InvalidMove));
+
+    switch (kernel) {
+#if POA_COLUMN_SIMD
+        case ColumnKernel::AVX2:
+            FillAvx2(preds, nPreds, read.data(), base, params, beginRow, endRow, score, trace);
+            return;
+        case ColumnKernel::SSE41:
+            FillSse41(preds, nPreds, read.data(), base, params, beginRow, endRow, score, trace);
+            return;
+#endif
+        default:
+            FillScalar(preds, nPreds, read.data(), base, params, beginRow, endRow, score, trace);
+    }
+}
+
+size_t ColumnArgMax(const ColumnKernel kernel, const float* score, const size_t n)
+{
+    switch (kernel) {
+#if POA_COLUMN_SIMD
+        case ColumnKernel::AVX2:
+            return ArgMaxAvx2(score, n);
+        case ColumnKernel::SSE41:
+            return ArgMaxSse41(score, n);
+#endif
+        default:
+            return ArgMaxScalar(score, n);
+    }
+}
+
+}  // namespace detail
+}  // namespace Poa
+}  // namespace PacBio
@@ -0,0 +1,106 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+// The inner loop of POA alignment: scoring the moves from the
+// predecessor columns into a column, with scalar, SSE4.1 and AVX2
+// implementations picked at runtime.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <pacbio/align/AlignConfig.h>
+
+#include "PoaAlignmentMatrix.h"
+
+namespace PacBio {
+namespace Poa {
+namespace detail {
+
+enum struct ColumnKernel : uint8_t
+{
+    SCALAR = 0,
+    SSE41 = 1,
+    AVX2 = 2
+};
+
+// The best kernel the running CPU supports
+ColumnKernel BestColumnKernel();
+
+// The kernel used for alignment, BestColumnKernel() unless overridden
+ColumnKernel ActiveColumnKernel();
+
+// Override the kernel used for alignment (clamped to BestColumnKernel(),
+// which is returned if the request is not supported); for testing
+ColumnKernel UseColumnKernel(ColumnKernel kernel);
+
+// Rows [BeginRow, EndRow) of a predecessor column; Score[0] is BeginRow
+struct PredecessorScores
+{
+    const float* Score;
+    int BeginRow;
+    int EndRow;
+};
+
+// The traceback of a cell, packed as the index of the predecessor column
+// (for match, mismatch and delete moves) and the move
+inline uint32_t PackTrace(size_t predecessor, MoveType move)
+{
+    return static_cast<uint32_t>(predecessor << 3) | static_cast<uint32_t>(move);
+}
+inline MoveType TraceMove(uint32_t trace) { return static_cast<MoveType>(trace & 7); }
+inline size_t TracePredecessor(uint32_t trace) { return trace >> 3; }
+
+// Score the moves from the predecessor columns into rows [beginRow,
+// endRow) of the column of a vertex, beginRow > 0.  Each row takes the
+// first strictly best of, per predecessor in order, the match or mismatch
+// of read[i - 1] against base from row i - 1 and the deletion from row
+// i, over a baseline of a 0-scoring start move (LOCAL) or an invalid
+// move at -FLT_MAX, traced to predecessor nPreds.  Extra moves are
+// left to the caller, as they chain down the column.  score and trace
+// hold the rows from beginRow on.
+void FillPredecessorMoves(ColumnKernel kernel, const PredecessorScores* preds, size_t nPreds,
+                          const std::string& read, char base,
+                          const PacBio::Align::AlignParams& params, bool local, int beginRow,
+                          int endRow, float* score, uint32_t* trace);
+
+// The offset of the first maximum of score[0, n), 0 if n is 0
+size_t ColumnArgMax(ColumnKernel kernel, const float* score, size_t n);
+
+}  // namespace detail
+}  // namespace Poa
+}  // namespace PacBio
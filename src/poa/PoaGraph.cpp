@@ -76,13 +76,38 @@ void PoaGraph::CommitAdd(PoaAlignmentMatrix* mat, std::vector<Vertex>* readPathO
 
 void PoaGraph::PruneGraph(const int minCoverage) { impl->PruneGraph(minCoverage); }
 
+size_t PoaGraph::PruneUnsupportedVertices(const float minSupport)
+{
+    return impl->PruneUnsupportedVertices(minSupport);
+}
+
+void PoaGraph::MergeGraph(const PoaGraph& other, const AlignConfig& config, bool reverse,
+                          detail::SdpRangeFinder* rangeFinder, std::vector<Vertex>* vertexMap)
+{
+    impl->MergeGraph(*other.impl, config, reverse, rangeFinder, vertexMap);
+}
+
 size_t PoaGraph::NumReads() const { return impl->NumReads(); }
 
+size_t PoaGraph::NumVertices() const { return impl->NumVertices(); }
+
+size_t PoaGraph::NumEdges() const { return impl->NumEdges(); }
+
 const PoaConsensus* PoaGraph::FindConsensus(const AlignConfig& config, int minCoverage) const
 {
     return impl->FindConsensus(config, minCoverage);
 }
 
+std::string PoaGraph::FindConsensusSequence(const AlignConfig& config, int minCoverage) const
+{
+    return impl->FindConsensusSequence(config, minCoverage);
+}
+
+size_t PoaGraph::NumUndecidedVertices(int minMargin) const
+{
+    return impl->NumUndecidedVertices(minMargin);
+}
+
 string PoaGraph::ToGraphViz(int flags, const PoaConsensus* pc) const
 {
     return impl->ToGraphViz(flags, pc);
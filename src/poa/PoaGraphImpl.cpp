@@ -33,43 +33,50 @@
 // OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
 // SUCH DAMAGE.
 
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
 #include <set>
+#include <sstream>
 
-#include <boost/foreach.hpp>
-#include <boost/graph/copy.hpp>
-#include <boost/graph/graphviz.hpp>
-#include <boost/graph/topological_sort.hpp>
+#include <boost/format.hpp>
 
 #include <pacbio/align/AlignConfig.h>
+#include <pacbio/data/Sequence.h>
 #include <pacbio/denovo/PoaConsensus.h>
 #include <pacbio/denovo/PoaGraph.h>
 #include <pacbio/denovo/RangeFinder.h>
 
+#include "PoaColumnKernel.h"
 #include "PoaGraphImpl.h"
 
 using namespace PacBio::Align;
 
-namespace boost {
+namespace PacBio {
+namespace Poa {
+namespace detail {
 
-using namespace PacBio::Poa::detail;
-using namespace PacBio::Poa;
 using boost::format;
 
+namespace {
+
 class my_label_writer
 {
 public:
-    my_label_writer(VertexInfoMap map, bool color, bool verbose, const PoaConsensus* pc = nullptr)
-        : map_(map), cssVtxs_(), color_(color), verbose_(verbose)
+    my_label_writer(const PoaGraphStorage& g, bool color, bool verbose,
+                    const PoaConsensus* pc = nullptr)
+        : g_(g), cssVtxs_(), color_(color), verbose_(verbose)
     {
         if (pc != nullptr) {
             cssVtxs_.insert(pc->Path.begin(), pc->Path.end());
         }
     }
 
-    template <class descriptor>
-    void operator()(std::ostream& out, const descriptor& v) const
+    void operator()(std::ostream& out, const VD v) const
     {
-        PoaGraph::Vertex vertexId = map_[v].Id;
+        const PoaNode& node = g_[v];
+        PoaGraph::Vertex vertexId = node.Id;
 
         std::string nodeColoringAttribute =
             (color_ && isInConsensus(vertexId) ? R"( style="filled", fillcolor="lightblue" ,)"
@@ -77,21 +84,21 @@ public:
 
         if (!verbose_) {
             out << format("[shape=Mrecord,%s label=\"{ %c | %d }\"]") % nodeColoringAttribute %
-                       map_[v].Base % map_[v].Reads;
+                       node.Base % node.Reads;
         } else {
             out << format(
                        "[shape=Mrecord,%s label=\"{ "
                        "{ %d | %c } | "
                        "{ %d | %d } | "
                        "{ %0.2f | %0.2f } }\"]") %
-                       nodeColoringAttribute % vertexId % map_[v].Base % map_[v].Reads %
-                       map_[v].SpanningReads % map_[v].Score % map_[v].ReachingScore;
+                       nodeColoringAttribute % vertexId % node.Base % node.Reads %
+                       node.SpanningReads % node.Score % node.ReachingScore;
         }
     }
 
 private:
     bool isInConsensus(PoaGraph::Vertex v) const { return cssVtxs_.find(v) != cssVtxs_.end(); }
-    VertexInfoMap map_;
+    const PoaGraphStorage& g_;
     std::set<PoaGraph::Vertex> cssVtxs_;
     bool color_;
     bool verbose_;
@@ -110,28 +117,33 @@ private:
     bool leftToRight_;
 };
 
-}  // namespace boost
+// Same layout as boost::write_graphviz: vertices by id, then edges in
+// the order they were added
+void write_graphviz(std::ostream& out, const PoaGraphStorage& g, const my_label_writer& vpw,
+                    const my_graph_writer& gpw)
+{
+    out << "digraph G {" << std::endl;
+    gpw(out);
+    for (VD v = 0; v < g.NumVertices(); ++v) {
+        out << v;
+        vpw(out, v);
+        out << ";" << std::endl;
+    }
+    for (const auto& e : g.Edges()) {
+        out << e.first << "->" << e.second << " ;" << std::endl;
+    }
+    out << "}" << std::endl;
+}
 
-namespace PacBio {
-namespace Poa {
-namespace detail {
+}  // namespace anonymous
 
 // ----------------- PoaGraphImpl ---------------------
 
-PoaGraphImpl::PoaGraphImpl()
-    : g_(), vertexInfoMap_(get(vertex_info, g_)), numReads_(0), totalVertices_(0), liveVertices_(0)
+PoaGraphImpl::PoaGraphImpl() : g_(), numReads_(0), totalVertices_(0), spansResolved_(true)
 {
     enterVertex_ = addVertex('^', 0);
     exitVertex_ = addVertex('$', 0);
-}
-
-PoaGraphImpl::PoaGraphImpl(const PoaGraphImpl& other)
-    : g_(other.g_)
-    , vertexInfoMap_(get(vertex_info, g_))
-    , enterVertex_(other.enterVertex_)
-    , exitVertex_(other.exitVertex_)
-    , numReads_(other.numReads_)
-{
+    g_.IndexOrder();
 }
 
 PoaGraphImpl::~PoaGraphImpl() = default;
@@ -139,54 +151,59 @@ void PoaGraphImpl::repCheck() const
 {
 #ifndef NDEBUG
     // assert the representation invariant for the object
-    BOOST_FOREACH (const VD v, vertices(g_)) {
+    assert(g_.IsIndexed());
+    for (VD v = 0; v < g_.NumVertices(); ++v) {
         if (v == enterVertex_) {
-            assert(in_degree(v, g_) == 0);
-            assert(out_degree(v, g_) > 0 || NumReads() == 0);
+            assert(g_.InDegree(v) == 0);
+            assert(g_.OutDegree(v) > 0 || NumReads() == 0);
         } else if (v == exitVertex_) {
-            assert(in_degree(v, g_) > 0 || NumReads() == 0);
-            assert(out_degree(v, g_) == 0);
+            assert(g_.InDegree(v) > 0 || NumReads() == 0);
+            assert(g_.OutDegree(v) == 0);
         } else {
-            assert(in_degree(v, g_) > 0);
-            assert(out_degree(v, g_) > 0);
+            assert(g_.InDegree(v) > 0);
+            assert(g_.OutDegree(v) > 0);
         }
     }
 #endif
 }
 
-static inline vector<const AlignmentColumn*> getPredecessorColumns(const BoostGraph& g, VD v,
-                                                                   const AlignmentColumnMap& colMap)
-{
-    vector<const AlignmentColumn*> predecessorColumns;
-    const AlignmentColumn* predCol;
-    for (auto e : inEdges(v, g)) {
-        VD u = source(e, g);
-        predCol = colMap.at(u);
-        assert(predCol != nullptr);
-        predecessorColumns.push_back(predCol);
-    }
-    return predecessorColumns;
-}
-
 PoaConsensus* PoaGraphImpl::FindConsensus(const AlignConfig& config, int minCoverage)
 {
     std::vector<VD> bestPath = consensusPath(config.Mode, minCoverage);
-    std::string consensusSequence = sequenceAlongPath(g_, vertexInfoMap_, bestPath);
+    std::string consensusSequence = sequenceAlongPath(g_, bestPath);
     PoaConsensus* pc = new PoaConsensus(consensusSequence, *this, externalizePath(bestPath));
     return pc;
 }
 
-const AlignmentColumn* PoaGraphImpl::makeAlignmentColumnForExit(VD v,
-                                                                const AlignmentColumnMap& colMap,
+std::string PoaGraphImpl::FindConsensusSequence(const AlignConfig& config, int minCoverage) const
+{
+    return sequenceAlongPath(g_, consensusPath(config.Mode, minCoverage));
+}
+
+size_t PoaGraphImpl::NumUndecidedVertices(const int minMargin) const
+{
+    resolveSpans();
+    size_t nUndecided = 0;
+    for (VD v = 0; v < g_.NumVertices(); ++v) {
+        const PoaNode& node = g_[v];
+        if (v == enterVertex_ || v == exitVertex_ ||
+            2 * static_cast<size_t>(node.SpanningReads) < numReads_)
+            continue;
+        if (std::abs(2 * node.Reads - node.SpanningReads) < minMargin) ++nUndecided;
+    }
+    return nUndecided;
+}
+
+const AlignmentColumn* PoaGraphImpl::makeAlignmentColumnForExit(VD v, AlignmentColumnMap* colMap,
                                                                 const std::string& sequence,
                                                                 const AlignConfig& config) const
 {
-    assert(out_degree(v, g_) == 0);
+    assert(g_.OutDegree(v) == 0);
 
     // this is kind of unnecessary as we are only actually using one entry in
     // this column
     int I = sequence.length();
-    auto* curCol = new AlignmentColumn(v, 0, I + 1);
+    AlignmentColumn& curCol = colMap->Add(v, 0, I + 1);
 
     float bestScore = -FLT_MAX;
     VD prevVertex = null_vertex;
@@ -197,10 +214,16 @@ const AlignmentColumn* PoaGraphImpl::makeAlignmentColumnForExit(VD v,
     // the graph.  In local alignment, it may have been from any
     // row, not necessarily I.
     if (config.Mode == AlignMode::SEMIGLOBAL || config.Mode == AlignMode::LOCAL) {
-        BOOST_FOREACH (const VD u, vertices(g_)) {
+        const ColumnKernel kernel = ActiveColumnKernel();
+        for (VD u = 0; u < g_.NumVertices(); ++u) {
             if (u != exitVertex_) {
-                const AlignmentColumn* predCol = colMap.at(u);
-                int prevRow = (config.Mode == AlignMode::LOCAL ? ArgMax(predCol->Score) : I);
+                const AlignmentColumn* predCol = colMap->at(u);
+                int prevRow = I;
+                if (config.Mode == AlignMode::LOCAL) {
+                    const size_t nRows = predCol->EndRow() - predCol->BeginRow();
+                    prevRow =
+                        predCol->BeginRow() + ColumnArgMax(kernel, predCol->Score.Data(), nRows);
+                }
                 if (predCol->HasRow(prevRow) && predCol->Score[prevRow] > bestScore) {
                     bestScore = predCol->Score[prevRow];
                     prevVertex = predCol->CurrentVertex;
@@ -209,8 +232,9 @@ const AlignmentColumn* PoaGraphImpl::makeAlignmentColumnForExit(VD v,
         }
     } else {
         // regular predecessors
-        vector<const AlignmentColumn*> predecessorColumns = getPredecessorColumns(g_, v, colMap);
-        for (const AlignmentColumn* predCol : predecessorColumns) {
+        for (const VD u : g_.InEdges(v)) {
+            const AlignmentColumn* predCol = colMap->at(u);
+            assert(predCol != nullptr);
             if (predCol->HasRow(I) && predCol->Score[I] > bestScore) {
                 bestScore = predCol->Score[I];
                 prevVertex = predCol->CurrentVertex;
@@ -218,18 +242,17 @@ const AlignmentColumn* PoaGraphImpl::makeAlignmentColumnForExit(VD v,
         }
     }
     assert(prevVertex != null_vertex);
-    curCol->Score[I] = bestScore;
-    curCol->PreviousVertex[I] = prevVertex;
-    curCol->ReachingMove[I] = EndMove;
-    return curCol;
+    curCol.Score[I] = bestScore;
+    curCol.PreviousVertex[I] = prevVertex;
+    curCol.ReachingMove[I] = EndMove;
+    return &curCol;
 }
 
-const AlignmentColumn* PoaGraphImpl::makeAlignmentColumn(VD v, const AlignmentColumnMap& colMap,
+const AlignmentColumn* PoaGraphImpl::makeAlignmentColumn(VD v, AlignmentColumnMap* colMap,
                                                          const std::string& sequence,
                                                          const AlignConfig& config, int beginRow,
                                                          int endRow) const
 {
-    AlignmentColumn* curCol;
     if (beginRow > endRow) {
         // This happens when there are no anchors in the read.  We
         // want this read to be threaded onto the graph as a singleton
@@ -237,108 +260,108 @@ const AlignmentColumn* PoaGraphImpl::makeAlignmentColumn(VD v, const AlignmentCo
 
         // This is only going to work in LOCAL aln, assert on that
 
-        curCol = new AlignmentColumn(v, 0, 1);
-        curCol->ReachingMove[0] = StartMove;
-        curCol->PreviousVertex[0] = enterVertex_;
-        curCol->Score[0] = 0;  // > -FLT_MAX
-        return curCol;
+        AlignmentColumn& curCol = colMap->Add(v, 0, 1);
+        curCol.ReachingMove[0] = StartMove;
+        curCol.PreviousVertex[0] = enterVertex_;
+        curCol.Score[0] = 0;  // > -FLT_MAX
+        return &curCol;
     }
 
     assert(beginRow < endRow || beginRow == 0 || beginRow == static_cast<int>(sequence.length()));
 
-    curCol = new AlignmentColumn(v, beginRow, endRow);
-    const PoaNode& vertexInfo = vertexInfoMap_[v];
-    vector<const AlignmentColumn*> predecessorColumns = getPredecessorColumns(g_, v, colMap);
+    AlignmentColumn& curCol = colMap->Add(v, beginRow, endRow);
+    const PoaNode& vertexInfo = g_[v];
+    const AdjacencyRange inEdges = g_.InEdges(v);
 
     // i represents position in array
     // readPos=i-1 represents position in read
-    for (int i = beginRow; i < endRow; i++) {
-        assert(curCol->HasRow(i));
-
-        float candidateScore, bestScore;
-        VD prevVertex;
-        MoveType reachingMove;
-
-        if (config.Mode == AlignMode::LOCAL) {
-            bestScore = 0;
-            prevVertex = enterVertex_;
-            reachingMove = StartMove;
-        } else {
-            bestScore = -FLT_MAX;
-            prevVertex = null_vertex;
-            reachingMove = InvalidMove;
-        }
 
-        // Special-case the first row, this could probably be factored
-        // more cleanly
-        if (i == 0) {
-            if (predecessorColumns.size() == 0) {
-                // if this vertex doesn't have any in-edges it is ^; has
-                // no reaching move
-                assert(v == enterVertex_);
-                curCol->Score[0] = 0;
-                curCol->ReachingMove[0] = InvalidMove;
-                curCol->PreviousVertex[0] = null_vertex;
-            } else if (config.Mode == AlignMode::SEMIGLOBAL || config.Mode == AlignMode::LOCAL) {
-                // under semiglobal or local alignment, we use the Start move
-                curCol->Score[0] = 0;
-                curCol->ReachingMove[0] = StartMove;
-                curCol->PreviousVertex[0] = enterVertex_;
-            } else {
-                // otherwise it's a deletion
-                for (const AlignmentColumn* prevCol : predecessorColumns) {
-                    candidateScore = prevCol->Score[0] + config.Params.Delete;
-                    if (candidateScore > bestScore) {
-                        bestScore = candidateScore;
-                        prevVertex = prevCol->CurrentVertex;
-                        reachingMove = DeleteMove;
-                    }
-                }
-                assert(reachingMove != InvalidMove);
-                curCol->Score[0] = bestScore;
-                curCol->ReachingMove[0] = reachingMove;
-                curCol->PreviousVertex[0] = prevVertex;
-            }
+    // Special-case the first row, this could probably be factored
+    // more cleanly
+    if (beginRow == 0 && endRow > 0) {
+        if (inEdges.empty()) {
+            // if this vertex doesn't have any in-edges it is ^; has
+            // no reaching move
+            assert(v == enterVertex_);
+            curCol.Score[0] = 0;
+            curCol.ReachingMove[0] = InvalidMove;
+            curCol.PreviousVertex[0] = null_vertex;
+        } else if (config.Mode == AlignMode::SEMIGLOBAL || config.Mode == AlignMode::LOCAL) {
+            // under semiglobal or local alignment, we use the Start move
+            curCol.Score[0] = 0;
+            curCol.ReachingMove[0] = StartMove;
+            curCol.PreviousVertex[0] = enterVertex_;
         } else {
-            for (const AlignmentColumn* prevCol : predecessorColumns) {
-                // Incorporate (Match or Mismatch)
-                if (prevCol->HasRow(i - 1)) {
-                    bool isMatch = sequence[i - 1] == vertexInfo.Base;
-                    candidateScore = prevCol->Score[i - 1] +
-                                     (isMatch ? config.Params.Match : config.Params.Mismatch);
-                    if (candidateScore > bestScore) {
-                        bestScore = candidateScore;
-                        prevVertex = prevCol->CurrentVertex;
-                        reachingMove = (isMatch ? MatchMove : MismatchMove);
-                    }
-                }
-                // Delete
-                if (prevCol->HasRow(i)) {
-                    candidateScore = prevCol->Score[i] + config.Params.Delete;
-                    if (candidateScore > bestScore) {
-                        bestScore = candidateScore;
-                        prevVertex = prevCol->CurrentVertex;
-                        reachingMove = DeleteMove;
-                    }
-                }
-            }
-            // Extra
-            if (curCol->HasRow(i - 1)) {
-                candidateScore = curCol->Score[i - 1] + config.Params.Insert;
+            // otherwise it's a deletion
+            float candidateScore, bestScore = -FLT_MAX;
+            VD prevVertex = null_vertex;
+            MoveType reachingMove = InvalidMove;
+            for (const VD u : inEdges) {
+                const AlignmentColumn* prevCol = colMap->at(u);
+                candidateScore = prevCol->Score[0] + config.Params.Delete;
                 if (candidateScore > bestScore) {
                     bestScore = candidateScore;
-                    prevVertex = v;
-                    reachingMove = ExtraMove;
+                    prevVertex = prevCol->CurrentVertex;
+                    reachingMove = DeleteMove;
                 }
             }
             assert(reachingMove != InvalidMove);
-            curCol->Score[i] = bestScore;
-            curCol->ReachingMove[i] = reachingMove;
-            curCol->PreviousVertex[i] = prevVertex;
+            curCol.Score[0] = bestScore;
+            curCol.ReachingMove[0] = reachingMove;
+            curCol.PreviousVertex[0] = prevVertex;
         }
     }
 
-    return curCol;
+    const int firstRow = std::max(beginRow, 1);
+    if (firstRow >= endRow) return &curCol;
+
+    // Match, mismatch and delete moves from the predecessors; the
+    // baseline move traces to one past the last predecessor.  The
+    // scratch space is handed back to the arena once the column is done.
+    ColumnArena& arena = colMap->Arena();
+    const ColumnArena::Mark scratch = arena.GetMark();
+    const size_t nPreds = inEdges.size();
+    auto* preds = arena.Allocate<PredecessorScores>(nPreds);
+    auto* origins = arena.Allocate<VD>(nPreds + 1);
+    auto* trace = arena.Allocate<uint32_t>(endRow - firstRow);
+    size_t p = 0;
+    for (const VD u : inEdges) {
+        const AlignmentColumn* prevCol = colMap->at(u);
+        assert(prevCol != nullptr);
+        preds[p] = PredecessorScores{prevCol->Score.Data(), static_cast<int>(prevCol->BeginRow()),
+                                     static_cast<int>(prevCol->EndRow())};
+        origins[p++] = prevCol->CurrentVertex;
+    }
+    origins[nPreds] = config.Mode == AlignMode::LOCAL ? enterVertex_ : null_vertex;
+
+    FillPredecessorMoves(ActiveColumnKernel(), preds, nPreds, sequence, vertexInfo.Base,
+                         config.Params, config.Mode == AlignMode::LOCAL, firstRow, endRow,
+                         &curCol.Score[firstRow], trace);
+
+    // Extra moves chain down the column, so finish the rows in order
+    for (int i = firstRow; i < endRow; i++) {
+        float bestScore = curCol.Score[i];
+        const uint32_t packed = trace[i - firstRow];
+        MoveType reachingMove = TraceMove(packed);
+        VD prevVertex = origins[TracePredecessor(packed)];
+
+        // Extra
+        if (i > beginRow) {
+            float candidateScore = curCol.Score[i - 1] + config.Params.Insert;
+            if (candidateScore > bestScore) {
+                bestScore = candidateScore;
+                prevVertex = v;
+                reachingMove = ExtraMove;
+            }
+        }
+        assert(reachingMove != InvalidMove);
+        curCol.Score[i] = bestScore;
+        curCol.ReachingMove[i] = reachingMove;
+        curCol.PreviousVertex[i] = prevVertex;
+    }
+
+    arena.Rewind(scratch);
+    return &curCol;
 }
 
 void PoaGraphImpl::AddRead(const std::string& readSeq, const AlignConfig& config,
@@ -361,6 +384,7 @@ void PoaGraphImpl::AddFirstRead(const std::string& readSeq, std::vector<Vertex>*
 
     threadFirstRead(readSeq, readPathOutput);
     numReads_++;
+    g_.IndexOrder();
     repCheck();
 }
 
@@ -377,40 +401,37 @@ PoaAlignmentMatrix* PoaGraphImpl::TryAddRead(const std::string& readSeq, const A
         // "intermediate" consensus may include extra sequence
         // at either end
         std::vector<VD> cssPath = consensusPath(config.Mode);
-        std::string cssSeq = sequenceAlongPath(g_, vertexInfoMap_, cssPath);
+        std::string cssSeq = sequenceAlongPath(g_, cssPath);
         rangeFinder->InitRangeFinder(*this, externalizePath(cssPath), cssSeq, readSeq);
     }
 
     // Calculate alignment columns of sequence vs. graph, using sparsity if
     // we have a range finder.
-    auto* mat = new PoaAlignmentMatrixImpl();
-    mat->readSequence_ = readSeq;
-    mat->mode_ = config.Mode;
-    mat->graph_ = this;
-
-    vector<VD> sortedVerticesLocal(num_vertices(g_));
-    topological_sort(g_, sortedVerticesLocal.rbegin());
-    const AlignmentColumn* curCol;
-    for (const auto& v : sortedVerticesLocal) {
+    // The columns are carved out of an arena that is reused from read
+    // to read once the matrices using it are gone.
+    auto* mat = new PoaAlignmentMatrixImpl(this, readSeq, config.Mode, g_.NumVertices(),
+                                           columnArenas_.Acquire());
+
+    for (const VD v : sortedVertices()) {
         if (v != exitVertex_) {
             size_t startRow = 0, endRow = readSeq.size() + 1;
             if (rangeFinder) {
-                // FindAlignableRange returns an alignable sequence range, which is not the same as
-                // the alignable rows (the end is off-by-one, for a normal interval).
+                // FindAlignableRangeAt returns an alignable sequence range, which is not the same
+                // as the alignable rows (the end is off-by-one, for a normal interval).
                 int startRange, endRange;
-                std::tie(startRange, endRange) = rangeFinder->FindAlignableRange(externalize(v));
+                std::tie(startRange, endRange) =
+                    rangeFinder->FindAlignableRangeAt(g_.TopologicalIndex(v));
                 startRow = startRange;
                 endRow = (endRange == -INT_MAX / 2 ? endRange : endRange + 1);
             }
             Vertex vExt = externalize(v);  // DEBUGGING
-            curCol = makeAlignmentColumn(v, mat->columns_, readSeq, config, startRow, endRow);
+            makeAlignmentColumn(v, &mat->columns_, readSeq, config, startRow, endRow);
         } else {
-            curCol = makeAlignmentColumnForExit(v, mat->columns_, readSeq, config);
+            makeAlignmentColumnForExit(v, &mat->columns_, readSeq, config);
         }
-        mat->columns_[v] = curCol;
     }
 
-    mat->score_ = mat->columns_[exitVertex_]->Score[readSeq.size()];
+    mat->score_ = mat->columns_.at(exitVertex_)->Score[readSeq.size()];
     repCheck();
 
     return mat;
@@ -423,66 +444,249 @@ void PoaGraphImpl::CommitAdd(PoaAlignmentMatrix* mat_, std::vector<Vertex>* read
     auto* mat = static_cast<PoaAlignmentMatrixImpl*>(mat_);
     tracebackAndThread(mat->readSequence_, mat->columns_, mat->mode_, readPathOutput);
     numReads_++;
+    g_.IndexOrder();
 
     repCheck();
 }
 
-struct VertexComparator
+void PoaGraphImpl::PruneGraph(const int minCoverage)
 {
-    VertexComparator(const BoostGraph& g) : g_(g) {}
-    // Use exsiting indices to provide a stable memory-agnostic ordering
-    bool operator()(VD v1, VD v2) const
-    {
-        const int vi1 = get(vertex_index, g_, v1);
-        const int vi2 = get(vertex_index, g_, v2);
-        return (vi1 < vi2);
+    std::vector<bool> pruned(g_.NumVertices());
+    for (VD v = 0; v < g_.NumVertices(); ++v)
+        pruned[v] = g_[v].Reads < minCoverage;
+    removeVertices(pruned, false);
+}
+
+size_t PoaGraphImpl::PruneUnsupportedVertices(const float minSupport)
+{
+    resolveSpans();
+    std::vector<bool> pruned(g_.NumVertices());
+    size_t nPruned = 0;
+    for (VD v = 0; v < g_.NumVertices(); ++v) {
+        const PoaNode& node = g_[v];
+        pruned[v] =
+            v != enterVertex_ && v != exitVertex_ && node.Reads < minSupport * node.SpanningReads;
+        if (pruned[v]) ++nPruned;
     }
+    if (nPruned > 0) removeVertices(pruned, true);
+    return nPruned;
+}
 
-private:
-    const BoostGraph& g_;
-};
+void PoaGraphImpl::removeVertices(const std::vector<bool>& pruned, const bool bridge)
+{
+    // Each run of pruned vertices is bridged by edges from the survivors
+    // leading into it to the ones it leads to, so that the reads through
+    // it still have a path from the one to the other
+    std::vector<std::pair<VD, VD>> bridges;
+    if (bridge) {
+        std::vector<std::vector<VD>> survivorsBefore(g_.NumVertices());
+        for (const VD v : sortedVertices()) {
+            for (const VD u : g_.InEdges(v)) {
+                if (!pruned[u]) {
+                    if (pruned[v]) survivorsBefore[v].push_back(u);
+                    continue;
+                }
+                for (const VD w : survivorsBefore[u]) {
+                    if (pruned[v])
+                        survivorsBefore[v].push_back(w);
+                    else
+                        bridges.emplace_back(w, v);
+                }
+            }
+            auto& before = survivorsBefore[v];
+            std::sort(before.begin(), before.end());
+            before.erase(std::unique(before.begin(), before.end()), before.end());
+        }
+    }
 
-void PoaGraphImpl::PruneGraph(const int minCoverage)
+    // Move the span ends on each run of pruned vertices to the survivors
+    // around it, which leaves the coverage of every survivor as it was:
+    // starts to the survivor after the run, ends to the one before it.
+    // Spans within a run at either end of the order cancel out.
+    int starts = 0, ends = 0;
+    VD lastSurvivor = null_vertex;
+    for (const VD v : sortedVertices()) {
+        PoaNode& node = g_[v];
+        if (pruned[v]) {
+            starts += node.SpanStarts;
+            ends += node.SpanEnds;
+            continue;
+        }
+        if (lastSurvivor == null_vertex) {
+            node.SpanStarts += starts - ends;
+        } else {
+            node.SpanStarts += starts;
+            g_[lastSurvivor].SpanEnds += ends;
+        }
+        starts = ends = 0;
+        lastSurvivor = v;
+    }
+    if (lastSurvivor != null_vertex) g_[lastSurvivor].SpanEnds += ends - starts;
+
+    for (const auto& e : bridges)
+        g_.AddEdge(e.first, e.second);
+
+    // Survivors keep their relative order, so the renumbered vertex ids
+    // stay stable and deterministic; the ids of the pruned vertices are
+    // not reused, and externally resolve to no vertex from now on
+    const std::vector<VD> newIndex =
+        g_.RemoveVerticesIf([&](const PoaNode& n) { return pruned[vertexLookup_[n.Id]]; });
+    for (VD& vd : vertexLookup_) {
+        if (vd != null_vertex) vd = newIndex[vd];
+    }
+    enterVertex_ = newIndex[enterVertex_];
+    exitVertex_ = newIndex[exitVertex_];
+    g_.IndexOrder();
+    spansResolved_ = false;
+}
+
+void PoaGraphImpl::MergeGraph(const PoaGraphImpl& other, const AlignConfig& config,
+                              const bool reverse, SdpRangeFinder* rangeFinder,
+                              std::vector<Vertex>* vertexMap)
 {
-    // We have to use an iterator since we're modifying the graph as we go
-    graph_traits<BoostGraph>::vertex_iterator vi, vi_end, next;
-    tie(vi, vi_end) = vertices(g_);
-    for (next = vi; vi != vi_end; vi = next) {
-        ++next;
-        if (vertexInfoMap_[*vi].Reads < minCoverage) {
-            clear_vertex(*vi, g_);
-            remove_vertex(*vi, g_);
+    repCheck();
+    const auto& og = other.g_;
+
+    // other's vertex -> its image here
+    std::vector<VD> image(og.NumVertices(), null_vertex);
+
+    if (other.numReads_ == 0) {
+        // nothing to merge
+    } else if (numReads_ == 0) {
+        assert(!reverse);
+        *this = other;
+        for (VD v = 0; v < og.NumVertices(); ++v) {
+            image[v] = v;
+        }
+    } else {
+        // Thread the consensus of other, taken in the orientation it is
+        // merged in, through this graph; that is where other's reads go
+        std::vector<VD> cssPath = other.consensusPath(config.Mode);
+        std::string cssSeq = sequenceAlongPath(og, cssPath);
+        if (reverse) {
+            std::reverse(cssPath.begin(), cssPath.end());
+            cssSeq = PacBio::Data::ReverseComplement(cssSeq);
+        }
+
+        std::unique_ptr<PoaAlignmentMatrixImpl> mat(
+            static_cast<PoaAlignmentMatrixImpl*>(TryAddRead(cssSeq, config, rangeFinder)));
+        std::vector<Vertex> cssImage;
+        tracebackAndThread(cssSeq, mat->columns_, config.Mode, &cssImage, false);
+        for (size_t i = 0; i < cssPath.size(); ++i) {
+            image[cssPath[i]] = internalize(cssImage[i]);
+        }
+        image[other.enterVertex_] = reverse ? exitVertex_ : enterVertex_;
+        image[other.exitVertex_] = reverse ? enterVertex_ : exitVertex_;
+
+        // vertices here that are the image of one of other's already
+        std::vector<bool> taken(g_.NumVertices(), false);
+        for (const VD v : image) {
+            if (v != null_vertex) taken[v] = true;
+        }
+
+        // Other's vertices in the orientation they are merged in
+        const std::vector<VD>& order = og.TopologicalOrder();
+        const auto nth = [&](const size_t i) {
+            return reverse ? order[order.size() - 1 - i] : order[i];
+        };
+        const auto successors = [&](const VD v) {
+            return reverse ? og.InEdges(v) : og.OutEdges(v);
+        };
+        const auto predecessors = [&](const VD v) {
+            return reverse ? og.OutEdges(v) : og.InEdges(v);
+        };
+
+        // The last image of the consensus among the ancestors of each vertex
+        std::vector<VD> after(og.NumVertices(), null_vertex);
+        for (size_t i = 0; i < order.size(); ++i) {
+            const VD v = nth(i);
+            if (image[v] != null_vertex) {
+                after[v] = image[v];
+                continue;
+            }
+            for (const VD u : predecessors(v)) {
+                if (after[v] == null_vertex || g_.Precedes(after[v], after[u])) after[v] = after[u];
+            }
+        }
+
+        // Map the rest of other's vertices, successors first, each to a
+        // vertex between the last image among its ancestors and the first
+        // among its successors, so that all of other's edges go along the
+        // order here.  A vertex joins one of the same base leading into the
+        // image of one of its successors if there is one, so that the reads
+        // other's consensus leaves out meet the reads here on the same
+        // branches, and is copied otherwise, just ahead of its successors.
+        for (size_t i = order.size(); i-- > 0;) {
+            const VD v = nth(i);
+            if (image[v] != null_vertex) continue;
+
+            VD before = null_vertex;
+            for (const VD w : successors(v)) {
+                if (before == null_vertex || g_.Precedes(image[w], before)) before = image[w];
+            }
+
+            const char base = reverse ? PacBio::Data::Complement(og[v].Base) : og[v].Base;
+            VD join = null_vertex;
+            for (const VD w : successors(v)) {
+                for (const VD x : g_.InEdges(image[w])) {
+                    if (taken[x] || g_[x].Base != base || !g_.Precedes(after[v], x) ||
+                        !g_.Precedes(x, before))
+                        continue;
+                    if (join == null_vertex || g_[x].Reads > g_[join].Reads) join = x;
+                }
+            }
+            if (join == null_vertex) {
+                join = addVertex(base, 0, before);
+                taken.push_back(false);
+            }
+            image[v] = join;
+            taken[join] = true;
         }
+
+        for (const auto& e : og.Edges()) {
+            if (reverse) {
+                g_.AddEdge(image[e.second], image[e.first]);
+            } else {
+                g_.AddEdge(image[e.first], image[e.second]);
+            }
+        }
+
+        // Carry over other's reads, whose spans run the other way round
+        // if reversed
+        for (VD v = 0; v < og.NumVertices(); ++v) {
+            if (v == other.enterVertex_ || v == other.exitVertex_) continue;
+            PoaNode& node = g_[image[v]];
+            node.Reads += og[v].Reads;
+            node.SpanStarts += reverse ? og[v].SpanEnds : og[v].SpanStarts;
+            node.SpanEnds += reverse ? og[v].SpanStarts : og[v].SpanEnds;
+        }
+        numReads_ += other.numReads_;
+        g_.IndexOrder();
+        spansResolved_ = false;
     }
 
-    // This is a workaround for the non-deterministic order of iteration
-    // from BGL's vertices, which like edges also appear to be ordered
-    // by memory address (see: http://stackoverflow.com/questions/30968690/)
-
-    // We can't use topological sort here, since having a vertex index greater
-    // than num_vertices(g_) causes a crash. Instead we sort the vertices by
-    // their existing index.  This should still be very fast, as the underlying
-    // collection should be mostly sorted already.
-    vector<VD> sortedVerticesLocal;
-    BGL_FORALL_VERTICES(v, g_, BoostGraph) sortedVerticesLocal.push_back(v);
-    std::sort(sortedVerticesLocal.begin(), sortedVerticesLocal.end(), VertexComparator(g_));
-
-    // Finally, re-index all vertices to the range [0, num_vertices(g_)]
-    graph_traits<BoostGraph>::vertices_size_type current_index = 0;
-    index_map_t index_map = get(vertex_index, g_);
-    for (const VD& v : sortedVerticesLocal) {
-        index_map[v] = current_index++;
+    if (vertexMap != nullptr) {
+        vertexMap->resize(other.vertexLookup_.size());
+        for (size_t i = 0; i < other.vertexLookup_.size(); ++i) {
+            const VD v = other.vertexLookup_[i];
+            (*vertexMap)[i] = externalize(v == null_vertex ? null_vertex : image[v]);
+        }
     }
+    repCheck();
 }
 
 size_t PoaGraphImpl::NumReads() const { return numReads_; }
 
+size_t PoaGraphImpl::NumVertices() const { return g_.NumVertices(); }
+
+size_t PoaGraphImpl::NumEdges() const { return g_.NumEdges(); }
+
 string PoaGraphImpl::ToGraphViz(int flags, const PoaConsensus* pc) const
 {
+    resolveSpans();
     std::ostringstream ss;
-    write_graphviz(ss, g_, my_label_writer(vertexInfoMap_, flags & PoaGraph::COLOR_NODES,
+    write_graphviz(ss, g_, my_label_writer(g_, flags & PoaGraph::COLOR_NODES,
                                            flags & PoaGraph::VERBOSE_NODES, pc),
-                   default_writer(),  // edge writer
                    my_graph_writer(true));
 
     return ss.str();
@@ -500,12 +704,10 @@ void PoaGraphImpl::WriteGraphCsvFile(const string& filename) const
 {
     std::ofstream outfile(filename.c_str());
 
-    std::list<VD> sortedVerticesLocal(num_vertices(g_));
-    topological_sort(g_, sortedVerticesLocal.rbegin());
-
+    resolveSpans();
     outfile << "Id,Base,Reads,SpanningReads,Score,ReachingScore" << std::endl;
-    for (const VD v : sortedVerticesLocal) {
-        PoaNode& vi = vertexInfoMap_[v];
+    for (const VD v : sortedVertices()) {
+        const PoaNode& vi = g_[v];
         outfile << vi.Id << "," << vi.Base << "," << vi.Reads << "," << vi.SpanningReads << ","
                 << vi.Score << "," << vi.ReachingScore << std::endl;
     }
@@ -37,6 +37,7 @@
 
 #include <cfloat>
 #include <climits>
+#include <utility>
 #include <vector>
 
 #include <boost/config.hpp>
@@ -48,17 +49,13 @@
 #include <pacbio/consensus/Mutation.h>
 #include <pacbio/denovo/PoaGraph.h>
 
-#include "BoostGraph.h"
+#include "ColumnArena.h"
+#include "FlatGraph.h"
 #include "PoaAlignmentMatrix.h"
 
 using std::string;
 using std::vector;
 
-///
-///  Boost graph library typedefs, properties, and graphviz output.
-///
-using namespace boost;  // NOLINT
-
 namespace PacBio {
 namespace Poa {
 namespace detail {
@@ -71,16 +68,23 @@ struct PoaNode
     PoaGraph::Vertex Id;
     char Base;
     int Reads;
+    // reads whose span starts, or ends, at this vertex
+    int SpanStarts;
+    int SpanEnds;
     // move the below out of here?
-    int SpanningReads;
-    float Score;
-    float ReachingScore;
+    // reads spanning this vertex, resolved from the span ends on demand
+    mutable int SpanningReads;
+    // scratch values of the last consensus search (which is const)
+    mutable float Score;
+    mutable float ReachingScore;
 
     void Init(size_t id, char base, int reads, int spanning)
     {
         this->Id = id;
         this->Base = base;
         this->Reads = reads;
+        this->SpanStarts = 0;
+        this->SpanEnds = 0;
         this->SpanningReads = spanning;
         this->Score = 0;
         this->ReachingScore = 0;
@@ -95,78 +99,47 @@ struct PoaNode
 // External-facing vertex id type
 using Vertex = size_t;
 
-struct EdgeComparator
-{
-    EdgeComparator(const BoostGraph& g) : g_(g) {}
-    // want lex. comparison... just using pair to get it..
-    bool operator()(ED e1, ED e2) const
-    {
-        std::pair<int, int> vt1, vt2;
-        vt1 = std::make_pair(get(vertex_index, g_, source(e1, g_)),
-                             get(vertex_index, g_, target(e1, g_)));
-        vt2 = std::make_pair(get(vertex_index, g_, source(e2, g_)),
-                             get(vertex_index, g_, target(e2, g_)));
-        return (vt1 < vt2);
-    }
-
-private:
-    const BoostGraph& g_;
-};
-
-inline std::vector<ED> inEdges(VD v, const BoostGraph& g)
-{
-    // This is a sad workaround the nondeterministic order of iteration
-    // from BGL's in_edges. (see: http://stackoverflow.com/questions/30968690/)
-
-    // Unfortunately, we can't just use the boost::sort range adapter
-    // because it requires an underlying random access iterator, which
-    // we can't get from the std::set container.
-    graph_traits<BoostGraph>::in_edge_iterator begin, end;
-    tie(begin, end) = in_edges(v, g);
-    std::vector<ED> tmp(begin, end);
-    std::sort(tmp.begin(), tmp.end(), EdgeComparator(g));
-    return tmp;
-}
+using PoaGraphStorage = FlatGraph<PoaNode>;
 
 class PoaGraphImpl
 {
     friend class SdpRangeFinder;
 
-    BoostGraph g_;
-    VertexInfoMap vertexInfoMap_;  // NB: this is a reference type and refers to
-                                   // an "internal" property map
-    index_map_t indexMap_;
+    PoaGraphStorage g_;
     VD enterVertex_;
     VD exitVertex_;
     size_t numReads_;
-    size_t totalVertices_;               // includes "ex"-vertices which have since been removed
-    size_t liveVertices_;                // vertices that are in the graph.  this is needed
-                                         // for algorithms.
-    std::map<Vertex, VD> vertexLookup_;  // external ID -> internal ID
+    size_t totalVertices_;                  // includes "ex"-vertices which have since been removed
+    std::vector<VD> vertexLookup_;          // external ID -> internal ID (null_vertex once removed)
+    mutable ColumnArenaPool columnArenas_;  // alignment column storage, reused across reads
+    mutable bool spansResolved_;            // SpanningReads is up to date
 
     void repCheck() const;
 
-    VD addVertex(char base, int nReads = 1, int spanningReads = 0)
+    // `before` places the vertex in the topological order; threading
+    // passes the vertex the new one will have an edge into.  The new
+    // vertex takes over the spans starting at `before`, so that it is
+    // spanned by the same reads as the vertex it was forked from.
+    VD addVertex(char base, int nReads = 1, VD before = null_vertex)
     {
-        VD vd = add_vertex(g_);
         Vertex vExt = totalVertices_++;
-        vertexInfoMap_[vd] = PoaNode(vExt, base, nReads, spanningReads);
-        vertexLookup_[vExt] = vd;
-        indexMap_[vd] = liveVertices_++;
+        VD vd = g_.AddVertex(PoaNode(vExt, base, nReads), before);
+        vertexLookup_.push_back(vd);
+        if (before != null_vertex) std::swap(g_[vd].SpanStarts, g_[before].SpanStarts);
+        spansResolved_ = false;
         return vd;
     }
 
     //
     // utility routines
     //
-    const AlignmentColumn* makeAlignmentColumn(VD v,
-                                               const AlignmentColumnMap& alignmentColumnForVertex,
+    const AlignmentColumn* makeAlignmentColumn(VD v, AlignmentColumnMap* alignmentColumnForVertex,
                                                const std::string& sequence,
                                                const PacBio::Align::AlignConfig& config,
                                                int beginRow, int endRow) const;
 
     const AlignmentColumn* makeAlignmentColumnForExit(
-        VD v, const AlignmentColumnMap& alignmentColumnForVertex, const std::string& sequence,
+        VD v, AlignmentColumnMap* alignmentColumnForVertex, const std::string& sequence,
         const PacBio::Align::AlignConfig& config) const;
 
 public:
@@ -179,7 +152,7 @@ public:
         if (vd == null_vertex) {
             return PoaGraph::NullVertex;
         } else {
-            return vertexInfoMap_[vd].Id;
+            return g_[vd].Id;
         }
     }
 
@@ -213,31 +186,39 @@ public:
     //
     // POA node lookup
     //
-    const PoaNode& getPoaNode(VD v) const { return vertexInfoMap_[v]; }
+    const PoaNode& getPoaNode(VD v) const { return g_[v]; }
 public:
     //
     // Graph traversal functions, defined in PoaGraphTraversals
     //
 
-    std::vector<VD> sortedVertices() const;
+    const std::vector<VD>& sortedVertices() const;
 
     void tagSpan(VD start, VD end);
 
+    void resolveSpans() const;
+
     std::vector<VD> consensusPath(PacBio::Align::AlignMode mode, int minCoverage = -INT_MAX) const;
 
     void threadFirstRead(std::string sequence, std::vector<Vertex>* readPathOutput = NULL);
 
+    // countRead: whether the sequence counts as a read, in the Reads
+    // and span of the vertices it is threaded through
     void tracebackAndThread(std::string sequence,
                             const AlignmentColumnMap& alignmentColumnForVertex,
                             PacBio::Align::AlignMode mode,
-                            std::vector<Vertex>* readPathOutput = NULL);
+                            std::vector<Vertex>* readPathOutput = NULL, bool countRead = true);
 
     vector<PacBio::Consensus::ScoredMutation>* findPossibleVariants(
         const std::vector<Vertex>& bestPath) const;
 
+    // Remove the vertices flagged in pruned, keeping the span coverage of
+    // the others; with bridge, the paths through them are bridged over
+    void removeVertices(const std::vector<bool>& pruned, bool bridge);
+
 public:
     PoaGraphImpl();
-    PoaGraphImpl(const PoaGraphImpl& other);
+    PoaGraphImpl(const PoaGraphImpl& other) = default;
     ~PoaGraphImpl();
 
     void AddRead(const std::string& sequence, const PacBio::Align::AlignConfig& config,
@@ -253,17 +234,25 @@ public:
 
     PoaConsensus* FindConsensus(const PacBio::Align::AlignConfig& config,
                                 int minCoverage = -INT_MAX);
+    std::string FindConsensusSequence(const PacBio::Align::AlignConfig& config,
+                                      int minCoverage = -INT_MAX) const;
+    size_t NumUndecidedVertices(int minMargin) const;
     void PruneGraph(const int minCoverage);
+    size_t PruneUnsupportedVertices(float minSupport);
+    void MergeGraph(const PoaGraphImpl& other, const PacBio::Align::AlignConfig& config,
+                    bool reverse = false, SdpRangeFinder* rangeFinder = NULL,
+                    std::vector<Vertex>* vertexMap = NULL);
 
     size_t NumReads() const;
+    size_t NumVertices() const;
+    size_t NumEdges() const;
     string ToGraphViz(int flags, const PoaConsensus* pc) const;
     void WriteGraphVizFile(const string& filename, int flags, const PoaConsensus* pc) const;
     void WriteGraphCsvFile(const string& filename) const;
 };
 
 // free functions, we should put these all in traversals
-std::string sequenceAlongPath(const BoostGraph& g, const VertexInfoMap& vertexInfoMap,
-                              const std::vector<VD>& path);
+std::string sequenceAlongPath(const PoaGraphStorage& g, const std::vector<VD>& path);
 
 }  // namespace detail
 }  // namespace Poa
@@ -35,9 +35,9 @@
 
 // Author: David Alexander
 
-#include <boost/foreach.hpp>
-#include <boost/graph/topological_sort.hpp>
-#include <boost/unordered_set.hpp>
+#include <cassert>
+#include <list>
+#include <sstream>
 
 #include <pacbio/denovo/PoaGraph.h>
 
@@ -51,64 +51,41 @@ namespace detail {
 using namespace PacBio::Align;
 using namespace PacBio::Consensus;
 
-std::string sequenceAlongPath(const BoostGraph& g, const VertexInfoMap& vertexInfoMap,
-                              const std::vector<VD>& path)
+std::string sequenceAlongPath(const PoaGraphStorage& g, const std::vector<VD>& path)
 {
     std::ostringstream ss;
     for (const VD v : path) {
-        ss << vertexInfoMap[v].Base;
+        ss << g[v].Base;
     }
     return ss.str();
 }
 
-boost::unordered_set<VD> SpanningDFS(const VD start, const VD end, const BoostGraph& g)
-{
-    std::vector<VD> stack;
-    boost::unordered_set<VD> fwd;
-    boost::unordered_set<VD> rev;
-    // find all vertices reachable from start
-    stack.push_back(start);
-    do {
-        VD v = stack.back();
-        stack.pop_back();
-        // mark those we've already visited,
-        //   if so, skip
-        if (fwd.find(v) != fwd.end()) continue;
-        fwd.insert(v);
-        BOOST_FOREACH (const ED& e, out_edges(v, g)) {
-            stack.push_back(target(e, g));
-        }
-    } while (!stack.empty());
-    // find all vertices that can reach end
-    //   FROM start
-    stack.push_back(end);
-    do {
-        VD v = stack.back();
-        stack.pop_back();
-        // if it's not been visited in the forward pass,
-        //   or we've already visited it here, skip
-        if (fwd.find(v) == fwd.end() || rev.find(v) != rev.end()) continue;
-        rev.insert(v);
-        BOOST_FOREACH (const ED& e, in_edges(v, g)) {
-            stack.push_back(source(e, g));
-        }
-    } while (!stack.empty());
-    return rev;
-}
+const std::vector<VD>& PoaGraphImpl::sortedVertices() const { return g_.TopologicalOrder(); }
 
-std::vector<VD> PoaGraphImpl::sortedVertices() const
+// A read spans the vertices from its first to its last in topological
+// order.  Only the two ends are recorded, as a difference array over the
+// order, so tagging is O(1); resolveSpans() sums it up in one pass when
+// the coverage is needed.  Vertices added later between the ends, i.e.
+// within the stretch of the template the read covers, count as spanned.
+void PoaGraphImpl::tagSpan(VD start, VD end)
 {
-    vector<VD> sv(num_vertices(g_));
-    topological_sort(g_, sv.rbegin());
-    return sv;
+    assert(!g_.Precedes(end, start));
+    g_[start].SpanStarts++;
+    g_[end].SpanEnds++;
+    spansResolved_ = false;
 }
 
-void PoaGraphImpl::tagSpan(VD start, VD end)
+void PoaGraphImpl::resolveSpans() const
 {
-    boost::unordered_set<VD> vertices = SpanningDFS(start, end, g_);
-    for (const VD v : vertices) {
-        vertexInfoMap_[v].SpanningReads++;
+    if (spansResolved_) return;
+    int spanning = 0;
+    for (const VD v : sortedVertices()) {
+        spanning += g_[v].SpanStarts;
+        g_[v].SpanningReads = spanning;
+        spanning -= g_[v].SpanEnds;
     }
+    assert(spanning == 0);
+    spansResolved_ = true;
 }
 
 std::vector<VD> PoaGraphImpl::consensusPath(AlignMode mode, int minCoverage) const
@@ -128,22 +105,21 @@ std::vector<VD> PoaGraphImpl::consensusPath(AlignMode mode, int minCoverage) con
     // in fewer than minCoverage reads, it will be penalized
     // against inclusion in the consensus.
     int totalReads = NumReads();
+    resolveSpans();
 
     std::list<VD> path;
-    std::list<VD> sortedVerticesLocal(num_vertices(g_));
-    topological_sort(g_, sortedVerticesLocal.rbegin());
-    unordered_map<VD, VD> bestPrevVertex;
+    const std::vector<VD>& sortedVerticesLocal = sortedVertices();
+    std::vector<VD> bestPrevVertex(g_.NumVertices(), null_vertex);
 
     // ignore ^ and $
     // TODO(dalexander): find a cleaner way to do this
-    vertexInfoMap_[sortedVerticesLocal.front()].ReachingScore = 0;
-    sortedVerticesLocal.pop_back();
-    sortedVerticesLocal.pop_front();
+    g_[sortedVerticesLocal.front()].ReachingScore = 0;
 
     VD bestVertex = null_vertex;
     float bestReachingScore = -FLT_MAX;
-    for (const VD v : sortedVerticesLocal) {
-        PoaNode& vInfo = vertexInfoMap_[v];
+    for (size_t i = 1; i + 1 < sortedVerticesLocal.size(); ++i) {
+        const VD v = sortedVerticesLocal[i];
+        const PoaNode& vInfo = g_[v];
         int containingReads = vInfo.Reads;
         int spanningReads = vInfo.SpanningReads;
         float score =
@@ -152,10 +128,8 @@ std::vector<VD> PoaGraphImpl::consensusPath(AlignMode mode, int minCoverage) con
                 : (2 * containingReads - 1 * totalReads - 0.0001f);
         vInfo.Score = score;
         vInfo.ReachingScore = score;
-        bestPrevVertex[v] = null_vertex;
-        for (const ED& e : inEdges(v, g_)) {
-            VD sourceVertex = source(e, g_);
-            float rsc = score + vertexInfoMap_[sourceVertex].ReachingScore;
+        for (const VD sourceVertex : g_.InEdges(v)) {
+            float rsc = score + g_[sourceVertex].ReachingScore;
             if (rsc > vInfo.ReachingScore) {
                 vInfo.ReachingScore = rsc;
                 bestPrevVertex[v] = sourceVertex;
@@ -164,11 +138,10 @@ std::vector<VD> PoaGraphImpl::consensusPath(AlignMode mode, int minCoverage) con
                 bestVertex = v;
                 bestReachingScore = rsc;
             }
-            // if the score is the same, the order we've encountered vertices
-            //   might not be deterministic. Fix this by comparing on
-            //   vertex_index
+            // if the score is the same, break the tie on vertex id so the
+            //   result does not depend on the topological order
             else if (rsc == bestReachingScore) {
-                if (get(vertex_index, g_, v) < get(vertex_index, g_, bestVertex)) bestVertex = v;
+                if (v < bestVertex) bestVertex = v;
             }
         }
     }
@@ -195,15 +168,15 @@ void PoaGraphImpl::threadFirstRead(std::string sequence, std::vector<Vertex>* ou
     }
 
     for (const char base : sequence) {
-        v = addVertex(base);
+        v = addVertex(base, 1, exitVertex_);
         if (outputPath) {
             outputPath->push_back(externalize(v));
         }
         if (readPos == 0) {
-            add_edge(enterVertex_, v, g_);
+            g_.AddEdge(enterVertex_, v);
             startSpanVertex = v;
         } else {
-            add_edge(u, v, g_);
+            g_.AddEdge(u, v);
         }
         u = v;
         readPos++;
@@ -211,14 +184,16 @@ void PoaGraphImpl::threadFirstRead(std::string sequence, std::vector<Vertex>* ou
     assert(startSpanVertex != null_vertex);
     assert(u != null_vertex);
     endSpanVertex = u;
-    add_edge(u, exitVertex_, g_);  // terminus -> $
+    g_.AddEdge(u, exitVertex_);  // terminus -> $
     tagSpan(startSpanVertex, endSpanVertex);
 }
 
 void PoaGraphImpl::tracebackAndThread(std::string sequence,
                                       const AlignmentColumnMap& alignmentColumnForVertex,
-                                      AlignMode alignMode, std::vector<Vertex>* outputPath)
+                                      AlignMode alignMode, std::vector<Vertex>* outputPath,
+                                      const bool countRead)
 {
+    const int nReads = countRead ? 1 : 0;
     const int I = sequence.length();
 
     // perform traceback from (I,$), threading the new sequence into
@@ -227,7 +202,6 @@ void PoaGraphImpl::tracebackAndThread(std::string sequence,
     const AlignmentColumn* curCol;
     VD v = null_vertex, forkVertex = null_vertex;
     VD u = exitVertex_;
-    int span = 0;
     VD startSpanVertex;
     VD endSpanVertex = alignmentColumnForVertex.at(exitVertex_)->PreviousVertex[I];
 
@@ -253,7 +227,7 @@ void PoaGraphImpl::tracebackAndThread(std::string sequence,
 
         curCol = alignmentColumnForVertex.at(u);
         assert(curCol != nullptr);
-        PoaNode& curNodeInfo = vertexInfoMap_[u];
+        PoaNode& curNodeInfo = g_[u];
         VD prevVertex = curCol->PreviousVertex[i];
         MoveType reachingMove = curCol->ReachingMove[i];
 
@@ -266,8 +240,8 @@ void PoaGraphImpl::tracebackAndThread(std::string sequence,
             // In local model thread read bases, adjusting i (should stop at 0)
             while (i > 0) {
                 assert(alignMode == AlignMode::LOCAL);
-                VD newForkVertex = addVertex(sequence[READPOS], 1, span);
-                add_edge(newForkVertex, forkVertex, g_);
+                VD newForkVertex = addVertex(sequence[READPOS], nReads, forkVertex);
+                g_.AddEdge(newForkVertex, forkVertex);
                 VERTEX_ON_PATH(READPOS, newForkVertex);
                 forkVertex = newForkVertex;
                 i--;
@@ -285,8 +259,8 @@ void PoaGraphImpl::tracebackAndThread(std::string sequence,
                 int prevRow = ArgMax(prevCol->Score);
 
                 while (i > static_cast<int>(prevRow)) {
-                    VD newForkVertex = addVertex(sequence[READPOS], 1, span);
-                    add_edge(newForkVertex, forkVertex, g_);
+                    VD newForkVertex = addVertex(sequence[READPOS], nReads, forkVertex);
+                    g_.AddEdge(newForkVertex, forkVertex);
                     VERTEX_ON_PATH(READPOS, newForkVertex);
                     forkVertex = newForkVertex;
                     i--;
@@ -296,11 +270,11 @@ void PoaGraphImpl::tracebackAndThread(std::string sequence,
             VERTEX_ON_PATH(READPOS, u);
             // if there is an extant forkVertex, join it
             if (forkVertex != null_vertex) {
-                add_edge(u, forkVertex, g_);
+                g_.AddEdge(u, forkVertex);
                 forkVertex = null_vertex;
             }
             // add to existing node
-            curNodeInfo.Reads++;
+            curNodeInfo.Reads += nReads;
             i--;
         } else if (reachingMove == DeleteMove) {
             if (forkVertex == null_vertex) {
@@ -308,11 +282,11 @@ void PoaGraphImpl::tracebackAndThread(std::string sequence,
             }
         } else if (reachingMove == ExtraMove || reachingMove == MismatchMove) {
             // begin a new arc with this read base
-            VD newForkVertex = addVertex(sequence[READPOS], 1, span);
             if (forkVertex == null_vertex) {
                 forkVertex = v;
             }
-            add_edge(newForkVertex, forkVertex, g_);
+            VD newForkVertex = addVertex(sequence[READPOS], nReads, forkVertex);
+            g_.AddEdge(newForkVertex, forkVertex);
             VERTEX_ON_PATH(READPOS, newForkVertex);
             forkVertex = newForkVertex;
             i--;
@@ -322,18 +296,17 @@ void PoaGraphImpl::tracebackAndThread(std::string sequence,
 
         v = u;
         u = prevVertex;
-        span = curNodeInfo.SpanningReads;
     }
     startSpanVertex = v;
 
     // if there is an extant forkVertex, join it to enterVertex
     if (forkVertex != null_vertex) {
-        add_edge(enterVertex_, forkVertex, g_);
+        g_.AddEdge(enterVertex_, forkVertex);
         startSpanVertex = forkVertex;
         forkVertex = null_vertex;
     }
 
-    if (startSpanVertex != exitVertex_) {
+    if (countRead && startSpanVertex != exitVertex_) {
         tagSpan(startSpanVertex, endSpanVertex);
     }
 
@@ -345,24 +318,6 @@ void PoaGraphImpl::tracebackAndThread(std::string sequence,
 #undef VERTEX_ON_PATH
 }
 
-static boost::unordered_set<VD> childVertices(VD v, const BoostGraph& g)
-{
-    boost::unordered_set<VD> result;
-    BOOST_FOREACH (const ED& e, out_edges(v, g)) {
-        result.insert(target(e, g));
-    }
-    return result;
-}
-
-static boost::unordered_set<VD> parentVertices(VD v, const BoostGraph& g)
-{
-    boost::unordered_set<VD> result;
-    BOOST_FOREACH (const ED& e, in_edges(v, g)) {
-        result.insert(source(e, g));
-    }
-    return result;
-}
-
 vector<PacBio::Consensus::ScoredMutation>* PoaGraphImpl::findPossibleVariants(
     const std::vector<Vertex>& bestPath) const
 {
@@ -374,13 +329,13 @@ vector<PacBio::Consensus::ScoredMutation>* PoaGraphImpl::findPossibleVariants(
     for (int i = 2; i < (int)bestPath_.size() - 2; i++)  // NOLINT
     {
         VD v = bestPath_[i];
-        boost::unordered_set<VD> children = childVertices(v, g_);
+        const AdjacencyRange children = g_.OutEdges(v);
 
         // Look for a direct edge from the current node to the node
         // two spaces down---suggesting a deletion with respect to
         // the consensus sequence.
-        if (children.find(bestPath_[i + 2]) != children.end()) {
-            float score = -vertexInfoMap_[bestPath_[i + 1]].Score;
+        if (children.contains(bestPath_[i + 2])) {
+            float score = -g_[bestPath_[i + 1]].Score;
             variants->push_back(Mutation::Deletion(i + 1, 1).WithScore(score));
         }
 
@@ -388,7 +343,7 @@ vector<PacBio::Consensus::ScoredMutation>* PoaGraphImpl::findPossibleVariants(
         // This indicates we should try inserting the base at i + 1.
 
         // Parents of (i + 1)
-        boost::unordered_set<VD> lookBack = parentVertices(bestPath_[i + 1], g_);
+        AdjacencyRange lookBack = g_.InEdges(bestPath_[i + 1]);
 
         // (We could do this in STL using std::set sorted on score, which would
         // then
@@ -399,21 +354,19 @@ vector<PacBio::Consensus::ScoredMutation>* PoaGraphImpl::findPossibleVariants(
         VD bestInsertVertex = null_vertex;
 
         for (const VD v : children) {
-            boost::unordered_set<VD>::iterator found = lookBack.find(v);
-            if (found != lookBack.end()) {
-                float score = vertexInfoMap_[*found].Score;
+            if (lookBack.contains(v)) {
+                float score = g_[v].Score;
                 if (score > bestInsertScore) {
                     bestInsertScore = score;
-                    bestInsertVertex = *found;
+                    bestInsertVertex = v;
                 } else if (score == bestInsertScore) {
-                    if (get(vertex_index, g_, *found) < get(vertex_index, g_, bestInsertVertex))
-                        bestInsertVertex = *found;
+                    if (v < bestInsertVertex) bestInsertVertex = v;
                 }
             }
         }
 
         if (bestInsertVertex != null_vertex) {
-            char base = vertexInfoMap_[bestInsertVertex].Base;
+            char base = g_[bestInsertVertex].Base;
             variants->push_back(Mutation::Insertion(i + 1, base).WithScore(bestInsertScore));
         }
 
@@ -421,7 +374,7 @@ vector<PacBio::Consensus::ScoredMutation>* PoaGraphImpl::findPossibleVariants(
         // to i + 2.  This indicates we should try mismatching the base i + 1.
 
         // Parents of (i + 2)
-        lookBack = parentVertices(bestPath_[i + 2], g_);
+        lookBack = g_.InEdges(bestPath_[i + 2]);
 
         float bestMismatchScore = -FLT_MAX;
         VD bestMismatchVertex = null_vertex;
@@ -429,15 +382,13 @@ vector<PacBio::Consensus::ScoredMutation>* PoaGraphImpl::findPossibleVariants(
         for (const VD v : children) {
             if (v == bestPath_[i + 1]) continue;
 
-            boost::unordered_set<VD>::iterator found = lookBack.find(v);
-            if (found != lookBack.end()) {
-                float score = vertexInfoMap_[*found].Score;
+            if (lookBack.contains(v)) {
+                float score = g_[v].Score;
                 if (score > bestMismatchScore) {
                     bestMismatchScore = score;
-                    bestMismatchVertex = *found;
+                    bestMismatchVertex = v;
                 } else if (score == bestMismatchScore) {
-                    if (get(vertex_index, g_, *found) < get(vertex_index, g_, bestMismatchVertex))
-                        bestMismatchVertex = *found;
+                    if (v < bestMismatchVertex) bestMismatchVertex = v;
                 }
             }
         }
@@ -447,7 +398,7 @@ vector<PacBio::Consensus::ScoredMutation>* PoaGraphImpl::findPossibleVariants(
             // the score of the mismatch node. I think it should return the
             // score
             // difference, no?
-            char base = vertexInfoMap_[bestMismatchVertex].Base;
+            char base = g_[bestMismatchVertex].Base;
             variants->push_back(Mutation::Substitution(i + 1, base).WithScore(bestMismatchScore));
         }
     }
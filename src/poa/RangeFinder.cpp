@@ -39,10 +39,7 @@
 #include <utility>
 #include <vector>
 
-#include <boost/foreach.hpp>
-#include <boost/graph/topological_sort.hpp>
 #include <boost/optional.hpp>
-#include <boost/range/adaptor/reversed.hpp>
 
 #include <pacbio/denovo/RangeFinder.h>
 
@@ -109,15 +106,6 @@ inline Interval RangeUnion(const Interval& range1, const Interval& range2)
     return Interval(min(range1.first, range2.first), max(range1.second, range2.second));
 }
 
-inline Interval RangeUnion(const std::vector<Interval>& ranges)
-{
-    Interval result = emptyInterval;
-    for (const Interval& r : ranges) {
-        result = RangeUnion(result, r);
-    }
-    return result;
-}
-
 inline Interval next(const Interval& v, int upperBound)
 {
     if (v == emptyInterval)
@@ -144,9 +132,6 @@ void SdpRangeFinder::InitRangeFinder(const PoaGraphImpl& poaGraph,
     poaGraph.WriteGraphVizFile("debug-graph.dot", PoaGraph::VERBOSE_NODES, NULL);
     std::map<Vertex, const SdpAnchor*> anchorByVertex;
 #endif
-    // Clear prexisting state first!
-    alignableReadIntervalByVertex_.clear();
-
     const int readLength = readSequence.size();
     SdpAnchorVector anchors = FindAnchors(consensusSequence, readSequence);
 #if DEBUG_RANGE_FINDER
@@ -155,14 +140,14 @@ void SdpRangeFinder::InitRangeFinder(const PoaGraphImpl& poaGraph,
     std::cout << "RawAnchors length: " << anchors.size() << std::endl;
 #endif
 
-    std::map<VD, optional<Interval>> directRanges;
-    std::map<VD, Interval> fwdMarks, revMarks;
+    // All of the ranges are kept in vectors indexed by the position of
+    // the vertex in the topological order
+    const PoaGraphStorage& g = poaGraph.g_;
+    const std::vector<VD>& sortedVertices = poaGraph.sortedVertices();
+    const size_t nVertices = sortedVertices.size();
 
-    std::vector<VD> sortedVertices(num_vertices(poaGraph.g_));
-    topological_sort(poaGraph.g_, sortedVertices.rbegin());
-    for (const VD v : sortedVertices) {
-        directRanges[v] = boost::none;
-    }
+    std::vector<optional<Interval>> directRanges(nVertices);
+    std::vector<Interval> fwdMarks(nVertices), revMarks(nVertices);
 
     // Find the "direct ranges" implied by the anchors between the
     // css and this read.  Possibly null.
@@ -174,76 +159,64 @@ void SdpRangeFinder::InitRangeFinder(const PoaGraphImpl& poaGraph,
 #if DEBUG_RANGE_FINDER
             anchorByVertex[vExt] = anchor;
 #endif
-            directRanges[v] = Interval(max(int(anchor->second) - WIDTH, 0),
-                                       min(int(anchor->second) + WIDTH, readLength));
-        } else {
-            directRanges[v] = boost::none;
+            directRanges[g.TopologicalIndex(v)] = Interval(
+                max(int(anchor->second) - WIDTH, 0), min(int(anchor->second) + WIDTH, readLength));
         }
     }
 
     // Use the direct ranges as a seed and perform a forward recursion,
     // letting a node with null direct range have a range that is the
     // union of the "forward stepped" ranges of its predecessors
-    for (const VD v : sortedVertices) {
-        Vertex vExt = poaGraph.externalize(v);  // DEBUGGING
-
-        optional<Interval> directRange = directRanges.at(v);
-        if (directRange) {
-            fwdMarks[v] = directRange.get();
+    for (size_t i = 0; i < nVertices; ++i) {
+        if (directRanges[i]) {
+            fwdMarks[i] = directRanges[i].get();
         } else {
-            std::vector<Interval> predRangesStepped;
-            for (const ED& e : inEdges(v, poaGraph.g_)) {
-                VD pred = source(e, poaGraph.g_);
-                Vertex predExt = poaGraph.externalize(pred);  // DEBUGGING
-                Interval predRangeStepped = next(fwdMarks.at(pred), readLength);
-                predRangesStepped.push_back(predRangeStepped);
+            Interval fwdInterval = emptyInterval;
+            for (const VD pred : g.InEdges(sortedVertices[i])) {
+                const Interval predRangeStepped =
+                    next(fwdMarks[g.TopologicalIndex(pred)], readLength);
+                fwdInterval = RangeUnion(fwdInterval, predRangeStepped);
             }
-            Interval fwdInterval = RangeUnion(predRangesStepped);
-            fwdMarks[v] = fwdInterval;
+            fwdMarks[i] = fwdInterval;
         }
     }
 
     // Do the same thing, but as a backwards recursion
-    for (const VD v : boost::adaptors::reverse(sortedVertices)) {
-        Vertex vExt = poaGraph.externalize(v);  // DEBUGGING
-
-        optional<Interval> directRange = directRanges.at(v);
-        if (directRange) {
-            revMarks[v] = directRange.get();
+    for (size_t i = nVertices; i-- > 0;) {
+        if (directRanges[i]) {
+            revMarks[i] = directRanges[i].get();
         } else {
-            std::vector<Interval> succRangesStepped;
-            BOOST_FOREACH (const ED& e, out_edges(v, poaGraph.g_)) {
-                VD succ = target(e, poaGraph.g_);
-                Vertex succExt = poaGraph.externalize(succ);  // DEBUGGING
-                Interval succRangeStepped = prev(revMarks.at(succ), 0);
-                succRangesStepped.push_back(succRangeStepped);
+            Interval revInterval = emptyInterval;
+            for (const VD succ : g.OutEdges(sortedVertices[i])) {
+                const Interval succRangeStepped = prev(revMarks[g.TopologicalIndex(succ)], 0);
+                revInterval = RangeUnion(revInterval, succRangeStepped);
             }
-            Interval revInterval = RangeUnion(succRangesStepped);
-            revMarks[v] = revInterval;
+            revMarks[i] = revInterval;
         }
     }
 
     // take hulls of extents from forward and reverse recursions
-    for (const VD v : sortedVertices) {
-        Vertex vExt = poaGraph.externalize(v);
-        alignableReadIntervalByVertex_[vExt] = RangeUnion(fwdMarks.at(v), revMarks.at(v));
+    alignableReadIntervals_.resize(nVertices);
+    for (size_t i = 0; i < nVertices; ++i) {
+        alignableReadIntervals_[i] = RangeUnion(fwdMarks[i], revMarks[i]);
 #if DEBUG_RANGE_FINDER
+        Vertex vExt = poaGraph.externalize(sortedVertices[i]);
         cout << vExt << "\t";
         if (anchorByVertex.find(vExt) != anchorByVertex.end()) {
             cout << " @  " << anchorByVertex.at(vExt)->second << "\t";
         } else {
             cout << "\t";
         }
-        cout << "Fwd mark: " << formatInterval(fwdMarks[v]) << "\t"
-             << "Rev mark: " << formatInterval(revMarks[v]) << "\t"
-             << "Range: " << formatInterval(alignableReadIntervalByVertex_[vExt]) << endl;
+        cout << "Fwd mark: " << formatInterval(fwdMarks[i]) << "\t"
+             << "Rev mark: " << formatInterval(revMarks[i]) << "\t"
+             << "Range: " << formatInterval(alignableReadIntervals_[i]) << endl;
 #endif
     }
 }
 
-Interval SdpRangeFinder::FindAlignableRange(Vertex v)
+Interval SdpRangeFinder::FindAlignableRangeAt(size_t sortedIndex) const
 {
-    return alignableReadIntervalByVertex_.at(v);
+    return alignableReadIntervals_.at(sortedIndex);
 }
 
 }  // namespace detail
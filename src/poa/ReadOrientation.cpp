@@ -0,0 +1,123 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "ReadOrientation.h"
+
+namespace PacBio {
+namespace Poa {
+namespace detail {
+
+namespace {
+
+// 2-bit code of a base, 4 for anything but ACGT
+inline uint32_t BaseCode(const char b)
+{
+    switch (b) {
+        case 'A':
+        case 'a':
+            return 0;
+        case 'C':
+        case 'c':
+            return 1;
+        case 'G':
+        case 'g':
+            return 2;
+        case 'T':
+        case 't':
+            return 3;
+        default:
+            return 4;
+    }
+}
+
+// Visit the packed k-mers of seq, and those of its reverse complement
+// (at the same positions), in order
+template <typename F>
+void ForEachKmer(const std::string& seq, const size_t k, F visit)
+{
+    const uint32_t mask = (k == 16) ? ~uint32_t(0) : ((uint32_t(1) << (2 * k)) - 1);
+    const size_t topShift = 2 * (k - 1);
+    uint32_t fwd = 0, rev = 0;
+    size_t valid = 0;
+    for (const char b : seq) {
+        const uint32_t c = BaseCode(b);
+        if (c > 3) {
+            valid = 0;
+            continue;
+        }
+        fwd = ((fwd << 2) | c) & mask;
+        rev = (rev >> 2) | ((3 - c) << topShift);
+        if (++valid >= k) visit(fwd, rev);
+    }
+}
+
+}  // namespace anonymous
+
+SharedKmers CountSharedKmers(const std::string& reference, const std::string& read, const size_t k)
+{
+    assert(0 < k && k <= 16);
+
+    std::vector<uint32_t> index;
+    index.reserve(reference.size());
+    ForEachKmer(reference, k, [&index](uint32_t kmer, uint32_t) { index.push_back(kmer); });
+    std::sort(index.begin(), index.end());
+    index.erase(std::unique(index.begin(), index.end()), index.end());
+
+    SharedKmers shared{0, 0};
+    ForEachKmer(read, k, [&index, &shared](uint32_t fwd, uint32_t rev) {
+        shared.Forward += std::binary_search(index.begin(), index.end(), fwd);
+        shared.Reverse += std::binary_search(index.begin(), index.end(), rev);
+    });
+    return shared;
+}
+
+Orientation OrientRead(const std::string& reference, const std::string& read, const size_t k,
+                       const size_t minShared, const size_t dominance)
+{
+    const SharedKmers shared = CountSharedKmers(reference, read, k);
+    if (shared.Forward >= minShared && shared.Forward >= dominance * (shared.Reverse + 1))
+        return Orientation::FORWARD;
+    if (shared.Reverse >= minShared && shared.Reverse >= dominance * (shared.Forward + 1))
+        return Orientation::REVERSE;
+    return Orientation::AMBIGUOUS;
+}
+
+}  // namespace detail
+}  // namespace Poa
+}  // namespace PacBio
@@ -0,0 +1,75 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+// Strand orientation of a read against a reference sequence (the POA
+// consensus) from the k-mers they share, cheap enough to run before
+// committing to an alignment in either orientation.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace PacBio {
+namespace Poa {
+namespace detail {
+
+enum struct Orientation : uint8_t
+{
+    FORWARD = 0,
+    REVERSE = 1,
+    AMBIGUOUS = 2
+};
+
+struct SharedKmers
+{
+    size_t Forward;  // read k-mers found in the reference
+    size_t Reverse;  // reverse-complemented read k-mers found in the reference
+};
+
+// Count the k-mers (k <= 16) of read, and of its reverse complement,
+// found in reference.  k-mers spanning a non-ACGT base are skipped.
+SharedKmers CountSharedKmers(const std::string& reference, const std::string& read, size_t k);
+
+// FORWARD or REVERSE when one orientation shares at least minShared
+// k-mers and dominance times as many as the other (plus one); otherwise
+// AMBIGUOUS, and the read should be aligned both ways.
+Orientation OrientRead(const std::string& reference, const std::string& read, size_t k = 12,
+                       size_t minShared = 4, size_t dominance = 4);
+
+}  // namespace detail
+}  // namespace Poa
+}  // namespace PacBio
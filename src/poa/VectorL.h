@@ -37,7 +37,8 @@
 
 #include <algorithm>
 #include <cassert>
-#include <vector>
+
+#include "ColumnArena.h"
 
 namespace PacBio {
 namespace Poa {
@@ -60,18 +61,21 @@ size_t ArgMax(const VectorL<T>& v);
 // without
 //  cleaning it up/refactoring it quite a bit)
 //
+// The rows live in a ColumnArena, which must outlive the vector.
+//
 template <typename T>
 class VectorL
 {
 private:
-    std::vector<T> storage_;
+    T* storage_;
     size_t beginRow_;
     size_t endRow_;
 
 public:
-    VectorL(int beginRow, int endRow, T defaultVal = T())
-        : storage_(endRow - beginRow, defaultVal), beginRow_(beginRow), endRow_(endRow)
+    VectorL(ColumnArena& arena, int beginRow, int endRow, T defaultVal = T())
+        : storage_(arena.Allocate<T>(endRow - beginRow)), beginRow_(beginRow), endRow_(endRow)
     {
+        std::fill_n(storage_, endRow - beginRow, defaultVal);
     }
 
     T& operator[](size_t pos)
@@ -88,6 +92,10 @@ public:
 
     size_t BeginRow() const { return beginRow_; }
     size_t EndRow() const { return endRow_; }
+
+    // contiguous storage of rows [BeginRow(), EndRow())
+    T* Data() { return storage_; }
+    const T* Data() const { return storage_; }
     friend T Max<>(const VectorL<T>& v);
     friend size_t ArgMax<>(const VectorL<T>& v);
 };
@@ -98,14 +106,14 @@ using std::distance;
 template <typename T>
 T Max(const VectorL<T>& v)
 {
-    return *max_element(v.storage_.begin(), v.storage_.end());
+    return *max_element(v.storage_, v.storage_ + (v.endRow_ - v.beginRow_));
 }
 
 template <typename T>
 size_t ArgMax(const VectorL<T>& v)
 {
     return v.beginRow_ +
-           distance(v.storage_.begin(), max_element(v.storage_.begin(), v.storage_.end()));
+           distance(v.storage_, max_element(v.storage_, v.storage_ + (v.endRow_ - v.beginRow_)));
 }
 
 }  // namespace detail
@@ -0,0 +1,124 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+
+#include "../src/poa/ColumnArena.h"
+
+using namespace PacBio::Poa::detail;  // NOLINT
+
+TEST(ColumnArenaTest, AlignedAndDisjoint)
+{
+    ColumnArena arena(64);
+    char* c = arena.Allocate<char>(3);
+    double* d = arena.Allocate<double>(4);
+    uint32_t* u = arena.Allocate<uint32_t>(100);  // spills into a new block
+
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(d) % alignof(double));
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(u) % alignof(uint32_t));
+    EXPECT_GE(reinterpret_cast<char*>(d), c + 3);
+    EXPECT_EQ(2, arena.NumBlocks());
+
+    for (int i = 0; i < 100; ++i)
+        u[i] = i;
+    for (int i = 0; i < 4; ++i)
+        d[i] = 0.5 * i;
+    EXPECT_EQ(99, u[99]);
+    EXPECT_EQ(1.5, d[3]);
+}
+
+TEST(ColumnArenaTest, RewindReusesScratch)
+{
+    ColumnArena arena(1024);
+    arena.Allocate<float>(10);
+    const ColumnArena::Mark mark = arena.GetMark();
+    float* scratch = arena.Allocate<float>(100);
+    arena.Rewind(mark);
+    EXPECT_EQ(scratch, arena.Allocate<float>(100));
+
+    // rewinding across blocks keeps the later ones for reuse
+    arena.Rewind(mark);
+    arena.Allocate<char>(5000);
+    const size_t reserved = arena.BytesReserved();
+    arena.Rewind(mark);
+    arena.Allocate<char>(5000);
+    EXPECT_EQ(reserved, arena.BytesReserved());
+}
+
+TEST(ColumnArenaTest, ResetMergesBlocks)
+{
+    ColumnArena arena(128);
+    for (int i = 0; i < 20; ++i)
+        arena.Allocate<float>(30);
+    EXPECT_LT(1, arena.NumBlocks());
+    const size_t reserved = arena.BytesReserved();
+
+    arena.Reset();
+    EXPECT_EQ(1, arena.NumBlocks());
+    EXPECT_EQ(reserved, arena.BytesReserved());
+
+    // the same workload now fits the single block
+    for (int i = 0; i < 20; ++i)
+        arena.Allocate<float>(30);
+    EXPECT_EQ(1, arena.NumBlocks());
+}
+
+TEST(ColumnArenaTest, PoolReusesReleasedArenas)
+{
+    ColumnArenaPool pool;
+    ColumnArena* first;
+    {
+        auto a = pool.Acquire();
+        first = a.get();
+        a->Allocate<float>(10);
+    }
+    auto a = pool.Acquire();
+    EXPECT_EQ(first, a.get());
+
+    // an arena still in use is not handed out again
+    auto b = pool.Acquire();
+    EXPECT_NE(a.get(), b.get());
+    EXPECT_EQ(2, pool.NumPooled());
+    b.reset();
+    EXPECT_NE(a.get(), pool.Acquire().get());
+    EXPECT_EQ(2, pool.NumPooled());
+
+    // copies (as of a copied graph) share nothing
+    ColumnArenaPool copy(pool);
+    EXPECT_EQ(0, copy.NumPooled());
+}
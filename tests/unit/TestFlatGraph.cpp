@@ -0,0 +1,163 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "../src/poa/FlatGraph.h"
+
+using namespace PacBio::Poa::detail;  // NOLINT
+
+namespace {
+
+using Graph = FlatGraph<char>;
+
+// every edge goes forward in the maintained order, and the dense
+// numbering agrees with it
+void CheckOrder(Graph& g)
+{
+    for (const auto& e : g.Edges())
+        EXPECT_TRUE(g.Precedes(e.first, e.second));
+
+    g.IndexOrder();
+    const auto& order = g.TopologicalOrder();
+    ASSERT_EQ(g.NumVertices(), order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        EXPECT_EQ(i, g.TopologicalIndex(order[i]));
+        if (i > 0) {
+            EXPECT_TRUE(g.Precedes(order[i - 1], order[i]));
+        }
+    }
+    for (const auto& e : g.Edges())
+        EXPECT_LT(g.TopologicalIndex(e.first), g.TopologicalIndex(e.second));
+}
+
+}  // namespace anonymous
+
+TEST(FlatGraphTest, Adjacency)
+{
+    Graph g;
+    const VD a = g.AddVertex('A');
+    const VD b = g.AddVertex('B');
+    const VD c = g.AddVertex('C');
+    g.AddEdge(a, c);
+    g.AddEdge(a, b);
+    g.AddEdge(b, c);
+    g.AddEdge(a, c);  // duplicate
+
+    EXPECT_EQ(3, g.NumEdges());
+    EXPECT_EQ(2, g.OutDegree(a));
+    EXPECT_EQ(2, g.InDegree(c));
+    EXPECT_EQ((std::vector<VD>{b, c}), std::vector<VD>(g.OutEdges(a).begin(), g.OutEdges(a).end()));
+    EXPECT_EQ((std::vector<VD>{a, b}), std::vector<VD>(g.InEdges(c).begin(), g.InEdges(c).end()));
+    EXPECT_TRUE(g.InEdges(c).contains(b));
+    EXPECT_FALSE(g.OutEdges(c).contains(a));
+    EXPECT_EQ('B', g[b]);
+    CheckOrder(g);
+}
+
+TEST(FlatGraphTest, ThreadedInsertionsKeepOrder)
+{
+    // mimic POA threading: a backbone, then random detours made of new
+    // vertices placed before the vertex they lead into
+    std::mt19937 gen(42);
+    Graph g;
+    const VD enter = g.AddVertex('^');
+    const VD exit = g.AddVertex('$');
+    VD u = enter;
+    for (size_t i = 0; i < 1000; ++i) {
+        const VD v = g.AddVertex('N', exit);
+        g.AddEdge(u, v);
+        u = v;
+    }
+    g.AddEdge(u, exit);
+    CheckOrder(g);
+
+    for (size_t k = 0; k < 200; ++k) {
+        g.IndexOrder();
+        const auto order = g.TopologicalOrder();
+        std::uniform_int_distribution<size_t> pos(0, order.size() - 2);
+        size_t i = pos(gen), j = pos(gen);
+        if (i > j) std::swap(i, j);
+        VD fork = order[j + 1];
+        // long detours exhaust the labels between two neighbors
+        const size_t len = (k % 10 == 0) ? 100 : 3;
+        for (size_t n = 0; n < len; ++n) {
+            const VD w = g.AddVertex('N', fork);
+            g.AddEdge(w, fork);
+            fork = w;
+        }
+        g.AddEdge(order[i], fork);
+    }
+    CheckOrder(g);
+}
+
+TEST(FlatGraphTest, ContradictingEdgeResorts)
+{
+    Graph g;
+    const VD a = g.AddVertex('A');
+    const VD b = g.AddVertex('B');
+    const VD c = g.AddVertex('C');
+    g.AddEdge(a, b);
+    EXPECT_TRUE(g.Precedes(b, c));
+    g.AddEdge(c, b);
+    EXPECT_TRUE(g.Precedes(c, b));
+    CheckOrder(g);
+}
+
+TEST(FlatGraphTest, RemoveVertices)
+{
+    Graph g;
+    const VD a = g.AddVertex('A');
+    const VD c = g.AddVertex('C');
+    const VD b = g.AddVertex('B', c);
+    const VD x = g.AddVertex('x', c);
+    g.AddEdge(a, b);
+    g.AddEdge(b, c);
+    g.AddEdge(a, x);
+    g.AddEdge(x, c);
+
+    const auto newIndex = g.RemoveVerticesIf([](char base) { return base == 'x'; });
+    EXPECT_EQ(null_vertex, newIndex[x]);
+    EXPECT_EQ(3, g.NumVertices());
+    EXPECT_EQ(2, g.NumEdges());
+    EXPECT_EQ('B', g[newIndex[b]]);
+    EXPECT_EQ(1, g.OutDegree(newIndex[a]));
+    EXPECT_EQ(1, g.InDegree(newIndex[c]));
+    CheckOrder(g);
+    EXPECT_EQ((std::vector<VD>{newIndex[a], newIndex[b], newIndex[c]}), g.TopologicalOrder());
+}
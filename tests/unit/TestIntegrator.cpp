@@ -395,6 +395,50 @@ TEST(IntegratorTest, TestIntegratorEquivalenceDiTriRepeats)
     EXPECT_EQ(0, nerror);
 }
 
+TEST(IntegratorTest, TestIntegratorEquivalenceHomopolymers)
+{
+    std::mt19937 gen(42);
+    const size_t nmut = 2;
+
+    // runs at either end, and shifts too long for the extension buffer
+    const string tpl = "AAACGTTTTGCACCCCCTGAGGGTACAGTTTT";
+    Integrator ai(tpl, cfg);
+    const auto mutations = HomopolymerMutations(ai, 8);
+
+    size_t nerror = 0;
+
+    for (const string& mdl : {P6C4, SP2C2v5}) {
+        for (const auto& mut : mutations) {
+            string read;
+            StrandType strand;
+            vector<Mutation> muts{mut};
+            const string app = ApplyMutations(tpl, &muts);
+            std::tie(read, strand) = Mutate(app, nmut, &gen);
+            const vector<uint8_t> pws = RandomPW(read.length(), &gen);
+
+            Integrator ai1(tpl, cfg);
+            EXPECT_EQ(State::VALID, ai1.AddRead(MappedRead(MkRead(read, snr, mdl, pws), strand, 0,
+                                                           tpl.length(), true, true)));
+            Integrator ai2(app, cfg);
+            EXPECT_EQ(State::VALID, ai2.AddRead(MappedRead(MkRead(read, snr, mdl, pws), strand, 0,
+                                                           app.length(), true, true)));
+
+            const double exp = ai2.LL();
+            const double obs = ai1.LL(mut);
+            if (std::abs(1.0 - obs / exp) >= prec) {
+                std::cerr << std::endl
+                          << "!! intolerable difference: exp: " << exp << ", obs: " << obs
+                          << std::endl;
+                std::cerr << "  " << mut << std::endl;
+                std::cerr << "  " << read.length() << ", " << read << std::endl;
+                ++nerror;
+            }
+        }
+    }
+
+    EXPECT_EQ(0, nerror);
+}
+
 TEST(IntegratorTest, TestP6C4NoCovAgainstCSharpModel)
 {
     const string tpl = "ACGTCGT";
@@ -441,4 +485,51 @@ TEST(IntegratorTest, TestSuccessAddRead)
                                                   0, tpl.length(), true, true)));
 }
 
+TEST(IntegratorTest, SiteDisagreement)
+{
+    std::mt19937 gen(42);
+    const string tpl = RandomDNA(60, &gen);
+    const auto otherBase = [&tpl](const size_t i) {
+        for (const char b : {'A', 'C', 'G', 'T'})
+            if (b != tpl[i] && b != tpl[i - 1] && b != tpl[i + 1]) return b;
+        return 'N';
+    };
+    const auto mutate = [&tpl](Mutation mut) {
+        std::vector<Mutation> muts = {mut};
+        return ApplyMutations(tpl, &muts);
+    };
+
+    Integrator ai(tpl, cfg);
+    const auto addRead = [&ai](const string& seq, const StrandType strand) {
+        const string read = strand == StrandType::FORWARD ? seq : ReverseComplement(seq);
+        const vector<uint8_t> pws(read.length(), avgPw);
+        return ai.AddRead(MappedRead(MkRead(read, snr, SP2C2v5, pws), strand, 0,
+                                     ai.TemplateLength(), true, true));
+    };
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(State::VALID, addRead(tpl, StrandType::FORWARD));
+        EXPECT_EQ(State::VALID, addRead(tpl, StrandType::REVERSE));
+    }
+    EXPECT_EQ(State::VALID,
+              addRead(mutate(Mutation::Substitution(20, otherBase(20))), StrandType::FORWARD));
+    EXPECT_EQ(State::VALID, addRead(mutate(Mutation::Deletion(30, 1)), StrandType::REVERSE));
+    EXPECT_EQ(State::VALID,
+              addRead(mutate(Mutation::Insertion(40, otherBase(40))), StrandType::REVERSE));
+
+    const auto disagreement = ai.SiteDisagreement();
+    ASSERT_EQ(tpl.length(), disagreement.size());
+
+    // every site is covered by all reads but for the unscored first sites of each strand
+    EXPECT_EQ(5, disagreement.front().first);
+    EXPECT_EQ(4, disagreement.back().first);
+    for (size_t i = 1; i + 1 < tpl.length(); ++i) {
+        EXPECT_EQ(9, disagreement[i].first);
+        // one read disagrees with each error, none elsewhere
+        if (i == 20 || i == 30 || i == 40)
+            EXPECT_GT(disagreement[i].second, 0.8);
+        else
+            EXPECT_LT(disagreement[i].second, 0.5);
+    }
+}
+
 }  // namespace IntegratorTests
@@ -37,7 +37,9 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstdio>
 #include <cstdlib>
+#include <fstream>
 #include <iterator>
 #include <set>
 #include <string>
@@ -47,6 +49,10 @@ using std::string;
 using std::vector;
 
 #include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -55,6 +61,7 @@ using std::vector;
 #include <pacbio/consensus/ModelSelection.h>
 #include <pacbio/data/Read.h>
 #include <pacbio/data/State.h>
+#include <pacbio/exception/ModelError.h>
 
 #include "TestData.h"
 
@@ -100,6 +107,27 @@ Read MkRead(const string& seq, const SNR& snr, const string& mdl, const vector<u
     vector<uint8_t> ipd(seq.length(), 0);
     return Read("NA", seq, ipd, pw, snr, mdl);
 }
+
+double LL(const string& mdl)
+{
+    Integrator ai(longTpl, cfg);
+    EXPECT_EQ(State::VALID,
+              ai.AddRead(MappedRead(MkRead(longRead, snr, mdl, longPws), StrandType::FORWARD, 0,
+                                    longTpl.length(), true, true)));
+    return ai.LL();
+}
+
+// copy a model file into dir under another chemistry name,
+//   so it does not collide with models loaded by other tests
+string CopyModel(const string& model, const string& chemistry, const string& dir)
+{
+    boost::property_tree::ptree pt;
+    read_json(tests::DataDir + "/arrow/" + model, pt);
+    pt.put("ChemistryName", chemistry);
+    const string path = dir + "/" + model;
+    write_json(path, pt);
+    return path;
+}
 }  // namespace LoadModelsTests
 
 TEST(LoadModelsTest, SupportedChemistries)
@@ -244,17 +272,62 @@ TEST(LoadModelsTest, Directory)
     }
 }
 
-TEST(LoadModelsTest, UpdateBundle)
+TEST(LoadModelsTest, Lazy)
 {
-    const char* varname = "SMRT_CHEMISTRY_BUNDLE_DIR";
-    EXPECT_EQ(0, setenv(varname, tests::DataDir.c_str(), 0));
+    char dir[] = "/tmp/uny_models_XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir));
+
+    const string v5 = LoadModelsTests::CopyModel("SP2C2v5.json", "S/P2-C2/5.0-lazy", dir);
+    const string v2 = LoadModelsTests::CopyModel("SP1C1v2.json", "S/P1-C1.2-lazy", dir);
+    EXPECT_EQ(2, LoadModels(dir));
+
+    const auto mdls = SupportedModels();
+    EXPECT_TRUE(mdls.find("S/P2-C2/5.0-lazy::PwSnr::FromFile") != mdls.end());
+    EXPECT_TRUE(mdls.find("S/P1-C1.2-lazy::PwSnr::FromFile") != mdls.end());
+
+    // once materialized, models no longer need their files
+    EXPECT_LE(2, MaterializeModels(4));
+    std::remove(v5.c_str());
+    std::remove(v2.c_str());
+    EXPECT_NEAR(LoadModelsTests::LL("S/P2-C2/5.0::PwSnr::Compiled"),
+                LoadModelsTests::LL("S/P2-C2/5.0-lazy::PwSnr::FromFile"), 1.0e-5);
+    EXPECT_NEAR(LoadModelsTests::LL("S/P1-C1.2::PwSnr::Compiled"),
+                LoadModelsTests::LL("S/P1-C1.2-lazy::PwSnr::FromFile"), 1.0e-5);
+
+    // while models loaded but not used yet are only parsed on first use,
+    //   so a file truncated after its header fails only then
+    const string v1 = LoadModelsTests::CopyModel("SP1C1v1.json", "S/P1-C1.1-lazy", dir);
+    EXPECT_EQ(1, LoadModels(v1));
+    {
+        std::ifstream in(v1);
+        string head(128, '\0');
+        in.read(&head[0], head.size());
+        in.close();
+        std::ofstream(v1, std::ios::trunc) << head.substr(0, head.find("\"ModelForm\""))
+                                           << "\"ModelForm\": \"PwSnrA\",\n";
+    }
+    EXPECT_THROW(LoadModelsTests::LL("S/P1-C1.1-lazy::PwSnrA::FromFile"),
+                 PacBio::Exception::MalformedModelFile);
 
-    std::set<std::string> chems = SupportedModels();
-    ASSERT_TRUE(chems.find("S/P1-C1/beta::Marginal::Bundled") != chems.end());
-    ASSERT_TRUE(chems.find("S/P1-C1.1::PwSnrA::Bundled") != chems.end());
-    ASSERT_TRUE(chems.find("S/P1-C1.2::PwSnr::Bundled") != chems.end());
+    std::remove(v1.c_str());
+    rmdir(dir);
+}
 
-    EXPECT_EQ(0, unsetenv(varname));
+TEST(LoadModelsTest, UpdateBundle)
+{
+    // the bundle directory is only read at the first model use in a process,
+    // so look it up in a fresh one
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    EXPECT_EXIT(
+        {
+            setenv("SMRT_CHEMISTRY_BUNDLE_DIR", tests::DataDir.c_str(), 1);
+            const std::set<std::string> chems = SupportedModels();
+            const bool found = chems.find("S/P1-C1/beta::Marginal::Bundled") != chems.end() &&
+                               chems.find("S/P1-C1.1::PwSnrA::Bundled") != chems.end() &&
+                               chems.find("S/P1-C1.2::PwSnr::Bundled") != chems.end();
+            std::exit(found ? 0 : 1);
+        },
+        ::testing::ExitedWithCode(0), "");
 }
 
 #if EXTENSIVE_TESTING
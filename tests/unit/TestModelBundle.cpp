@@ -0,0 +1,243 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <gtest/gtest.h>
+
+#include <pacbio/consensus/Integrator.h>
+#include <pacbio/consensus/ModelSelection.h>
+#include <pacbio/data/Read.h>
+#include <pacbio/data/State.h>
+#include <pacbio/exception/ModelError.h>
+
+#include "../src/ModelBundle.h"
+#include "TestData.h"
+
+using namespace PacBio::Consensus;  // NOLINT
+using namespace PacBio::Data;       // NOLINT
+
+namespace ModelBundleTests {
+
+const std::vector<std::string> models = {"SP1C1Beta.json", "SP1C1v1.json", "SP1C1v2.json",
+                                         "SP2C2v5.json"};
+
+class ModelBundleTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char dir[] = "/tmp/uny_bundle_XXXXXX";
+        ASSERT_NE(nullptr, mkdtemp(dir));
+        dir_ = dir;
+        bundle_ = dir_ + "/arrow.bundle";
+    }
+
+    void TearDown() override
+    {
+        for (const auto& file : files_)
+            std::remove(file.c_str());
+        std::remove(bundle_.c_str());
+        rmdir(dir_.c_str());
+    }
+
+    // copy a model file into our directory under another chemistry name,
+    //   so it does not collide with models loaded by other tests
+    void AddModel(const std::string& model, const std::string& chemistry)
+    {
+        boost::property_tree::ptree pt;
+        read_json(tests::DataDir + "/arrow/" + model, pt);
+        pt.put("ChemistryName", chemistry);
+        files_.emplace_back(dir_ + "/" + model);
+        write_json(files_.back(), pt);
+    }
+
+    std::string dir_;
+    std::string bundle_;
+    std::vector<std::string> files_;
+};
+
+double LL(const std::string& mdl)
+{
+    const std::string tpl = "ACGTCGTACGTAGCTAGCTTTAGCGATCGAAAGCT";
+    const std::string seq = "ACGTCGTACGTAGCTAGCTTAGCGATCGAAAAGCT";
+    const std::vector<uint8_t> ipd(seq.length(), 0);
+    const std::vector<uint8_t> pw(seq.length(), 10);
+    Integrator ai(tpl, IntegratorConfig(-100.0));
+    EXPECT_EQ(State::VALID,
+              ai.AddRead(MappedRead(Read("NA", seq, ipd, pw, SNR(10, 7, 5, 11), mdl),
+                                    StrandType::FORWARD, 0, tpl.length(), true, true)));
+    return ai.LL();
+}
+
+}  // namespace ModelBundleTests
+
+using ModelBundleTests::ModelBundleTest;
+
+TEST_F(ModelBundleTest, RoundTrip)
+{
+    EXPECT_EQ(4, CompileModelBundle(tests::DataDir + "/arrow", bundle_));
+
+    const ModelBundle bundle(bundle_);
+    ASSERT_EQ(4, bundle.Models().size());
+
+    // models are stored in file name order
+    const auto& model = bundle.Models()[3];
+    EXPECT_EQ("S/P2-C2/5.0", model.Chemistry);
+    EXPECT_EQ("PwSnr", std::string(model.Form));
+
+    boost::property_tree::ptree pt;
+    read_json(tests::DataDir + "/arrow/SP2C2v5.json", pt);
+    double snrRanges[4][2];
+    model.Params.Get("SnrRanges", &snrRanges);
+    size_t i = 0;
+    for (const auto& row : pt.get_child("SnrRanges")) {
+        size_t j = 0;
+        for (const auto& col : row.second)
+            EXPECT_EQ(col.second.get_value<double>(), snrRanges[i][j++]);
+        ++i;
+    }
+
+    // parameters must be read back at their stored size
+    double wrongSize[4];
+    EXPECT_THROW(model.Params.Get("SnrRanges", &wrongSize), PacBio::Exception::MalformedModelFile);
+    EXPECT_THROW(model.Params.Get("SubstitutionRate", &wrongSize),
+                 PacBio::Exception::MalformedModelFile);
+}
+
+TEST_F(ModelBundleTest, LoadModels)
+{
+    AddModel("SP2C2v5.json", "S/P2-C2/5.0-bundle");
+    AddModel("SP1C1Beta.json", "S/P1-C1/beta-bundle");
+    EXPECT_EQ(2, CompileModelBundle(dir_, bundle_));
+    EXPECT_EQ(2, LoadModels(bundle_));
+
+    const auto mdls = SupportedModels();
+    EXPECT_TRUE(mdls.find("S/P2-C2/5.0-bundle::PwSnr::FromFile") != mdls.end());
+    EXPECT_TRUE(mdls.find("S/P1-C1/beta-bundle::Marginal::FromFile") != mdls.end());
+
+    EXPECT_NEAR(ModelBundleTests::LL("S/P2-C2/5.0::PwSnr::Compiled"),
+                ModelBundleTests::LL("S/P2-C2/5.0-bundle::PwSnr::FromFile"), 1.0e-5);
+    EXPECT_NEAR(ModelBundleTests::LL("S/P1-C1/beta::Marginal::Compiled"),
+                ModelBundleTests::LL("S/P1-C1/beta-bundle::Marginal::FromFile"), 1.0e-5);
+
+    // loading a bundle twice does not register anything again
+    EXPECT_EQ(0, LoadModels(bundle_));
+}
+
+TEST_F(ModelBundleTest, Corrupt)
+{
+    AddModel("SP1C1v1.json", "S/P1-C1.1-corrupt");
+    EXPECT_EQ(1, CompileModelBundle(dir_, bundle_));
+
+    std::vector<char> data;
+    {
+        std::ifstream in(bundle_, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    ASSERT_GT(data.size(), 64);
+
+    // flip a bit in the payload
+    data[data.size() / 2] ^= 1;
+    std::ofstream(bundle_, std::ios::binary | std::ios::trunc).write(data.data(), data.size());
+    EXPECT_THROW(ModelBundle{bundle_}, PacBio::Exception::MalformedModelFile);
+    EXPECT_EQ(0, LoadModels(bundle_));
+
+    // truncate it
+    data[data.size() / 2] ^= 1;
+    std::ofstream(bundle_, std::ios::binary | std::ios::trunc).write(data.data(), data.size() - 8);
+    EXPECT_THROW(ModelBundle{bundle_}, PacBio::Exception::MalformedModelFile);
+    EXPECT_EQ(0, LoadModels(bundle_));
+
+    const auto mdls = SupportedModels();
+    EXPECT_TRUE(mdls.find("S/P1-C1.1-corrupt::PwSnrA::FromFile") == mdls.end());
+}
+
+TEST_F(ModelBundleTest, MalformedModelFile)
+{
+    files_.emplace_back(dir_ + "/Malformed.json");
+    {
+        std::ifstream in(tests::DataDir + "/Malformed.json");
+        std::ofstream(files_.back()) << in.rdbuf();
+    }
+    EXPECT_THROW(CompileModelBundle(dir_, bundle_), PacBio::Exception::ModelError);
+}
+
+#if EXTENSIVE_TESTING
+// disable this test under debug builds (which are not fast enough to pass these timings)
+#ifndef NDEBUG
+TEST_F(ModelBundleTest, DISABLED_StartupTiming)
+#else
+TEST_F(ModelBundleTest, StartupTiming)
+#endif
+{
+    // make sure the models are registered, so every load below does all of
+    //   its parsing and validation but registers nothing
+    LoadModels(tests::DataDir + "/arrow");
+    CompileModelBundle(tests::DataDir + "/arrow", bundle_);
+
+    const size_t nsamp = 100;
+    const auto time = [nsamp](const std::function<void()>& load) {
+        const auto stime = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < nsamp; ++i)
+            load();
+        const auto etime = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(etime - stime).count() / nsamp;
+    };
+
+    const auto json = time([] {
+        for (const auto& model : ModelBundleTests::models)
+            LoadModels(tests::DataDir + "/arrow/" + model);
+    });
+    const auto bundle = time([this] { LoadModels(bundle_); });
+
+    std::cout << "avg startup: " << json << "us from JSON, " << bundle << "us from bundle"
+              << std::endl;
+    EXPECT_LT(bundle, json);
+}
+#endif
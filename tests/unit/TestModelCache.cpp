@@ -0,0 +1,164 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <pacbio/consensus/ModelConfig.h>
+#include <pacbio/consensus/ModelSelection.h>
+#include <pacbio/data/Read.h>
+
+#include "../src/ModelFactory.h"
+
+using namespace PacBio::Consensus;  // NOLINT
+using namespace PacBio::Data;       // NOLINT
+
+namespace ModelCacheTests {
+
+const std::string mdl = "P6-C4";
+const std::string tpl = "ACGTTTGCAAGGTCCA";
+
+class ModelCacheTest : public ::testing::Test
+{
+protected:
+    void TearDown() override { ConfigureModelCache(0.0); }
+};
+
+void ExpectSameParameters(const ModelConfig& lhs, const ModelConfig& rhs)
+{
+    const auto l = lhs.Populate(tpl);
+    const auto r = rhs.Populate(tpl);
+    ASSERT_EQ(l.size(), r.size());
+    for (size_t i = 0; i < l.size(); ++i) {
+        EXPECT_EQ(l[i].Match, r[i].Match);
+        EXPECT_EQ(l[i].Branch, r[i].Branch);
+        EXPECT_EQ(l[i].Stick, r[i].Stick);
+        EXPECT_EQ(l[i].Deletion, r[i].Deletion);
+    }
+}
+
+TEST_F(ModelCacheTest, Exact)
+{
+    ConfigureModelCache(0.0);
+
+    const SNR snr(10.2, 7.1, 5.3, 11.4);
+    const auto first = ModelFactory::Create(mdl, snr);
+    const auto second = ModelFactory::Create(mdl, snr);
+    ExpectSameParameters(*first, *second);
+    EXPECT_EQ(1, ModelCacheStatistics().Hits);
+    EXPECT_EQ(1, ModelCacheStatistics().Misses);
+
+    // a slightly different SNR is a different model
+    ModelFactory::Create(mdl, SNR(10.2, 7.1, 5.3, 11.5));
+    EXPECT_EQ(1, ModelCacheStatistics().Hits);
+    EXPECT_EQ(2, ModelCacheStatistics().Misses);
+    EXPECT_EQ(2, ModelCacheStatistics().Size);
+    EXPECT_DOUBLE_EQ(1.0 / 3.0, ModelCacheStatistics().HitRate());
+
+    // uncached models are identical
+    ConfigureModelCache(0.0, 0);
+    const auto uncached = ModelFactory::Create(mdl, snr);
+    ExpectSameParameters(*first, *uncached);
+    EXPECT_EQ(0, ModelCacheStatistics().Hits + ModelCacheStatistics().Misses);
+}
+
+TEST_F(ModelCacheTest, Rounded)
+{
+    ConfigureModelCache(0.5);
+
+    const auto first = ModelFactory::Create(mdl, SNR(10.1, 6.9, 5.2, 11.1));
+    const auto second = ModelFactory::Create(mdl, SNR(9.9, 7.1, 4.9, 10.9));
+    EXPECT_EQ(1, ModelCacheStatistics().Hits);
+    EXPECT_EQ(1, ModelCacheStatistics().Misses);
+
+    // both are the model of the rounded SNR
+    ConfigureModelCache(0.0, 0);
+    const auto rounded = ModelFactory::Create(mdl, SNR(10.0, 7.0, 5.0, 11.0));
+    ExpectSameParameters(*first, *rounded);
+    ExpectSameParameters(*second, *rounded);
+
+    EXPECT_THROW(ConfigureModelCache(-1.0), std::invalid_argument);
+}
+
+TEST_F(ModelCacheTest, LeastRecentlyUsed)
+{
+    ConfigureModelCache(0.0, 2);
+
+    const SNR a(10, 7, 5, 11), b(11, 7, 5, 11), c(12, 7, 5, 11);
+    ModelFactory::Create(mdl, a);
+    ModelFactory::Create(mdl, b);
+    ModelFactory::Create(mdl, a);  // hit, b is now the oldest
+    ModelFactory::Create(mdl, c);  // evicts b
+    EXPECT_EQ(1, ModelCacheStatistics().Hits);
+    EXPECT_EQ(2, ModelCacheStatistics().Size);
+
+    ModelFactory::Create(mdl, a);
+    EXPECT_EQ(2, ModelCacheStatistics().Hits);
+    ModelFactory::Create(mdl, b);
+    EXPECT_EQ(2, ModelCacheStatistics().Hits);
+    EXPECT_EQ(4, ModelCacheStatistics().Misses);
+
+    // evicted models remain usable by their owners
+    ConfigureModelCache(0.0, 1);
+    const auto kept = ModelFactory::Create(mdl, a);
+    ModelFactory::Create(mdl, b);
+    EXPECT_EQ(tpl.length(), kept->Populate(tpl).size());
+}
+
+TEST_F(ModelCacheTest, Threads)
+{
+    ConfigureModelCache(0.0);
+
+    const SNR snr(10, 7, 5, 11);
+    std::vector<std::future<void>> futures;
+    for (size_t i = 0; i < 8; ++i)
+        futures.emplace_back(std::async(std::launch::async, [&snr]() {
+            for (size_t j = 0; j < 100; ++j)
+                ModelFactory::Create(mdl, snr);
+        }));
+    for (auto& f : futures)
+        f.get();
+
+    const auto stats = ModelCacheStatistics();
+    EXPECT_EQ(800, stats.Hits + stats.Misses);
+    EXPECT_EQ(1, stats.Size);
+    EXPECT_GE(stats.Misses, 1);
+}
+
+}  // namespace ModelCacheTests
@@ -101,6 +101,23 @@ TEST(MutationEnumerationTest, TestTriRepeatMutations)
     EXPECT_EQ(Mutation::Deletion(11, 3), result[3]);
 }
 
+TEST(MutationEnumerationTest, TestHomopolymerMutations)
+{
+    string tpl = "ACCCGTTA";
+    Integrator ai(tpl, IntegratorConfig());
+
+    vector<Mutation> result = HomopolymerMutations(ai, 2, 2);
+    EXPECT_THAT(result, UnorderedElementsAreArray(
+                            {Mutation::Insertion(1, "C"), Mutation::Deletion(1, 1),
+                             Mutation::Insertion(1, "CC"), Mutation::Deletion(1, 2),
+                             Mutation::Insertion(5, "T"), Mutation::Deletion(5, 1),
+                             Mutation::Insertion(5, "TT"), Mutation::Deletion(5, 2)}));
+
+    // runs are never contracted by more than their length
+    EXPECT_EQ(4 * 2 + 3, HomopolymerMutations(ai, 3, 2).size());
+    EXPECT_EQ(5 * 2, HomopolymerMutations(ai, 1).size());
+}
+
 TEST(MutationEnumerationTest, TestNearbyMutations)
 {
     string tpl = "GAATT";
@@ -0,0 +1,221 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#include <gtest/gtest.h>
+
+#include <cfloat>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <pacbio/align/AlignConfig.h>
+#include <pacbio/data/Sequence.h>
+#include <pacbio/denovo/PoaConsensus.h>
+#include <pacbio/denovo/SparsePoa.h>
+
+#include "../src/poa/PoaColumnKernel.h"
+#include "RandomDNA.h"
+
+using namespace PacBio::Align;        // NOLINT
+using namespace PacBio::Poa;          // NOLINT
+using namespace PacBio::Poa::detail;  // NOLINT
+
+using PacBio::Data::ReverseComplement;
+
+namespace {
+
+std::vector<ColumnKernel> SupportedKernels()
+{
+    std::vector<ColumnKernel> kernels;
+    for (const auto k : {ColumnKernel::SCALAR, ColumnKernel::SSE41, ColumnKernel::AVX2})
+        if (k <= BestColumnKernel()) kernels.push_back(k);
+    return kernels;
+}
+
+// restores the active kernel on scope exit
+struct KernelGuard
+{
+    KernelGuard() : Saved(ActiveColumnKernel()) {}
+    ~KernelGuard() { UseColumnKernel(Saved); }
+    ColumnKernel Saved;
+};
+
+std::string Noisy(const std::string& tpl, std::mt19937* gen)
+{
+    const std::string bases = "ACGT";
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    std::uniform_int_distribution<size_t> b(0, 3);
+    std::string read;
+    for (const char base : tpl) {
+        const double r = u(*gen);
+        if (r < 0.06) {
+            read.push_back(bases[b(*gen)]);
+            read.push_back(base);
+        } else if (r < 0.09) {
+            continue;
+        } else if (r < 0.11) {
+            read.push_back(bases[b(*gen)]);
+        } else {
+            read.push_back(base);
+        }
+    }
+    return read;
+}
+
+}  // namespace anonymous
+
+TEST(PoaColumnKernelTest, PackedTrace)
+{
+    const uint32_t trace = PackTrace(5, DeleteMove);
+    EXPECT_EQ(DeleteMove, TraceMove(trace));
+    EXPECT_EQ(5, TracePredecessor(trace));
+    KernelGuard guard;
+    EXPECT_EQ(ColumnKernel::SCALAR, UseColumnKernel(ColumnKernel::SCALAR));
+    EXPECT_EQ(BestColumnKernel(), UseColumnKernel(ColumnKernel::AVX2));
+}
+
+TEST(PoaColumnKernelTest, MatchesScalarOnRandomColumns)
+{
+    // predecessor columns with random bands, integral scores and unset
+    // (-FLT_MAX) cells, so ties and band edges are frequent
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> scoreDist(-30, 30);
+    std::uniform_int_distribution<int> nPredDist(0, 4);
+    const AlignParams params(3, -5, -4, -4);
+
+    for (size_t iter = 0; iter < 2000; ++iter) {
+        const std::string read = RandomDNA(1 + gen() % 80, &gen);
+        const int nRows = read.size() + 1;
+        const char base = "ACGT"[gen() % 4];
+        const bool local = gen() % 2;
+
+        std::vector<std::vector<float>> storage;
+        std::vector<PredecessorScores> preds;
+        const int nPreds = nPredDist(gen);
+        for (int p = 0; p < nPreds; ++p) {
+            int begin = gen() % (nRows + 1), end = gen() % (nRows + 1);
+            if (begin > end) std::swap(begin, end);
+            storage.emplace_back(end - begin);
+            for (float& s : storage.back())
+                s = (gen() % 8 == 0) ? -FLT_MAX : scoreDist(gen);
+            preds.push_back(PredecessorScores{storage.back().data(), begin, end});
+        }
+        int beginRow = 1 + gen() % nRows, endRow = 1 + gen() % nRows;
+        if (beginRow > endRow) std::swap(beginRow, endRow);
+
+        std::vector<float> expScore(endRow - beginRow);
+        std::vector<uint32_t> expTrace(endRow - beginRow);
+        FillPredecessorMoves(ColumnKernel::SCALAR, preds.data(), preds.size(), read, base, params,
+                             local, beginRow, endRow, expScore.data(), expTrace.data());
+        for (const auto kernel : SupportedKernels()) {
+            std::vector<float> score(endRow - beginRow);
+            std::vector<uint32_t> trace(endRow - beginRow);
+            FillPredecessorMoves(kernel, preds.data(), preds.size(), read, base, params, local,
+                                 beginRow, endRow, score.data(), trace.data());
+            EXPECT_EQ(expScore, score);
+            EXPECT_EQ(expTrace, trace);
+        }
+
+        std::vector<float> column(gen() % 40);
+        for (float& s : column)
+            s = (gen() % 4 == 0) ? -FLT_MAX : scoreDist(gen);
+        const size_t expArgMax = ColumnArgMax(ColumnKernel::SCALAR, column.data(), column.size());
+        for (const auto kernel : SupportedKernels())
+            EXPECT_EQ(expArgMax, ColumnArgMax(kernel, column.data(), column.size()));
+    }
+}
+
+TEST(PoaColumnKernelTest, MatchesScalarConsensus)
+{
+    // the whole graph, scores and traceback included, must not depend on
+    //   the kernel, in any alignment mode
+    KernelGuard guard;
+    std::mt19937 gen(42);
+    for (const auto mode : {AlignMode::GLOBAL, AlignMode::SEMIGLOBAL, AlignMode::LOCAL}) {
+        for (size_t zmw = 0; zmw < 5; ++zmw) {
+            const std::string tpl = RandomDNA(300, &gen);
+            std::vector<std::string> reads;
+            for (size_t i = 0; i < 6; ++i) {
+                const std::string read = Noisy(tpl, &gen);
+                // local and semiglobal alignment get partial passes
+                reads.push_back(mode == AlignMode::GLOBAL || i % 2 == 0
+                                    ? read
+                                    : read.substr(gen() % 100, 150 + gen() % 100));
+            }
+
+            UseColumnKernel(ColumnKernel::SCALAR);
+            std::unique_ptr<const PoaConsensus> expected(
+                PoaConsensus::FindConsensus(reads, mode, 2));
+            const std::string expectedDot =
+                expected->Graph.ToGraphViz(PoaGraph::VERBOSE_NODES, expected.get());
+
+            for (const auto kernel : SupportedKernels()) {
+                UseColumnKernel(kernel);
+                std::unique_ptr<const PoaConsensus> pc(PoaConsensus::FindConsensus(reads, mode, 2));
+                EXPECT_EQ(expected->Sequence, pc->Sequence);
+                EXPECT_EQ(expectedDot, pc->Graph.ToGraphViz(PoaGraph::VERBOSE_NODES, pc.get()));
+            }
+        }
+    }
+}
+
+TEST(PoaColumnKernelTest, MatchesScalarSparsePoa)
+{
+    // banded (range finder) local alignment with orientation
+    KernelGuard guard;
+    std::mt19937 gen(43);
+    for (size_t zmw = 0; zmw < 5; ++zmw) {
+        const std::string tpl = RandomDNA(500, &gen);
+        std::vector<std::string> reads;
+        for (size_t i = 0; i < 8; ++i) {
+            const std::string read = Noisy(tpl, &gen);
+            reads.push_back(i % 2 ? ReverseComplement(read) : read);
+        }
+
+        const auto consensus = [&reads](const ColumnKernel kernel) {
+            UseColumnKernel(kernel);
+            SparsePoa sp;
+            for (const auto& read : reads)
+                sp.OrientAndAddRead(read);
+            std::vector<PoaAlignmentSummary> summaries;
+            return sp.FindConsensus(4, &summaries)->Sequence;
+        };
+
+        const std::string expected = consensus(ColumnKernel::SCALAR);
+        for (const auto kernel : SupportedKernels())
+            EXPECT_EQ(expected, consensus(kernel));
+    }
+}
@@ -44,12 +44,15 @@
 #include <boost/assign/std/vector.hpp>
 #include <cstdlib>
 #include <iostream>
+#include <map>
+#include <regex>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include <pacbio/align/AlignConfig.h>
 #include <pacbio/consensus/Mutation.h>
+#include <pacbio/data/Sequence.h>
 #include <pacbio/denovo/PoaConsensus.h>
 
 using std::string;
@@ -67,6 +70,21 @@ using namespace PacBio::Align;      // NOLINT
 
 namespace PoaConsensusTests {
 
+// (base, spanning reads) of each vertex, by id, from the verbose GraphViz
+// output, or (base, reads) if containing is set
+static std::map<size_t, std::pair<char, int>> SpanningReads(const PoaGraph& g,
+                                                            bool containing = false)
+{
+    const string dot = g.ToGraphViz(PoaGraph::VERBOSE_NODES);
+    const std::regex node(R"(label="\{ \{ (\d+) \| (.) \} \| \{ (\d+) \| (\d+) \})");
+    std::map<size_t, std::pair<char, int>> spanning;
+    for (std::sregex_iterator it(dot.begin(), dot.end(), node), end; it != end; ++it) {
+        spanning[std::stoul((*it)[1])] =
+            std::make_pair((*it)[2].str()[0], std::stoi((*it)[containing ? 3 : 4]));
+    }
+    return spanning;
+}
+
 static void plotConsensus(const PacBio::Poa::PoaConsensus* pc, string description,
                           bool REALLY_MAKE_THIS_ONE = false)
 {
@@ -578,6 +596,116 @@ TEST(PoaConsensus, TestSpanningReads)
     delete pc;
 }
 
+TEST(PoaConsensus, TestSpanningReadsStaggered)
+{
+    // reads tiling the template, one with an extra base
+    vector<string> reads{"GGGGAAAATTTT", "AAAATTTTCCCC", "AAAACTTTTCCCC", "TTTTCCCCGGGG"};
+    const AlignConfig config = DefaultPoaConfig(AlignMode::LOCAL);
+    PoaGraph g;
+    for (const string& read : reads)
+        g.AddRead(read, config);
+
+    // A read spans the vertices from its first to its last aligned one,
+    // and bases threaded past its ends inherit the coverage there: the
+    // CCCC of the second read and the GGGG of the last are 2 and 0.
+    // The extra C is spanned by the three reads covering AAAA and TTTT.
+    const string bases = "^$GGGGAAAATTTTCCCCCGGGG";
+    const int expected[] = {0, 0, 1, 1, 1, 1, 3, 3, 3, 3, 4, 4, 4, 4, 2, 2, 2, 2, 3, 0, 0, 0, 0};
+    const auto spanning = PoaConsensusTests::SpanningReads(g);
+    ASSERT_EQ(bases.length(), spanning.size());
+    for (size_t v = 0; v < bases.length(); ++v)
+        EXPECT_EQ(std::make_pair(bases[v], expected[v]), spanning.at(v));
+
+    // pruning leaves the coverage of the vertices that remain as it was
+    g.PruneGraph(2);
+    const auto pruned = PoaConsensusTests::SpanningReads(g);
+    EXPECT_EQ(12, pruned.size());  // AAAA, TTTT and CCCC
+    for (const auto& vertex : pruned)
+        EXPECT_EQ(spanning.at(vertex.first), vertex.second);
+}
+
+TEST(PoaConsensus, TestPruneUnsupportedVertices)
+{
+    // one read in six with an extra C, one with a G for a T
+    vector<string> reads{"GGGGAAAATTTTCCCC", "GGGGAAAATTTTCCCC", "GGGGAAAACTTTTCCCC",
+                         "GGGGAAAATTTTCCCC", "GGGGAAAAGTTTCCCC", "GGGGAAAATTTTCCCC"};
+    const AlignConfig config = DefaultPoaConfig(AlignMode::GLOBAL);
+    PoaGraph g;
+    for (const string& read : reads)
+        g.AddRead(read, config);
+    EXPECT_EQ(20, g.NumVertices());  // ^, $, the template, C and G
+
+    // the C and G are in one of the six reads spanning them
+    const auto spanning = PoaConsensusTests::SpanningReads(g);
+    EXPECT_EQ(0, g.PruneUnsupportedVertices(0.1f));
+    EXPECT_EQ(2, g.PruneUnsupportedVertices(0.2f));
+    EXPECT_EQ(18, g.NumVertices());
+    EXPECT_EQ(6, g.NumReads());
+
+    const auto pruned = PoaConsensusTests::SpanningReads(g);
+    EXPECT_EQ(18, pruned.size());
+    for (const auto& vertex : pruned)
+        EXPECT_EQ(spanning.at(vertex.first), vertex.second);
+
+    // reads are still added and called as before
+    g.AddRead("GGGGAAAACTTTTCCCC", config);
+    const PoaConsensus* pc = g.FindConsensus(config);
+    EXPECT_EQ("GGGGAAAATTTTCCCC", pc->Sequence);
+    EXPECT_EQ(7, g.NumReads());
+    delete pc;
+}
+
+TEST(PoaConsensus, TestMergeGraph)
+{
+    const AlignConfig config = DefaultPoaConfig(AlignMode::LOCAL);
+    vector<string> reads{"GGGGAAAATTTT", "AAAATTTTCCCC", "AAAACTTTTCCCC", "TTTTCCCCGGGG"};
+
+    // the reads added one by one, and the two halves merged, either way round
+    PoaGraph all, first, second, reversed;
+    for (size_t i = 0; i < reads.size(); ++i) {
+        all.AddRead(reads[i], config);
+        if (i < 2) {
+            first.AddRead(reads[i], config);
+        } else {
+            second.AddRead(reads[i], config);
+            reversed.AddRead(PacBio::Data::ReverseComplement(reads[i]), config);
+        }
+    }
+    PoaGraph reversedFirst(first);
+
+    vector<PoaGraph::Vertex> vertexMap;
+    first.MergeGraph(second, config, false, nullptr, &vertexMap);
+    reversedFirst.MergeGraph(reversed, config, true);
+    EXPECT_EQ(4, first.NumReads());
+    EXPECT_EQ(4, reversedFirst.NumReads());
+
+    // every vertex of second has its image, with the same base
+    const auto secondSpanning = PoaConsensusTests::SpanningReads(second);
+    const auto merged = PoaConsensusTests::SpanningReads(first);
+    ASSERT_EQ(secondSpanning.size(), vertexMap.size());
+    for (size_t v = 0; v < vertexMap.size(); ++v)
+        EXPECT_EQ(secondSpanning.at(v).first, merged.at(vertexMap[v]).first);
+
+    // the merged graph has the vertices and coverage of the one built
+    // read by read, bar the order of the vertex ids
+    const auto sorted = [](const std::map<size_t, std::pair<char, int>>& counts) {
+        vector<std::pair<char, int>> nodes;
+        for (const auto& node : counts)
+            nodes.push_back(node.second);
+        std::sort(nodes.begin(), nodes.end());
+        return nodes;
+    };
+    EXPECT_EQ(sorted(PoaConsensusTests::SpanningReads(all)), sorted(merged));
+    EXPECT_EQ(all.FindConsensusSequence(config), first.FindConsensusSequence(config));
+
+    // Merged the other way round, the vertices hold the same reads.  The
+    // coverage of overhangs is not strand symmetric (see tagSpan()), so
+    // the reversed half of the graph covers the end GGGG once.
+    EXPECT_EQ(sorted(PoaConsensusTests::SpanningReads(all, true)),
+              sorted(PoaConsensusTests::SpanningReads(reversedFirst, true)));
+    EXPECT_EQ("GGGGAAAATTTTCCCC", reversedFirst.FindConsensusSequence(config));
+}
+
 #if 0
 TEST(PoaConsensus, TestMutations)
 {
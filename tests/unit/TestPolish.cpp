@@ -39,8 +39,10 @@
 #include <gtest/gtest.h>
 
 #include <iostream>
+#include <random>
 #include <string>
 #include <tuple>
+#include <vector>
 
 using std::string;
 
@@ -48,6 +50,9 @@ using std::string;
 #include <pacbio/consensus/Polish.h>
 #include <pacbio/data/Read.h>
 #include <pacbio/data/Sequence.h>
+#include <pacbio/data/internal/ConversionFunctions.h>
+
+#include "RandomDNA.h"
 
 using namespace PacBio::Consensus;  // NOLINT
 using namespace PacBio::Data;       // NOLINT
@@ -107,4 +112,247 @@ TEST(PolishTest, DiTriRepeat)
     EXPECT_TRUE(result.hasConverged);
     EXPECT_EQ(read, string(ai));
 }
+
+TEST(PolishTest, HomopolymerShifts)
+{
+    //                      +2                   -2                       +3
+    const string tpl = "ACGTTTGCAAACTGACGATCGTAGGGGGTACCATGCAATCGTACGATCGACCCGTACTAGCA";
+    const string read = "ACGTTTTTGCAAACTGACGATCGTAGGGTACCATGCAATCGTACGATCGACCCCCCGTACTAGCA";
+
+    const auto mkIntegrator = [&]() {
+        Integrator ai(tpl, IntegratorConfig());
+        for (size_t i = 0; i < 3; ++i) {
+            ai.AddRead(MappedRead(MkRead(read, snr, mdl), StrandType::FORWARD, 0, tpl.length(),
+                                  true, true));
+            ai.AddRead(MappedRead(MkRead(ReverseComplement(read), snr, mdl), StrandType::REVERSE, 0,
+                                  tpl.length(), true, true));
+        }
+        return ai;
+    };
+
+    // single base shifts take as many iterations as the longest shift
+    Integrator single = mkIntegrator();
+    const auto singleResult = Polish(&single, PolishConfig());
+    EXPECT_TRUE(singleResult.hasConverged);
+    EXPECT_EQ(read, string(single));
+    EXPECT_EQ(3, singleResult.maxAlphaPopulated.size());
+
+    Integrator shifted = mkIntegrator();
+    const auto shiftedResult = Polish(&shifted, PolishConfig(40, 10, 20, false, 3));
+    EXPECT_TRUE(shiftedResult.hasConverged);
+    EXPECT_EQ(read, string(shifted));
+    EXPECT_EQ(1, shiftedResult.maxAlphaPopulated.size());
+    EXPECT_LT(shiftedResult.mutationsTested, singleResult.mutationsTested);
+
+    // no repeats of size 2 or 3 to polish here
+    Integrator repeats = mkIntegrator();
+    EXPECT_TRUE(PolishRepeats(&repeats, RepeatConfig(3, 3, 40, 10)).hasConverged);
+    EXPECT_EQ(tpl, string(repeats));
+
+    const auto repeatResult = PolishRepeats(&repeats, RepeatConfig(3, 3, 40, 10, 3));
+    EXPECT_TRUE(repeatResult.hasConverged);
+    EXPECT_EQ(read, string(repeats));
+    EXPECT_EQ(1, repeatResult.maxAlphaPopulated.size());
+}
+
+TEST(PolishTest, DiploidPrefilter)
+{
+    std::mt19937 gen(42);
+    const string hap1 = RandomDNA(60, &gen);
+    string hap2 = hap1;
+    hap2[30] = hap1[30] == 'A' ? 'C' : 'A';
+    const char code = PacBio::Data::detail::createAmbiguousBase(hap1[30], hap2[30]);
+
+    const auto mkIntegrator = [&]() {
+        Integrator ai(hap1, IntegratorConfig());
+        for (const auto& hap : {hap1, hap2}) {
+            for (size_t i = 0; i < 3; ++i) {
+                ai.AddRead(MappedRead(MkRead(hap, snr, mdl), StrandType::FORWARD, 0, hap1.length(),
+                                      true, true));
+                ai.AddRead(MappedRead(MkRead(ReverseComplement(hap), snr, mdl), StrandType::REVERSE,
+                                      0, hap1.length(), true, true));
+            }
+        }
+        return ai;
+    };
+
+    // only the heterozygous site gets an ambiguity code
+    Integrator ai = mkIntegrator();
+    size_t nCodes = 0;
+    for (const auto& mut : DiploidMutations(ai)) {
+        if (mut.IsSubstitution() && string("ACGT").find(mut.Bases()) == string::npos) {
+            ++nCodes;
+            EXPECT_EQ(30, mut.Start());
+            EXPECT_EQ(string(1, code), mut.Bases());
+        }
+    }
+    EXPECT_EQ(1, nCodes);
+
+    string expected = hap1;
+    expected[30] = code;
+
+    Integrator full = mkIntegrator();
+    const auto fullResult = Polish(&full, PolishConfig(40, 10, 20, true));
+    EXPECT_TRUE(fullResult.hasConverged);
+    EXPECT_EQ(expected, string(full));
+
+    // the histograms are charged to the budget and counted as tested mutations
+    Integrator prefiltered = mkIntegrator();
+    PolishBudget budget;
+    const auto prefilteredResult =
+        Polish(&prefiltered, PolishConfig(40, 10, 20, true, 0, 2), &budget);
+    EXPECT_TRUE(prefilteredResult.hasConverged);
+    EXPECT_EQ(expected, string(prefiltered));
+    EXPECT_EQ(1, prefilteredResult.diploidSites.size());
+    EXPECT_EQ(budget.MutationsTested(), prefilteredResult.mutationsTested);
+
+    // every tested mutation is scored against every read, so these compare
+    // evaluator calls: the prefilter stays within twice the haploid cost
+    Integrator haploid = mkIntegrator();
+    const auto haploidResult = Polish(&haploid, PolishConfig());
+    EXPECT_LT(prefilteredResult.mutationsTested, 2 * haploidResult.mutationsTested);
+    EXPECT_GT(fullResult.mutationsTested, 2 * haploidResult.mutationsTested);
+}
+
+TEST(PolishTest, BatchedRepeats)
+{
+    //                       1  2  31 2 3           1  2  31 2 3
+    const string tpl = "ACGTCAGCAGCAGAGAGTGCATTGACCTGACATCATCATGTGTGTACGA";
+    //                       1  2  3  41 2 3 4           1  2  3  41 2 3 4
+    const string read = "ACGTCAGCAGCAGCAGAGAGAGTGCATTGACCTGACATCATCATCATGTGTGTGTACGA";
+
+    const auto mkIntegrator = [&]() {
+        Integrator ai(tpl, IntegratorConfig());
+        for (size_t i = 0; i < 2; ++i) {
+            ai.AddRead(MappedRead(MkRead(read, snr, mdl), StrandType::FORWARD, 0, tpl.length(),
+                                  true, true));
+            ai.AddRead(MappedRead(MkRead(ReverseComplement(read), snr, mdl), StrandType::REVERSE, 0,
+                                  tpl.length(), true, true));
+        }
+        return ai;
+    };
+
+    Integrator single = mkIntegrator();
+    const auto singleResult = PolishRepeats(&single, RepeatConfig());
+
+    Integrator batched = mkIntegrator();
+    const auto batchedResult = PolishRepeats(&batched, RepeatConfig(3, 3, 40, 10));
+
+    EXPECT_TRUE(singleResult.hasConverged);
+    EXPECT_TRUE(batchedResult.hasConverged);
+    EXPECT_EQ(read, string(single));
+    EXPECT_EQ(read, string(batched));
+    EXPECT_EQ(4, batchedResult.mutationsApplied);
+    EXPECT_LT(batchedResult.maxAlphaPopulated.size(), singleResult.maxAlphaPopulated.size());
+}
+
+TEST(PolishTest, Budget)
+{
+    const auto mkIntegrator = []() {
+        Integrator ai("GCGTCGT", IntegratorConfig());
+        ai.AddRead(MappedRead(MkRead("ACGTACGT", snr, mdl), StrandType::FORWARD, 0, 7, true, true));
+        ai.AddRead(MappedRead(MkRead(ReverseComplement("ACGACGT"), snr, mdl), StrandType::REVERSE,
+                              0, 7, true, true));
+        ai.AddRead(MappedRead(MkRead("ACGACGT", snr, mdl), StrandType::FORWARD, 0, 7, true, true));
+        return ai;
+    };
+
+    {
+        Integrator ai = mkIntegrator();
+        PolishBudget budget(10);
+        const auto result = Polish(&ai, PolishConfig(), &budget);
+
+        EXPECT_TRUE(result.budgetExhausted);
+        EXPECT_FALSE(result.hasConverged);
+        EXPECT_EQ(10, result.mutationsTested);
+        EXPECT_EQ("GCGTCGT", string(ai));
+
+        const auto qvs = ConsensusQVs(ai, &budget);
+        EXPECT_EQ(std::vector<int>(7, 0), qvs.Qualities);
+    }
+
+    {
+        Integrator ai = mkIntegrator();
+        PolishBudget budget(10000);
+        const auto result = Polish(&ai, PolishConfig(), &budget);
+
+        EXPECT_FALSE(result.budgetExhausted);
+        EXPECT_TRUE(result.hasConverged);
+        EXPECT_EQ(result.mutationsTested, budget.MutationsTested());
+        EXPECT_EQ("ACGACGT", string(ai));
+    }
+}
+
+TEST(PolishTest, SparseQVs)
+{
+    std::mt19937 gen(42);
+    const string tpl = RandomDNA(400, &gen);
+    Integrator ai(tpl, IntegratorConfig());
+
+    // reads with about 1% random errors
+    std::uniform_int_distribution<size_t> site(1, tpl.length() - 2);
+    std::uniform_int_distribution<int> type(0, 2);
+    for (size_t n = 0; n < 10; ++n) {
+        std::vector<Mutation> errors;
+        for (size_t k = 0; k < 4; ++k) {
+            const size_t i = site(gen);
+            const char base = RandomDNA(1, &gen)[0];
+            const int errorType = type(gen);
+            if (errorType == 0)
+                errors.emplace_back(Mutation::Deletion(i, 1));
+            else if (errorType == 1)
+                errors.emplace_back(Mutation::Insertion(i, base));
+            else if (base != tpl[i])
+                errors.emplace_back(Mutation::Substitution(i, base));
+        }
+        const string read = ApplyMutations(tpl, &errors);
+        const StrandType strand = n % 2 ? StrandType::REVERSE : StrandType::FORWARD;
+        const string seq = strand == StrandType::FORWARD ? read : ReverseComplement(read);
+        ai.AddRead(MappedRead(MkRead(seq, snr, mdl), strand, 0, tpl.length(), true, true));
+    }
+
+    PolishBudget fullBudget, sparseBudget;
+    const auto full = ConsensusQVs(ai, &fullBudget);
+    const auto sparse = ConsensusQVs(ai, &sparseBudget, QvConfig(0.2, 5, 40));
+
+    // uncontested sites take the cap, and only where full scoring agrees
+    size_t capped = 0;
+    for (size_t i = 0; i < tpl.length(); ++i) {
+        if (sparse.Qualities[i] == 40 && full.Qualities[i] != 40) {
+            EXPECT_GT(full.Qualities[i], 40) << "at " << i;
+            ++capped;
+        } else
+            EXPECT_EQ(full.Qualities[i], sparse.Qualities[i]) << "at " << i;
+    }
+    EXPECT_GT(capped, 3 * tpl.length() / 4);
+    EXPECT_LT(2 * sparseBudget.MutationsTested(), fullBudget.MutationsTested());
+}
+
+TEST(PolishTest, Windows)
+{
+    std::mt19937 gen(42);
+    const string tpl = RandomDNA(600, &gen);
+    const auto otherBase = [](const char b) { return b == 'A' ? 'C' : 'A'; };
+
+    // errors within a single window and within window overlaps
+    std::vector<Mutation> errors = {
+        Mutation::Substitution(60, otherBase(tpl[60])), Mutation::Deletion(180, 1),
+        Mutation::Substitution(320, otherBase(tpl[320])), Mutation::Deletion(520, 1)};
+    string draft = ApplyMutations(tpl, &errors);
+
+    std::vector<MappedRead> reads;
+    for (size_t i = 0; i < 2; ++i) {
+        reads.emplace_back(MkRead(tpl, snr, mdl), StrandType::FORWARD, 0, draft.length(), true,
+                           true);
+        reads.emplace_back(MkRead(ReverseComplement(tpl), snr, mdl), StrandType::REVERSE, 0,
+                           draft.length(), true, true);
+    }
+
+    const auto result =
+        PolishWindows(&draft, reads, IntegratorConfig(), PolishConfig(), WindowConfig(200, 50, 2));
+
+    EXPECT_TRUE(result.hasConverged);
+    EXPECT_GE(result.mutationsApplied, errors.size());
+    EXPECT_EQ(tpl, draft);
+}
 }  // namespace PolishTests
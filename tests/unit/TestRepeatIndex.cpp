@@ -0,0 +1,118 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <pacbio/consensus/Mutation.h>
+#include "../src/RepeatIndex.h"
+
+using std::string;
+using std::vector;
+
+using namespace PacBio::Consensus;  // NOLINT
+
+namespace RepeatIndexTests {
+
+TEST(RepeatIndexTest, DiTriRepeats)
+{
+    const RepeatIndex index("ACGTCAGCAGCAGCAGAGAGAGTGCA", 3, 3);
+    const vector<Mutation> expected = {Mutation::Insertion(4, "CAG"), Mutation::Deletion(4, 3),
+                                       Mutation::Insertion(14, "AG"), Mutation::Deletion(14, 2)};
+    EXPECT_EQ(expected, index.Mutations());
+}
+
+TEST(RepeatIndexTest, MinimumElementCount)
+{
+    const string tpl = "ACGTATATCAGCAGGT";
+    EXPECT_EQ(4, RepeatIndex(tpl, 3, 2).Mutations().size());
+    EXPECT_TRUE(RepeatIndex(tpl, 3, 3).Mutations().empty());
+    EXPECT_TRUE(RepeatIndex(tpl, 1, 2).Mutations().empty());
+}
+
+TEST(RepeatIndexTest, IncrementalUpdates)
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<size_t> unitSize(1, 4);
+    std::uniform_int_distribution<size_t> nElem(1, 5);
+    std::uniform_int_distribution<size_t> base(0, 3);
+    const string bases = "ACGT";
+
+    const auto randomRepeats = [&]() {
+        string tpl;
+        while (tpl.length() < 200) {
+            string unit;
+            for (size_t i = unitSize(gen); i > 0; --i)
+                unit += bases[base(gen)];
+            for (size_t i = nElem(gen); i > 0; --i)
+                tpl += unit;
+        }
+        return tpl;
+    };
+
+    for (size_t round = 0; round < 50; ++round) {
+        RepeatIndex index(randomRepeats(), 4, 3);
+
+        for (size_t iter = 0; iter < 10; ++iter) {
+            // a batch of non-overlapping mutations, several bases apart
+            vector<Mutation> muts;
+            const size_t len = index.Template().length();
+            std::uniform_int_distribution<size_t> gap(1, 30);
+            for (size_t pos = gap(gen); pos + 3 < len; pos += 3 + gap(gen)) {
+                const string unit = index.Template().substr(pos, unitSize(gen));
+                switch (base(gen)) {
+                    case 0:
+                        muts.emplace_back(Mutation::Insertion(pos, unit));
+                        break;
+                    case 1:
+                        muts.emplace_back(Mutation::Deletion(pos, unit.length()));
+                        break;
+                    default:
+                        muts.emplace_back(Mutation::Substitution(pos, bases[base(gen)]));
+                }
+            }
+
+            index.ApplyMutations(muts);
+            const RepeatIndex fresh(index.Template(), 4, 3);
+
+            ASSERT_EQ(fresh.Mutations(), index.Mutations()) << index.Template();
+        }
+    }
+}
+
+}  // namespace RepeatIndexTests
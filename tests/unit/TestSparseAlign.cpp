@@ -117,6 +117,22 @@ TEST(SparseAlignTest, SimpleAlign)
     EXPECT_EQ(s2.size() - K, lst.second);
 }
 
+TEST(SparseAlignTest, IndexedAlign)
+{
+    const size_t K = 5;
+    string s1 = "ACGTACACACAGTACAGTACAAGTTTCACGGACATTTGGTTCCCACTTGTACAGTGCACACGGGTTACACGT";
+    string s2 = "ACGTACACCAGTAAGTACAAGTTTCACGCGAATTTGGTTCCCACTTGTCAAGTGCACACGGGTTACACGT";
+    string s3 =
+        "ACGTACACACAGTACAGTACAAGTTTCACGGACATAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAATTGGTTCCCACTTGTAC"
+        "AGTGCACACGGGTTACACGT";
+    const PacBio::QGram::Index index(K, s1);
+
+    // an index on the first sequence anchors the second as SparseAlign() does
+    EXPECT_EQ(PacBio::CCS::SparseAlign(K, s1, s2), PacBio::CCS::SparseAlign(index, s2));
+    EXPECT_EQ(PacBio::CCS::SparseAlign(K, s1, s3), PacBio::CCS::SparseAlign(index, s3));
+    EXPECT_EQ(0, PacBio::CCS::SparseAlign(index, "AAAATCCCCCCCCCCAGGGGG").size());
+}
+
 TEST(SparseAlignTest, LongAlign)
 {
     const size_t K = 5;
@@ -35,6 +35,7 @@
 
 // Author: David Alexander
 
+#include <chrono>
 #include <iostream>
 #include <random>
 
@@ -44,9 +45,12 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <pacbio/ccs/SparseAlignment.h>
 #include <pacbio/denovo/PoaConsensus.h>
 #include <pacbio/denovo/SparsePoa.h>
 
+#include "../src/poa/ReadOrientation.h"
+#include "RandomDNA.h"
 #include "TestData.h"
 #include "TestUtility.h"
 
@@ -219,6 +223,262 @@ std::string rc(const std::string& a)
     return b;
 }
 
+// A read of tpl with errors at errorRate of its bases: half of them
+// insertions of one of the two insertion bases, half deletions
+std::string NoisyRead(const std::string& tpl, std::mt19937* const gen, const char* insertions,
+                      const double errorRate = 0.10)
+{
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    std::string read;
+    for (const char base : tpl) {
+        const double r = u(*gen);
+        if (r < errorRate / 2)
+            read += insertions[r < errorRate / 4] + std::string(1, base);
+        else if (r >= errorRate)
+            read.push_back(base);
+    }
+    return read;
+}
+
+// Exposes the anchors an SdpRangeFinder finds
+class AnchorFinder : public SdpRangeFinder
+{
+public:
+    using SdpRangeFinder::FindAnchors;
+};
+
+TEST(SparsePoaTest, RangeFinderAnchors)
+{
+    std::mt19937 gen(23);
+    // the anchors of the consensus index are the ones of indexing each read
+    const std::string css = RandomDNA(500, &gen);
+    AnchorFinder finder;
+    for (size_t i = 0; i < 6; ++i) {
+        const std::string read = NoisyRead(i % 2 ? rc(css) : css, &gen, "AT");
+        EXPECT_EQ(PacBio::CCS::SparseAlign(6, css, read), finder.FindAnchors(css, read));
+        EXPECT_EQ(PacBio::CCS::SparseAlign(6, css, rc(read)), finder.FindAnchors(css, rc(read)));
+    }
+
+    // and the consensus is indexed once for all the reads, in both
+    // orientations, and again only once it changes
+    EXPECT_EQ(1, finder.NumIndexBuilds());
+    const std::string next = css.substr(0, 250) + "A" + css.substr(250);
+    const std::string read = NoisyRead(css, &gen, "AT");
+    EXPECT_EQ(PacBio::CCS::SparseAlign(6, next, read), finder.FindAnchors(next, read));
+    EXPECT_EQ(PacBio::CCS::SparseAlign(6, next, rc(read)), finder.FindAnchors(next, rc(read)));
+    EXPECT_EQ(2, finder.NumIndexBuilds());
+}
+
+TEST(SparsePoaTest, OrientReadByKmers)
+{
+    using PacBio::Poa::detail::CountSharedKmers;
+    using PacBio::Poa::detail::Orientation;
+    using PacBio::Poa::detail::OrientRead;
+
+    std::mt19937 gen(7);
+    const std::string ref = RandomDNA(1000, &gen);
+    const std::string sub = ref.substr(200, 300);
+    EXPECT_EQ(Orientation::FORWARD, OrientRead(ref, sub));
+    EXPECT_EQ(Orientation::REVERSE, OrientRead(ref, rc(sub)));
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(Orientation::FORWARD, OrientRead(ref, NoisyRead(ref, &gen, "AC", 0.12)));
+        EXPECT_EQ(Orientation::REVERSE, OrientRead(ref, NoisyRead(rc(ref), &gen, "AC", 0.12)));
+    }
+
+    // every k-mer of an exact substring is shared, and N breaks k-mers
+    const auto shared = CountSharedKmers(ref, sub, 12);
+    EXPECT_EQ(300 - 12 + 1, shared.Forward);
+    std::string withN = sub;
+    withN[150] = 'N';
+    EXPECT_EQ(300 - 12 + 1 - 12, CountSharedKmers(ref, withN, 12).Forward);
+
+    // too short, or unrelated, reads are left to dual alignment
+    EXPECT_EQ(Orientation::AMBIGUOUS, OrientRead(ref, ref.substr(10, 14)));
+    EXPECT_EQ(Orientation::AMBIGUOUS, OrientRead(ref, RandomDNA(1000, &gen)));
+    EXPECT_EQ(Orientation::AMBIGUOUS, OrientRead("", sub));
+}
+
+TEST(SparsePoaTest, OrientNoisyPasses)
+{
+    std::mt19937 gen(11);
+    const std::string tpl = RandomDNA(500, &gen);
+    SparsePoa sp;
+    for (int i = 0; i < 8; ++i)
+        EXPECT_EQ(i, sp.OrientAndAddRead(NoisyRead(i % 2 ? rc(tpl) : tpl, &gen, "GT")));
+
+    vector<PoaAlignmentSummary> summaries;
+    const string css = sp.FindConsensus(4, &summaries)->Sequence;
+    EXPECT_EQ(tpl, css);
+    for (int i = 0; i < 8; ++i)
+        EXPECT_EQ(i % 2 == 1, summaries[i].ReverseComplementedRead);
+}
+
+TEST(SparsePoaTest, ProgressiveNoisyPasses)
+{
+    std::mt19937 gen(17);
+    const std::string tpl = RandomDNA(600, &gen);
+    vector<string> reads;
+    for (int i = 0; i < 18; ++i)
+        reads.push_back(NoisyRead(i % 2 ? rc(tpl) : tpl, &gen, "AG"));
+
+    // partitions of 4 or 5 reads, merged over two rounds
+    SparsePoa sp;
+    const auto keys = sp.OrientAndAddReads(reads, 4);
+    ASSERT_EQ(reads.size(), keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+        EXPECT_EQ(static_cast<int>(i), keys[i]);
+
+    vector<PoaAlignmentSummary> summaries;
+    const string css = sp.FindConsensus(9, &summaries)->Sequence;
+    EXPECT_EQ(tpl, css);
+    ASSERT_EQ(reads.size(), summaries.size());
+    for (size_t i = 0; i < summaries.size(); ++i) {
+        EXPECT_EQ(i % 2 == 1, summaries[i].ReverseComplementedRead);
+        EXPECT_GT(summaries[i].ExtentOnConsensus.Length(), 550);
+        EXPECT_GT(summaries[i].ExtentOnRead.Length(), 500);
+    }
+
+    // too few reads to split are added one by one
+    SparsePoa few;
+    const vector<string> three(reads.begin(), reads.begin() + 3);
+    EXPECT_EQ(vector<SparsePoa::ReadKey>({0, 1, 2}), few.OrientAndAddReads(three, 4));
+
+    // each of two partitions of 9 reads is pruned on its own, once its
+    // first 6 reads are in
+    SparsePoa pruned;
+    const auto prunedKeys = pruned.OrientAndAddReads(reads, 2, PoaPruning(6, 0.25f));
+    ASSERT_EQ(reads.size(), prunedKeys.size());
+    const PoaGraphStats stats = pruned.GraphStats();
+    EXPECT_EQ(2, stats.Prunings);
+    EXPECT_GT(stats.PrunedVertices, 0);
+    EXPECT_LT(stats.NumVertices, sp.GraphStats().NumVertices);
+    EXPECT_EQ(tpl, pruned.FindConsensus(9)->Sequence);
+}
+
+TEST(SparsePoaTest, OnlinePruning)
+{
+    std::mt19937 gen(19);
+    const std::string tpl = RandomDNA(500, &gen);
+    vector<string> reads;
+    for (int i = 0; i < 16; ++i)
+        reads.push_back(NoisyRead(i % 2 ? rc(tpl) : tpl, &gen, "GT"));
+
+    const PoaPruning disabled;
+    const PoaPruning pruning(6, 0.25f);
+    EXPECT_FALSE(disabled.Enabled());
+    EXPECT_TRUE(pruning.Enabled());
+
+    SparsePoa full, sp;
+    for (const string& read : reads) {
+        EXPECT_GE(full.OrientAndAddRead(read), 0);
+        EXPECT_EQ(0, full.PruneIfDue(disabled));
+        EXPECT_GE(sp.OrientAndAddRead(read), 0);
+        sp.PruneIfDue(pruning);
+    }
+
+    // pruned at 6, 10 and 14 reads, down to little more than the template
+    const PoaGraphStats fullStats = full.GraphStats();
+    const PoaGraphStats stats = sp.GraphStats();
+    EXPECT_EQ(0, fullStats.Prunings);
+    EXPECT_EQ(fullStats.NumVertices, fullStats.PeakVertices);
+    EXPECT_EQ(3, stats.Prunings);
+    EXPECT_GT(stats.PrunedVertices, 0);
+    EXPECT_GE(stats.PeakVertices, stats.NumVertices);
+    EXPECT_LT(4 * stats.NumVertices, 3 * fullStats.NumVertices);
+    EXPECT_LT(stats.NumEdges, fullStats.NumEdges);
+
+    // with the same consensus, and the reads still summarized against it,
+    // though the later ones are aligned to fewer of the errors of others
+    vector<PoaAlignmentSummary> fullSummaries, summaries;
+    EXPECT_EQ(tpl, full.FindConsensus(8, &fullSummaries)->Sequence);
+    EXPECT_EQ(tpl, sp.FindConsensus(8, &summaries)->Sequence);
+    ASSERT_EQ(reads.size(), summaries.size());
+    for (size_t i = 0; i < summaries.size(); ++i) {
+        EXPECT_EQ(i % 2 == 1, summaries[i].ReverseComplementedRead);
+        EXPECT_GT(summaries[i].ExtentOnConsensus.Length(), 480);
+        EXPECT_GT(summaries[i].ExtentOnRead.Length(), 450);
+        EXPECT_NEAR(fullSummaries[i].AlignmentIdentity, summaries[i].AlignmentIdentity, 0.025);
+    }
+}
+
+TEST(SparsePoaTest, ConvergenceEarlyStop)
+{
+    std::mt19937 gen(13);
+    const std::string tpl = RandomDNA(400, &gen);
+    const PoaConvergence disabled;
+    const PoaConvergence convergence(3);
+    EXPECT_FALSE(disabled.Enabled());
+    EXPECT_TRUE(convergence.Enabled());
+
+    SparsePoa sp;
+    EXPECT_FALSE(sp.HasConverged(convergence));
+    size_t nAdded = 0;
+    while (nAdded < 30 && !sp.HasConverged(convergence)) {
+        EXPECT_FALSE(sp.HasConverged(disabled));
+        sp.OrientAndAddRead(NoisyRead(nAdded % 2 ? rc(tpl) : tpl, &gen, "CA"));
+        ++nAdded;
+    }
+    EXPECT_TRUE(sp.HasConverged(convergence));
+    EXPECT_FALSE(sp.HasConverged(disabled));
+    EXPECT_LT(nAdded, 30);
+
+    // the reads left out are only mapped to the draft
+    vector<PoaAlignmentSummary> summaries;
+    const auto pc = sp.FindConsensus(nAdded / 2, &summaries);
+    ASSERT_EQ(nAdded, summaries.size());
+
+    const std::string sub = pc->Sequence.substr(100, 200);
+    EXPECT_EQ(static_cast<int>(nAdded), sp.MapRead(*pc, NoisyRead(tpl, &gen, "CA"), &summaries));
+    EXPECT_EQ(static_cast<int>(nAdded + 1), sp.MapRead(*pc, sub, &summaries));
+    EXPECT_EQ(static_cast<int>(nAdded + 2), sp.MapRead(*pc, rc(sub), &summaries));
+    ASSERT_EQ(nAdded + 3, summaries.size());
+
+    EXPECT_FALSE(summaries[nAdded].ReverseComplementedRead);
+    EXPECT_EQ(Interval(100, 300), summaries[nAdded + 1].ExtentOnConsensus);
+    EXPECT_EQ(Interval(0, 200), summaries[nAdded + 1].ExtentOnRead);
+    EXPECT_FALSE(summaries[nAdded + 1].ReverseComplementedRead);
+    EXPECT_EQ(Interval(100, 300), summaries[nAdded + 2].ExtentOnConsensus);
+    EXPECT_EQ(Interval(0, 200), summaries[nAdded + 2].ExtentOnRead);
+    EXPECT_TRUE(summaries[nAdded + 2].ReverseComplementedRead);
+}
+
+TEST(SparsePoaTest, ConvergenceDecidedFlip)
+{
+    std::mt19937 gen(42);
+    const auto mutate = [](std::string seq, std::initializer_list<size_t> sites) {
+        for (const size_t i : sites)
+            seq[i] = (seq[i] == 'A') ? 'C' : 'A';
+        return seq;
+    };
+
+    // a split site at 100 that stays undecided, and four sites where the
+    // reads of the second half outvote the decided bases of the first
+    const std::string tpl = RandomDNA(200, &gen);
+    const std::string split = mutate(tpl, {100});
+    const std::string flipped = mutate(tpl, {50, 75, 125, 150});
+    const std::string flippedSplit = mutate(tpl, {50, 75, 100, 125, 150});
+    const PoaConvergence convergence(1, 4, 1.0f);
+
+    SparsePoa sp;
+    for (size_t i = 0; i < 3; ++i) {
+        sp.OrientAndAddRead(tpl);
+        sp.OrientAndAddRead(split);
+    }
+    EXPECT_FALSE(sp.HasConverged(convergence));
+
+    // only the two vertices of the split site are undecided now, but the
+    // consensus changed at four others
+    for (size_t i = 0; i < 5; ++i) {
+        sp.OrientAndAddRead(flipped);
+        sp.OrientAndAddRead(flippedSplit);
+    }
+    EXPECT_FALSE(sp.HasConverged(convergence));
+
+    sp.OrientAndAddRead(flipped);
+    EXPECT_TRUE(sp.HasConverged(convergence));
+    EXPECT_EQ(flipped, sp.FindConsensus(8)->Sequence);
+}
+
 #if EXTENSIVE_TESTING
 constexpr size_t numIterations = 100;
 #else
@@ -297,3 +557,69 @@ TEST(SparsePoaTest, SingleAndHalfNTimes)
         EXPECT_TRUE(summaries[id2].ReverseComplementedRead);
     }
 }
+
+#if EXTENSIVE_TESTING
+// disable this test under debug builds (which are not fast enough to give meaningful timings)
+#ifndef NDEBUG
+TEST(SparsePoaTest, DISABLED_DraftTiming)
+#else
+TEST(SparsePoaTest, DraftTiming)
+#endif
+{
+    // simulate ZMWs of alternating-strand passes with ~10% indel-dominated
+    //   error, and time the draft POA that ccs runs on each of them
+    const size_t nZmws = 20;
+    const size_t nPasses = 10;
+    const size_t tplLength = 1000;
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    std::uniform_int_distribution<size_t> b(0, 3);
+    const std::string bases = "ACGT";
+
+    const auto noisy = [&](const std::string& tpl) {
+        std::string read;
+        for (const char base : tpl) {
+            const double r = u(gen);
+            if (r < 0.05) {
+                read.push_back(bases[b(gen)]);
+                read.push_back(base);
+            } else if (r < 0.08) {
+                continue;
+            } else if (r < 0.10) {
+                read.push_back(bases[b(gen)]);
+            } else {
+                read.push_back(base);
+            }
+        }
+        return read;
+    };
+
+    std::vector<std::vector<std::string>> zmws;
+    for (size_t i = 0; i < nZmws; ++i) {
+        const std::string tpl = RandomDNA(tplLength, &gen);
+        std::vector<std::string> passes;
+        for (size_t j = 0; j < nPasses; ++j)
+            passes.emplace_back(noisy(j % 2 ? rc(tpl) : tpl));
+        zmws.emplace_back(std::move(passes));
+    }
+
+    size_t cssLength = 0;
+    const auto stime = std::chrono::high_resolution_clock::now();
+    for (const auto& passes : zmws) {
+        SparsePoa sp;
+        for (const auto& pass : passes)
+            sp.OrientAndAddRead(pass);
+        std::vector<PoaAlignmentSummary> summaries;
+        const auto pc = sp.FindConsensus(nPasses / 2, &summaries);
+        cssLength += pc->Sequence.length();
+    }
+    const auto etime = std::chrono::high_resolution_clock::now();
+    const auto perZmw =
+        std::chrono::duration_cast<std::chrono::microseconds>(etime - stime).count() / nZmws;
+
+    std::cout << "avg draft POA: " << perZmw << "us per ZMW (" << nPasses << " x " << tplLength
+              << "bp passes)" << std::endl;
+    EXPECT_NEAR(tplLength, cssLength / nZmws, tplLength / 10);
+}
+#endif
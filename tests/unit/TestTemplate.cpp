@@ -38,6 +38,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <iostream>
 #include <random>
 #include <string>
@@ -296,6 +297,33 @@ TEST(TemplateTest, TestMutatedTemplateEquivalence)
     TemplateEquivalence(numSamples / 2, 20, 30);
 }
 
+TEST(TemplateTest, LongMutatedTemplate)
+{
+    // mutations both shorter and longer than the inline storage of MutatedTemplate
+    std::mt19937 gen(42);
+    const string tpl = RandomDNA(40, &gen);
+    Template master(tpl, ModelFactory::Create(mdl, snr));
+
+    for (size_t n = 1; n <= 12; ++n) {
+        for (const size_t pos : {size_t(0), size_t(17), tpl.length() - n}) {
+            const string bases = RandomDNA(n, &gen);
+            for (const auto& mut :
+                 {Mutation::Insertion(pos, bases), Mutation::Substitution(pos, bases),
+                  Mutation::Deletion(pos, n)}) {
+                vector<Mutation> muts{mut};
+                const Template expected(ApplyMutations(tpl, &muts), ModelFactory::Create(mdl, snr));
+                const auto mutTpl = master.Mutate(mut);
+                ASSERT_TRUE(bool(mutTpl));
+
+                // a copy must not refer back to the original's storage
+                const MutatedTemplate copy(*mutTpl);
+                EXPECT_TRUE(expected == copy);
+                EXPECT_EQ(ToString(expected), ToString(copy));
+            }
+        }
+    }
+}
+
 TEST(TemplateTest, TestPinning)
 {
     constexpr size_t len = 5;
@@ -364,6 +392,101 @@ TEST(TemplateTest, NullTemplate)
     ASSERT_NO_THROW(Template("AA", ModelFactory::Create(mdl, snr), 0, 2, true, true));
 }
 
+TEST(TemplateTest, BatchedMutations)
+{
+    constexpr size_t len = 60;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<size_t> randPos(0, len);
+    std::uniform_int_distribution<size_t> randLen(1, 3);
+    std::uniform_int_distribution<int> randType(0, 2);
+    std::uniform_int_distribution<size_t> randNMuts(1, 8);
+    std::bernoulli_distribution randBool(0.5);
+
+    for (size_t i = 0; i < 500; ++i) {
+        const string tpl = RandomDNA(len, &gen);
+
+        // a batch of disjoint (but possibly abutting) mutations
+        vector<Mutation> muts;
+        const size_t nMuts = randNMuts(gen);
+        size_t pos = 0;
+        for (size_t j = 0; j < nMuts && pos <= len; ++j) {
+            pos = std::min(len, pos + randPos(gen) / nMuts);
+            const size_t n = std::min(randLen(gen), len - pos);
+            const int type = randType(gen);
+            if (type == 0 || n == 0) {
+                muts.emplace_back(Mutation::Insertion(pos, RandomDNA(randLen(gen), &gen)));
+                continue;
+            }
+            if (type == 1)
+                muts.emplace_back(Mutation::Deletion(pos, n));
+            else
+                muts.emplace_back(Mutation::Substitution(pos, RandomDNA(n, &gen)));
+            pos += n;
+        }
+        std::shuffle(muts.begin(), muts.end(), gen);
+
+        // the spliced string agrees with back-to-front application
+        vector<Mutation> sorted(muts);
+        std::sort(sorted.begin(), sorted.end(), Mutation::SiteComparer);
+        string expected(tpl);
+        for (auto it = sorted.crbegin(); it != sorted.crend(); ++it) {
+            if (it->IsInsertion())
+                expected.insert(it->Start(), it->Bases());
+            else
+                expected.replace(it->Start(), it->Length(), it->Bases());
+        }
+        vector<Mutation> strMuts(muts);
+        EXPECT_EQ(expected, ApplyMutations(tpl, &strMuts));
+
+        // and so does the batched template, parameters included
+        const bool pinStart = randBool(gen);
+        const bool pinEnd = randBool(gen);
+        Template batched(tpl, ModelFactory::Create(mdl, snr), 0, len, pinStart, pinEnd);
+        Template sequential(tpl, ModelFactory::Create(mdl, snr), 0, len, pinStart, pinEnd);
+
+        vector<Mutation> batchMuts(muts);
+        vector<Mutation> seqMuts(muts);
+        bool batchedThrew = false, sequentialThrew = false;
+        bool batchedApplied = false, sequentialApplied = false;
+        try {
+            batchedApplied = batched.ApplyMutations(&batchMuts);
+        } catch (const TemplateTooSmall&) {
+            batchedThrew = true;
+        }
+        try {
+            sequentialApplied = sequential.AbstractTemplate::ApplyMutations(&seqMuts);
+        } catch (const TemplateTooSmall&) {
+            sequentialThrew = true;
+        }
+
+        ASSERT_EQ(sequentialThrew, batchedThrew);
+        if (sequentialThrew) continue;
+        EXPECT_EQ(sequentialApplied, batchedApplied);
+        EXPECT_EQ(sequential.Start(), batched.Start());
+        EXPECT_EQ(ToString(sequential), ToString(batched));
+        EXPECT_TRUE(sequential == batched);
+    }
+}
+
+TEST(TemplateTest, OverlappingBatchedMutations)
+{
+    const string tpl = "ACGTACGTACGTACGTACGT";
+    const vector<Mutation> muts = {Mutation::Deletion(5, 3), Mutation::Substitution(6, "TT"),
+                                   Mutation::Insertion(12, "G")};
+
+    vector<Mutation> strMuts(muts);
+    EXPECT_EQ("ACGTAACGTGACGTACGT", ApplyMutations(tpl, &strMuts));
+
+    Template batched(tpl, ModelFactory::Create(mdl, snr));
+    Template sequential(tpl, ModelFactory::Create(mdl, snr));
+    vector<Mutation> batchMuts(muts);
+    vector<Mutation> seqMuts(muts);
+    EXPECT_TRUE(batched.ApplyMutations(&batchMuts));
+    EXPECT_TRUE(sequential.AbstractTemplate::ApplyMutations(&seqMuts));
+    EXPECT_EQ("ACGTAACGTGACGTACGT", ToString(batched));
+    EXPECT_TRUE(sequential == batched);
+}
+
 TEST(TemplateTest, P6SiteNormalParameters)
 {
     const string tpl = "ACGATACATACGATCGA";
@@ -376,4 +499,124 @@ TEST(TemplateTest, P6SiteNormalParameters)
     EXPECT_EQ(30.392545575324248, results.second);
 }
 
+TEST(TemplateTest, IncrementalNormalParameters)
+{
+    constexpr size_t len = 80;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<size_t> randPos(0, len - 10);
+    std::uniform_int_distribution<int> randType(0, 2);
+
+    const string tpl = RandomDNA(len, &gen);
+    Template single(tpl, ModelFactory::Create(mdl, snr));
+    Template batched(tpl, ModelFactory::Create(mdl, snr));
+
+    for (size_t i = 0; i < 50; ++i) {
+        const size_t pos = randPos(gen);
+        const int type = randType(gen);
+        vector<Mutation> muts{Mutation::Deletion(pos, 2),
+                              Mutation::Substitution(pos + 5, RandomDNA(1, &gen))};
+        if (type == 0)
+            muts[0] = Mutation::Insertion(pos, RandomDNA(2, &gen));
+        else if (type == 1)
+            muts[0] = Mutation::Substitution(pos, RandomDNA(2, &gen));
+
+        single.ApplyMutation(muts[1]);
+        single.ApplyMutation(muts[0]);
+        batched.ApplyMutations(&muts);
+
+        const Template fresh(ToString(single), ModelFactory::Create(mdl, snr));
+        EXPECT_EQ(fresh.NormalParameters(), single.NormalParameters());
+        EXPECT_EQ(fresh.NormalParameters(), batched.NormalParameters());
+    }
+
+    // any window is parameterized like a template of its own
+    const string result = ToString(single);
+    for (size_t begin = 0; begin + 2 <= result.length(); begin += 7) {
+        for (size_t end = begin + 2; end <= result.length(); end += 11) {
+            const string sub = result.substr(begin, end - begin);
+            const Template window(sub, ModelFactory::Create(mdl, snr));
+            const auto expected = window.NormalParameters();
+            const auto actual = single.NormalParameters(begin, end);
+            EXPECT_NEAR(expected.first, actual.first, 1e-9);
+            EXPECT_NEAR(expected.second, actual.second, 1e-9);
+        }
+    }
+}
+
+TEST(TemplateTest, WindowedTemplateEquivalence)
+{
+    constexpr size_t len = 60;
+    constexpr size_t nWindows = 10;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<size_t> randIdx(0, len - 1);
+    std::bernoulli_distribution randBool(0.5);
+
+    const string tpl = RandomDNA(len, &gen);
+    auto master = std::make_shared<Template>(tpl, ModelFactory::Create(mdl, snr));
+
+    vector<Template> expected;
+    vector<WindowedTemplate> windows;
+    for (size_t i = 0; i < nWindows; ++i) {
+        size_t start = 0, end = len;
+        if (i > 1) {
+            do {
+                start = randIdx(gen);
+                end = randIdx(gen);
+            } while (std::max(start, end) - std::min(start, end) < 10);
+            if (end < start) swap(start, end);
+        }
+        const bool pinStart = start == 0 && randBool(gen);
+        const bool pinEnd = end == len && randBool(gen);
+        expected.emplace_back(tpl.substr(start, end - start), ModelFactory::Create(mdl, snr), start,
+                              end, pinStart, pinEnd);
+        windows.emplace_back(master, start, end, pinStart, pinEnd);
+    }
+
+    for (size_t round = 0; round < 40; ++round) {
+        // a batch of well separated single base mutations, so no window is
+        //   straddled; the shared master is always mutated first
+        const vector<Mutation> candidates = Mutations(ToString(*master));
+        std::uniform_int_distribution<size_t> randMut(0, candidates.size() - 1);
+        vector<Mutation> muts;
+        while (muts.size() < 3) {
+            const Mutation mut = candidates[randMut(gen)];
+            bool separated = true;
+            for (const auto& other : muts)
+                separated &= (mut.End() + 2 < other.Start() || other.End() + 2 < mut.Start());
+            if (separated) muts.emplace_back(mut);
+        }
+
+        vector<Mutation> masterMuts(muts);
+        master->ApplyMutations(&masterMuts);
+
+        for (size_t i = 0; i < nWindows; ++i) {
+            vector<Mutation> wMuts(muts);
+            vector<Mutation> eMuts(muts);
+            bool wTooSmall = false, eTooSmall = false;
+            bool wApplied = false, eApplied = false;
+            try {
+                wApplied = windows[i].ApplyMutations(&wMuts);
+            } catch (const TemplateTooSmall&) {
+                wTooSmall = true;
+            }
+            try {
+                eApplied = expected[i].ApplyMutations(&eMuts);
+            } catch (const TemplateTooSmall&) {
+                eTooSmall = true;
+            }
+            ASSERT_EQ(eTooSmall, wTooSmall);
+            if (eTooSmall) continue;
+
+            EXPECT_EQ(eApplied, wApplied);
+            EXPECT_EQ(expected[i].Start(), windows[i].Start());
+            EXPECT_EQ(ToString(expected[i]), ToString(windows[i]));
+            EXPECT_TRUE(expected[i] == windows[i]);
+            EXPECT_NEAR(expected[i].NormalParameters().first, windows[i].NormalParameters().first,
+                        1e-9);
+            EXPECT_NEAR(expected[i].NormalParameters().second, windows[i].NormalParameters().second,
+                        1e-9);
+        }
+    }
+}
+
 }  // namespace TemplateTests
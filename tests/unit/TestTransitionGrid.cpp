@@ -0,0 +1,200 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <gtest/gtest.h>
+
+#include <pacbio/consensus/ModelConfig.h>
+#include <pacbio/consensus/ModelSelection.h>
+#include <pacbio/data/Read.h>
+
+#include "../src/JsonHelpers.h"
+#include "../src/ModelFactory.h"
+#include "../src/models/TransitionGrid.h"
+#include "TestData.h"
+
+using namespace PacBio::Consensus;  // NOLINT
+using namespace PacBio::Data;       // NOLINT
+
+using PacBio::Consensus::detail::TransitionGrid;
+using PacBio::Consensus::detail::TransitionsAt;
+
+namespace TransitionGridTests {
+
+// the error bound promised by TransitionGrid
+const double tolerance = 1.0e-8;
+
+// compare the grid of a PwSnr (all channels) or PwSnrA (channel A only)
+//   model file against exact evaluation, including SNRs out of range
+double MaxError(const std::string& model, const bool perChannel)
+{
+    boost::property_tree::ptree pt;
+    read_json(tests::DataDir + "/arrow/" + model, pt);
+
+    double snrRanges[4][2];
+    double params[16][3][4];
+    if (perChannel)
+        ReadMatrix<4, 2>(snrRanges, pt.get_child("SnrRanges"));
+    else {
+        ReadMatrix<2>(snrRanges[0], pt.get_child("SnrRanges"));
+        for (size_t i = 1; i < 4; ++i)
+            std::copy(snrRanges[0], snrRanges[0] + 2, snrRanges[i]);
+    }
+    ReadMatrix<16, 3, 4>(params, pt.get_child("TransitionParameters"));
+
+    TransitionGrid<16> grid;
+    for (size_t ctx = 0; ctx < 16; ++ctx)
+        grid.SetContext(ctx, perChannel ? ctx & 3 : 0, snrRanges[perChannel ? ctx & 3 : 0],
+                        params[ctx]);
+
+    std::mt19937 gen(42);
+    double maxErr = 0.0;
+    for (size_t n = 0; n < 10000; ++n) {
+        double snrs[4];
+        for (size_t i = 0; i < 4; ++i) {
+            const double width = snrRanges[i][1] - snrRanges[i][0];
+            snrs[i] = std::uniform_real_distribution<double>(snrRanges[i][0] - 0.1 * width,
+                                                             snrRanges[i][1] + 0.1 * width)(gen);
+        }
+        const SNR snr(snrs);
+
+        double interp[16][4];
+        grid.Interpolate(snr, interp);
+        for (size_t ctx = 0; ctx < 16; ++ctx) {
+            const size_t ch = perChannel ? ctx & 3 : 0;
+            const double x = std::max(snrRanges[ch][0], std::min(snr[ch], snrRanges[ch][1]));
+            double exact[4];
+            TransitionsAt(params[ctx], x, exact);
+            for (size_t j = 0; j < 4; ++j)
+                maxErr = std::max(maxErr, std::abs(interp[ctx][j] - exact[j]));
+        }
+    }
+    return maxErr;
+}
+
+TEST(TransitionGridTest, ErrorBound)
+{
+    EXPECT_LT(MaxError("SP1C1v2.json", true), tolerance);
+    EXPECT_LT(MaxError("SP2C2v5.json", true), tolerance);
+    EXPECT_LT(MaxError("SP1C1v1.json", false), tolerance);
+}
+
+TEST(TransitionGridTest, GridPoints)
+{
+    // the grid is exact at its end points, and interpolations are normalized
+    //   (the Hermite basis preserves sums, as the slopes sum to zero)
+    const double range[2] = {4.0, 12.0};
+    const double params[3][4] = {
+        {-2.0, 0.1, -0.01, 0.001}, {-3.0, 0.2, 0.0, -0.001}, {-1.0, -0.3, 0.02, 0.0}};
+    TransitionGrid<4> grid;
+    for (size_t ctx = 0; ctx < 4; ++ctx)
+        grid.SetContext(ctx, ctx, range, params);
+
+    double interp[4][4];
+    grid.Interpolate(SNR(4.0, 12.0, 1.0, 7.3), interp);
+    for (size_t ctx = 0; ctx < 4; ++ctx) {
+        double exact[4];
+        TransitionsAt(params, ctx == 0 || ctx == 2 ? 4.0 : (ctx == 1 ? 12.0 : 7.3), exact);
+        const double tol = ctx == 3 ? tolerance : 1.0e-12;
+        double sum = 0.0;
+        for (size_t j = 0; j < 4; ++j) {
+            EXPECT_NEAR(exact[j], interp[ctx][j], tol);
+            sum += interp[ctx][j];
+        }
+        EXPECT_NEAR(1.0, sum, 1.0e-12);
+    }
+}
+
+TEST(TransitionGridTest, CompiledModels)
+{
+    // the compiled models evaluate their transitions exactly; their files
+    //   are registered under chemistry names of their own, so as to leave
+    //   the models of tests::DataDir to the tests that load them
+    char dir[] = "/tmp/uny_grid_XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir));
+    const std::vector<std::pair<std::string, std::string>> models = {
+        {"SP1C1v1.json", "S/P1-C1.1::PwSnrA"},
+        {"SP1C1v2.json", "S/P1-C1.2::PwSnr"},
+        {"SP2C2v5.json", "S/P2-C2/5.0::PwSnr"}};
+    std::vector<std::string> paths;
+    for (const auto& model : models) {
+        boost::property_tree::ptree pt;
+        read_json(tests::DataDir + "/arrow/" + model.first, pt);
+        pt.put("ChemistryName", model.second.substr(0, model.second.find(':')) + "-grid");
+        paths.emplace_back(std::string(dir) + "/" + model.first);
+        write_json(paths.back(), pt);
+    }
+    ASSERT_EQ(models.size(), LoadModels(dir));
+
+    const std::string tpl = "ACGTTGCAAGCTAGCTTAGGCCAT";
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> rand(3.0, 20.0);
+    for (const auto& model : models) {
+        const std::string& chem = model.second;
+        const size_t sep = chem.find(':');
+        const std::string grid = chem.substr(0, sep) + "-grid" + chem.substr(sep);
+        for (size_t n = 0; n < 100; ++n) {
+            const SNR snr(rand(gen), rand(gen), rand(gen), rand(gen));
+            const auto exact = ModelFactory::Create(chem + "::Compiled", snr)->Populate(tpl);
+            const auto interp = ModelFactory::Create(grid + "::FromFile", snr)->Populate(tpl);
+            ASSERT_EQ(exact.size(), interp.size());
+            for (size_t i = 0; i < exact.size(); ++i) {
+                EXPECT_NEAR(exact[i].Match, interp[i].Match, tolerance);
+                EXPECT_NEAR(exact[i].Branch, interp[i].Branch, tolerance);
+                EXPECT_NEAR(exact[i].Stick, interp[i].Stick, tolerance);
+                EXPECT_NEAR(exact[i].Deletion, interp[i].Deletion, tolerance);
+            }
+        }
+    }
+
+    for (const auto& path : paths)
+        std::remove(path.c_str());
+    rmdir(dir);
+}
+
+}  // namespace TransitionGridTests
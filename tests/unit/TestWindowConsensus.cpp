@@ -0,0 +1,171 @@
+// Copyright (c) 2011-2017, Pacific Biosciences of California, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the
+// disclaimer below) provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//  * Neither the name of Pacific Biosciences nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY PACIFIC
+// BIOSCIENCES AND ITS CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL PACIFIC BIOSCIENCES OR ITS
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+// USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+// SUCH DAMAGE.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cctype>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <pacbio/consensus/Mutation.h>
+#include <pacbio/data/Read.h>
+#include <pacbio/data/Sequence.h>
+#include <pacbio/genomic/WindowConsensus.h>
+
+#include "RandomDNA.h"
+
+using std::string;
+using std::vector;
+
+using namespace PacBio::Consensus;  // NOLINT
+using namespace PacBio::Data;       // NOLINT
+using namespace PacBio::Genomic;    // NOLINT
+
+namespace WindowConsensusTests {
+
+const SNR snr(10, 7, 5, 11);
+const string mdl("P6-C4");
+
+Read MkRead(const string& seq)
+{
+    const vector<uint8_t> cov(seq.length(), 0);
+    return Read("NA", seq, cov, cov, snr, mdl);
+}
+
+// nReads reads on either strand, each spanning the whole template
+vector<MappedRead> MkReads(const string& seq, const size_t tplLength, const size_t nReads)
+{
+    vector<MappedRead> reads;
+    for (size_t i = 0; i < nReads; ++i) {
+        reads.emplace_back(MkRead(seq), StrandType::FORWARD, 0, tplLength, true, true);
+        reads.emplace_back(MkRead(ReverseComplement(seq)), StrandType::REVERSE, 0, tplLength, true,
+                           true);
+    }
+    return reads;
+}
+
+TEST(WindowConsensusTest, Variants)
+{
+    std::mt19937 gen(42);
+    const string ref = RandomDNA(300, &gen);
+    const auto otherBase = [](const char b) { return b == 'A' ? 'C' : 'A'; };
+
+    // the flanks are polished, but only the window is reported
+    vector<Mutation> muts = {Mutation::Substitution(20, otherBase(ref[20])),
+                             Mutation::Insertion(120, otherBase(ref[119])),
+                             Mutation::Deletion(200, 1),
+                             Mutation::Substitution(280, otherBase(ref[280]))};
+    const string truth = ApplyMutations(ref, &muts);
+
+    const auto result = ConsensusForWindow(ref, 50, 250, MkReads(truth, ref.length(), 3));
+
+    EXPECT_TRUE(result.Result.hasConverged);
+    EXPECT_EQ(6, result.Coverage);
+    EXPECT_EQ(truth.substr(50, 200), result.Sequence);
+    EXPECT_EQ(result.Sequence.length(), result.Qualities.size());
+
+    ASSERT_EQ(2, result.Variants.size());
+    EXPECT_EQ(120, result.Variants[0].RefStart);
+    EXPECT_EQ(120, result.Variants[0].RefEnd);
+    EXPECT_EQ("", result.Variants[0].RefBases);
+    EXPECT_EQ(1, result.Variants[0].AltBases.length());
+    EXPECT_EQ(200, result.Variants[1].RefStart);
+    EXPECT_EQ(201, result.Variants[1].RefEnd);
+    EXPECT_EQ(ref.substr(200, 1), result.Variants[1].RefBases);
+    EXPECT_EQ("", result.Variants[1].AltBases);
+
+    for (const auto& var : result.Variants) {
+        EXPECT_EQ(6, var.Coverage);
+        EXPECT_GE(var.Confidence, 40);
+    }
+}
+
+TEST(WindowConsensusTest, ConsecutiveWindows)
+{
+    std::mt19937 gen(42);
+    const string ref = RandomDNA(400, &gen);
+    const auto otherBase = [](const char b) { return b == 'A' ? 'C' : 'A'; };
+
+    // variants next to the window boundaries at 100, 200 and 300,
+    // the insertion does not extend a homopolymer to keep its position unambiguous
+    const string bases = "ACGT";
+    const char ins = bases[bases.find_first_not_of(ref.substr(199, 2))];
+    vector<Mutation> muts = {Mutation::Deletion(99, 1), Mutation::Insertion(200, ins),
+                             Mutation::Substitution(300, otherBase(ref[300]))};
+    std::sort(muts.begin(), muts.end(), Mutation::SiteComparer);
+    const string truth = ApplyMutations(ref, &muts);
+
+    string polished;
+    size_t nVariants = 0;
+    for (size_t start = 0; start < ref.length(); start += 100) {
+        const size_t end = start + 100;
+        const auto result = ConsensusForWindow(ref, start, end, MkReads(truth, ref.length(), 3));
+        polished += result.Sequence;
+        nVariants += result.Variants.size();
+    }
+
+    EXPECT_EQ(truth, polished);
+    EXPECT_EQ(3, nVariants);
+}
+
+TEST(WindowConsensusTest, NoCall)
+{
+    std::mt19937 gen(42);
+    const string ref = RandomDNA(100, &gen);
+    string lower = ref.substr(10, 80);
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+    // too few reads
+    const auto result = ConsensusForWindow(ref, 10, 90, MkReads(ref, ref.length(), 2));
+    EXPECT_EQ(4, result.Coverage);
+    EXPECT_EQ(lower, result.Sequence);
+    EXPECT_EQ(vector<int>(80, 0), result.Qualities);
+    EXPECT_TRUE(result.Variants.empty());
+
+    // ambiguous reference
+    const auto ambiguous =
+        ConsensusForWindow(ref.substr(0, 50) + 'N' + ref.substr(51), 10, 90, MkReads(ref, 100, 3));
+    EXPECT_EQ(0, ambiguous.Coverage);
+    EXPECT_EQ(80, ambiguous.Sequence.length());
+
+    EXPECT_THROW(ConsensusForWindow(ref, 90, 10, {}), std::invalid_argument);
+    EXPECT_THROW(ConsensusForWindow(ref, 10, 101, {}), std::invalid_argument);
+}
+
+}  // namespace WindowConsensusTests